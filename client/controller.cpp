@@ -1,239 +1,822 @@
-#ifdef _WIN32
-#include <windows.h>
-#endif
-#include "../common/socket_functions.h"
-#include "../common/os_functions.h"
-#include "../common/log.h"
-#include "../common/stringtools.h"
-#include "../common/packet_ids.h"
-#include "../common/msg_ack.h"
-#include "trackerconnector.h"
-#include "output.h"
-#include "controller.h"
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "../common/socket_functions.h"
+#include "../common/os_functions.h"
+#include "../common/log.h"
+#include "../common/stringtools.h"
+#include "../common/packet_ids.h"
+#include "../common/msg_ack.h"
+#include "trackerconnector.h"
+#include "output.h"
+#include "controller.h"
 #include <memory.h>
-
-/**
-* Initialize the contorller. It should listen on UDP port 'pPort' and only utilize
-* bandwidth 'pBandwidth_out' (bytes/s).
-* With pointer to trackerconnector 'pTracker_conn' and output thread 'pOutput'
-**/
-Controller::Controller(unsigned short pPort, TrackerConnector *pTracker_conn, unsigned int pBandwidth_out, Output *pOutput) :
-	tracker_conn(pTracker_conn), port(pPort), output(pOutput)
-{
-	bandwidth_max=pBandwidth_out;
-	bandwidth_curr=0;
-	last_bandwidth_reset=os_gettimems();
-}
-
-/**
-* main thread function
-**/
-void Controller::operator()(void)
-{
+#include <algorithm>
+
+//Time in ms a slice thread waits for messages before it looks at the queue again
+const unsigned int slice_wait_time=100;
+//Interval in ms in which the duplicate statistic is logged
+const unsigned int slice_stats_interval=10000;
+//Time in ms the message threads wait for messages before they look at their queue again
+const unsigned int message_wait_time=1000;
+//Time in ms of sending the slices may send in a burst
+const unsigned int relay_burst_time=50;
+//Minimal burst size in bytes
+const unsigned int relay_min_burst=8*1024;
+//Messages sent through the trees which waited longer than this (in ms) for bandwidth are dropped
+const unsigned int relay_max_defer=200;
+//Interval in ms in which deferred and dropped messages are reported to the tracker
+const unsigned int relay_report_interval=1000;
+//Interval in ms in which the relay threads publish their CPU time
+const unsigned int thread_cpu_interval=100;
+
+/**
+* Copy 'buf' of size 'bsize' into a shared message. The caller holds the first reference
+**/
+static SSharedBuf* createSharedBuf(const char *buf, size_t bsize)
+{
+	SSharedBuf *shared=new SSharedBuf;
+	shared->buf=new char[bsize];
+	memcpy(shared->buf, buf, bsize);
+	shared->bsize=bsize;
+	shared->refs=1;
+	return shared;
+}
+
+/**
+* Release a reference of 'shared'. Deletes it with the last one
+**/
+static void releaseSharedBuf(SSharedBuf *shared)
+{
+	if(os_atomic_add(&shared->refs, 0-1U)==0)
+	{
+		delete [] shared->buf;
+		delete shared;
+	}
+}
+
+/**
+* Initialize the CPU time 'cpu' of a relay thread
+**/
+static void initThreadCpu(SThreadCpu &cpu)
+{
+	cpu.cputime=0;
+	cpu.last_update=0;
+}
+
+/**
+* Publish the CPU time the calling thread used in 'cpu', unless it was published shortly before.
+* Called in the loops of the relay threads, also while they are busy
+**/
+static void updateThreadCpu(SThreadCpu &cpu)
+{
+	unsigned int ctime=os_gettimems();
+	if(ctime-cpu.last_update>=thread_cpu_interval)
+	{
+		cpu.last_update=ctime;
+		os_atomic_store(&cpu.cputime, os_getthreadcputimems());
+	}
+}
+
+/**
+* Initialize the contorller. It should listen on UDP port 'pPort' and only utilize
+* bandwidth 'pBandwidth_out' (bytes/s).
+* With pointer to trackerconnector 'pTracker_conn' and output thread 'pOutput'.
+* With 'pSlices' bigger than one, that many slice threads forward the messages.
+* Duplicates are detected within the last 'pDedupe_width' ids
+**/
+Controller::Controller(unsigned short pPort, TrackerConnector *pTracker_conn, unsigned int pBandwidth_out, Output *pOutput, unsigned int pSlices, unsigned int pDedupe_width) :
+	tracker_conn(pTracker_conn), port(pPort), output(pOutput), nslices(pSlices), dedupe_width(pDedupe_width)
+{
+	bandwidth_max=pBandwidth_out;
+	if(nslices==0)
+		nslices=1;
+	slices_ready=0;
+	initThreadCpu(cpu);
+	last_stats_time=os_gettimems();
+
+	tracker_thread=new TrackerMessageThread(tracker_conn);
+	boost::thread tracker_thread_d(boost::ref(*tracker_thread));
+	tracker_thread_d.yield();
+}
+
+/**
+* main thread function
+**/
+void Controller::operator()(void)
+{
+#ifdef _WIN32
+	SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL);
+#endif
+
+	cs=os_createSocket();
+	if(!os_bind(cs, port) )
+	{
+		log("Error binding socket to port "+nconvert(port));
+		return;
+	}
+
+	unsigned int send_window_size=1024*1024; //1MB
+	while(!os_set_send_window(cs, send_window_size) )
+		send_window_size/=2;
+
+	log("Send buffer set to "+nconvert(send_window_size));
+
+	unsigned int recv_window_size=1024*1024; //1MB
+	while(!os_set_recv_window(cs, recv_window_size) )
+		recv_window_size/=2;
+
+	log("Receive buffer set to "+nconvert(recv_window_size));
+
+	for(unsigned int i=0;i<nslices;++i)
+	{
+		slices.push_back(new ControllerSlice(this, tracker_conn, tracker_thread, cs, bandwidth_max/nslices, tracker_conn->getChannel(), dedupe_width));
+	}
+	if(nslices>1)
+	{
+		for(unsigned int i=0;i<nslices;++i)
+		{
+			boost::thread slice_thread(boost::ref(*slices[i]));
+			slice_thread.yield();
+		}
+		log("Processing messages with "+nconvert(nslices)+" slice threads");
+	}
+	os_atomic_store(&slices_ready, 1);
+
+	while(true)
+	{
+		char buffer[4096];
+		unsigned int sourceip;
+		unsigned short sourceport;
+		int rc=os_recvfrom(cs, buffer, 4096, sourceip, sourceport);
+		updateThreadCpu(cpu);
+		if(rc<=0)
+			continue;
+
+		if(nslices==1)
+		{
+			slices[0]->processMessage(buffer, rc);
+			continue;
+		}
+
+		unsigned int msgid;
+		if(!wire_get_msgid(buffer, rc, msgid))
+			continue;
+
+		char *buf=new char[rc];
+		memcpy(buf, buffer, rc);
+		slices[msgid%nslices]->addMessage(buf, rc);
+	}
+}
+
+/**
+* Initialize the slice of controller 'pController'. It sends with the udp socket 'udpsock' and
+* only utilizes bandwidth 'pBandwidth_out' (bytes/s). Receives channel 'pChannel'.
+* Duplicates are detected within the last 'pDedupe_width' ids
+**/
+ControllerSlice::ControllerSlice(Controller *pController, TrackerConnector *pTracker_conn, TrackerMessageThread *pTracker_thread, SOCKET udpsock, unsigned int pBandwidth_out, unsigned short pChannel, unsigned int pDedupe_width) :
+	controller(pController), tracker_conn(pTracker_conn), channel(pChannel), packets_forward(pDedupe_width), fec_forward(pDedupe_width)
+{
+	last_stats=os_gettimems();
+	waiting=0;
+	received=0;
+	forwarded=0;
+	duplicates=0;
+	initThreadCpu(cpu);
+
+	message_thread=new SendMessageThread(udpsock, pBandwidth_out, pTracker_thread);
+	boost::thread message_thread_d(boost::ref(*message_thread));
+	message_thread_d.yield();
+}
+
+/**
+* Handle the received message 'buf' of size 'bsize'
+**/
+void ControllerSlice::processMessage(const char *buf, size_t bsize)
+{
+	unsigned int ctime=os_gettimems();
+	if(ctime-last_stats>=slice_stats_interval)
+	{
+		LOG("Controller: duplicates="+nconvert(packets_forward.getDuplicates())+" too old="+nconvert(packets_forward.getTooOld()), LL_INFO);
+		last_stats=ctime;
+	}
+	++received;
+
+	CRData data(buf, bsize);
+	unsigned char id;
+	if(!data.getUChar(&id))
+		return;
+	unsigned char version=wire_version_1;
+	if(id==wire_v2_marker)
+	{
+		version=wire_version_2;
+		if(!data.getUChar(&id))
+			return;
+	}
+
+	switch(id)
+	{
+	case CC_SPREAD:
+		{
+			msg_spread msg(data, version);
+			ProcessSpreadMsg(msg, data);
+		}break;
+	case CC_DATA:
+		{
+			msg_data msg(data, version);
+			ProcessDataMsg(msg);
+		}break;
+	case CC_DATA_COMPACT:
+		{
+			if(version!=wire_version_2)
+				break;
+			msg_data msg(data, version, true);
+			ProcessDataMsg(msg);
+		}break;
+	case CC_RESEND:
+		{
+			msg_spread msg(data, version);
+			ProcessResendMsg(msg);
+		}break;
+	case CC_FEC:
+		{
+			if(version!=wire_version_1)
+				break;
+			msg_fec msg(data);
+			ProcessFecMsg(msg, data);
+		}break;
+	}
+}
+
+/**
+* Queue the received message 'buf' of size 'bsize' for the slice thread. Takes ownership of 'buf'.
+* Only called by the controller thread
+**/
+void ControllerSlice::addMessage(char *buf, size_t bsize)
+{
+	SRecvUDP msg;
+	msg.buf=buf;
+	msg.bsize=bsize;
+	queue.push(msg);
+
+	//The slice thread sets 'waiting' before it looks at the queue a last time, so it either sees the message or is woken
+	if(os_atomic_load(&waiting))
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		cond.notify_one();
+	}
+}
+
+/**
+* Slice thread. Processes the queued messages
+**/
+void ControllerSlice::operator()(void)
+{
 #ifdef _WIN32
-	SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL);
+	SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL);
 #endif
-
-	cs=os_createSocket();
-	if(!os_bind(cs, port) )
-	{
-		log("Error binding socket to port "+nconvert(port));
-		return;
-	}
-
-	unsigned int send_window_size=1024*1024; //1MB
-	while(!os_set_send_window(cs, send_window_size) )
-		send_window_size/=2;
-
-	log("Send buffer set to "+nconvert(send_window_size));
-
-	unsigned int recv_window_size=1024*1024; //1MB
-	while(!os_set_recv_window(cs, recv_window_size) )
-		recv_window_size/=2;
-
-	log("Receive buffer set to "+nconvert(recv_window_size));
-
-	message_thread=new SendMessageThread(tracker_conn, cs);
-	boost::thread message_thread_d(boost::ref(*message_thread));
-	message_thread_d.yield();
-
-	while(true)
-	{
-		char buffer[4096];
-		unsigned int sourceip;
-		unsigned short sourceport;
-		int rc=os_recvfrom(cs, buffer, 4096, sourceip, sourceport);
-		if(os_gettimems()-last_bandwidth_reset>1000)
-		{
-			bandwidth_curr=0;
-			last_bandwidth_reset=os_gettimems();
-		}
-		if(rc>0)
-		{
-			CRData data(buffer, rc);
-			unsigned char id;
-			data.getUChar(&id);
-			switch(id)
-			{
-			case CC_SPREAD:
-				{
-					msg_spread msg(data);
-					ProcessSpreadMsg(msg, data);
-				}break;
-			case CC_DATA:
-				{
-					msg_data msg(data);
-					ProcessDataMsg(msg);
-				}break;
-			}
-		}
-	}
-}
-
-/**
-* Handle a message that is send through the tree structure
-**/
-void Controller::ProcessSpreadMsg(msg_spread &msg, CRData &data)
-{
-	std::map<unsigned int, bool>::iterator it=packets_forward.find(msg.getMsgID());
-	if(it==packets_forward.end())
-	{
-		packets_forward[msg.getMsgID()]=true;
-		while(packets_forward.size()>1000)
-			packets_forward.erase(packets_forward.begin());
-
-		{
-			char *buf=new char[msg.getBuf_size()];
-			memcpy(buf, msg.getBuf(), msg.getBuf_size());
-			SBufferObject *obj=new SBufferObject;
-			obj->id=msg.getMsgID();
-			obj->buf=buf;
-			obj->bsize=msg.getBuf_size();
-			output->addBufferObject(obj);
-		}
-
-		std::vector<std::pair<unsigned int, unsigned short> > peers=tracker_conn->getPeers(msg.getMsgID());
-		for(size_t i=0;i<peers.size();++i)
-		{
-			//if(bandwidth_curr<bandwidth_max)
-			{
-				message_thread->sendToUDP(data.getDataPtr(), data.getSize(), peers[i].first, peers[i].second);
-				bandwidth_curr+=data.getSize();
-			}
-			/*else
-			{
-				LOG("Not enough spread bandwidth!", LL_INFO);
-				break;
-			}*/
-		}
-	}
-}
-
-/**
-* Handle exploration messag with multiple hops
-**/
-void Controller::ProcessDataMsg(msg_data &msg)
-{
-	{
-		char *buf=new char[msg.getBuf_size()];
-		memcpy(buf, msg.getBuf(), msg.getBuf_size());
-		SBufferObject *obj=new SBufferObject;
-		obj->id=msg.getMsgID();
-		obj->buf=buf;
-		obj->bsize=msg.getBuf_size();
-		output->addBufferObject(obj);
-	}
-
-	std::pair<unsigned int, unsigned short> next=msg.getNextHop();
-	if(next.first!=0)
-	{
-		if(bandwidth_curr<bandwidth_max)
-		{
-			msg.incrementHop();
-			CWData data;
-			msg.getMessage(data);
-			message_thread->sendToUDP(data.getDataPtr(), data.getDataSize(), next.first, next.second);
-			bandwidth_curr+=data.getDataSize();
-		}
-	}
-	else
-	{
-		next=msg.getTarget();
-		if(next.first!=0)
-		{
-			msg_ack ackmsg(msg.getMsgID(), next.first, next.second);
-			CWData data;
-			ackmsg.getMessage(data);
-			message_thread->sendToTracker(data);
-			LOG("ACK for ID="+nconvert(msg.getMsgID()), LL_DEBUG );
-		}
-	}
-}
-
-/**
-* Initialize the thread with the trackerconnector 'pTracker_conn' and outgoing udp socket 'udpsock'
-**/
-SendMessageThread::SendMessageThread(TrackerConnector *pTracker_conn, SOCKET udpsock) : tracker_conn(pTracker_conn), cs(udpsock)
-{
-}
-
-/**
-* Message queue thread
-**/
-void SendMessageThread::operator()(void)
-{
-	//SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL);
-	boost::mutex::scoped_lock lock(mutex);
-	while(true)
-	{
-		cond.wait(lock);
-		for(size_t i=0;i<to_tracker.size();++i)
-		{
-			CWData data=to_tracker[i];
-			lock.unlock();
-			tracker_conn->sendToTracker( data );
-			lock.lock();
-		}
-		to_tracker.clear();
-		for(size_t i=0;i<to_udp.size();++i)
-		{
-			os_sendto(cs, to_udp[i].ip, to_udp[i].port, to_udp[i].buf, to_udp[i].bsize );
-			delete [] to_udp[i].buf;
-		}
-		to_udp.clear();
-	}
-}
-
-/**
-* Send data 'msg' to the tracker
-**/
-void SendMessageThread::sendToTracker(const CWData &msg)
-{
-	boost::mutex::scoped_lock lock(mutex);
-	to_tracker.push_back(msg);
-	cond.notify_all();
-}
-
-/**
-* Send data 'buf' of size 'bsize' to peer with ip 'ip' and port 'port using UDP
-**/
-void SendMessageThread::sendToUDP(const char *buf, size_t bsize, unsigned int ip, unsigned short port)
-{
-	SSendUDP ns;
-	ns.buf=new char[bsize];
-	memcpy(ns.buf, buf, bsize);
-	ns.bsize=bsize;
-	ns.ip=ip;
-	ns.port=port;
-	boost::mutex::scoped_lock lock(mutex);
-	to_udp.push_back(ns);
-	cond.notify_all();
-}
-
-/**
-* Send data 'msg' to tracker
-**/
-void Controller::sendToTracker(const CWData &msg)
-{
-	message_thread->sendToTracker(msg);
+
+	SRecvUDP msg;
+	while(true)
+	{
+		while(queue.pop(msg))
+		{
+			processMessage(msg.buf, msg.bsize);
+			delete [] msg.buf;
+			updateThreadCpu(cpu);
+		}
+		updateThreadCpu(cpu);
+
+		boost::mutex::scoped_lock lock(mutex);
+		os_atomic_store(&waiting, 1);
+		if(queue.empty())
+		{
+			boost::xtime xt;
+			boost::xtime_get(&xt, boost::TIME_UTC);
+			xt.nsec+=slice_wait_time*1000000;
+			if(xt.nsec>=1000000000)
+			{
+				++xt.sec;
+				xt.nsec-=1000000000;
+			}
+			cond.timed_wait(lock, xt);
+		}
+		os_atomic_store(&waiting, 0);
+	}
+}
+
+/**
+* Set 'stats' to the number of messages received, forwarded and dropped as duplicates. Called by any thread
+**/
+void ControllerSlice::getStats(SSliceStats &stats)
+{
+	stats.received=os_atomic_load(&received);
+	stats.forwarded=os_atomic_load(&forwarded);
+	stats.duplicates=os_atomic_load(&duplicates);
+}
+
+/**
+* Returns the number of messages waiting to be relayed. Called by any thread
+**/
+unsigned int ControllerSlice::getQueueDepth(void)
+{
+	return message_thread->getQueueDepth();
+}
+
+/**
+* Add the CPU times in ms the slice thread and its send thread used to 'cputimes'. Called by any thread
+**/
+void ControllerSlice::getCpuTimes(std::vector<unsigned int> &cputimes)
+{
+	cputimes.push_back(os_atomic_load(&cpu.cputime));
+	cputimes.push_back(message_thread->getCpuTime());
+}
+
+/**
+* Handle a message that is send through the tree structure
+**/
+void ControllerSlice::ProcessSpreadMsg(msg_spread &msg, CRData &data)
+{
+	if(msg.hasError() || msg.getChannel()!=channel)
+		return;
+
+	if(packets_forward.check(msg.getMsgID()))
+	{
+		controller->addBuffer(msg.getMsgID(), msg.getBuf(), msg.getBuf_size());
+
+		const std::vector<SRelayNode> &peers=tracker_conn->getPeers(msg.getMsgID());
+		if(peers.empty())
+			return;
+
+		//The message is copied once for all children. Children which only understand version 1
+		//get the payload after a header in version 1
+		SSharedBuf *shared=createSharedBuf(data.getDataPtr(), data.getSize());
+		size_t payload_off=msg.getBuf()-data.getDataPtr();
+		char v1_buf[sizeof(SWireSpread)];
+		CWData v1_hdr(v1_buf, sizeof(v1_buf));
+		for(size_t i=0;i<peers.size();++i)
+		{
+			if(peers[i].version<msg.getVersion())
+			{
+				if(v1_hdr.getDataSize()==0)
+				{
+					//Built with a copy, so 'msg' keeps its version for the other children
+					msg_spread v1_msg(msg);
+					v1_msg.setVersion(wire_version_1);
+					v1_msg.getHeader(v1_hdr);
+				}
+				message_thread->sendShared(shared, v1_hdr.getDataPtr(), v1_hdr.getDataSize(), payload_off, peers[i].ip, peers[i].port, true);
+			}
+			else
+			{
+				message_thread->sendShared(shared, NULL, 0, 0, peers[i].ip, peers[i].port, true);
+			}
+		}
+		releaseSharedBuf(shared);
+		forwarded+=(unsigned int)peers.size();
+	}
+	else
+	{
+		++duplicates;
+	}
+}
+
+/**
+* Handle exploration messag with multiple hops
+**/
+void ControllerSlice::ProcessDataMsg(msg_data &msg)
+{
+	if(msg.hasError() || msg.getChannel()!=channel)
+		return;
+
+	controller->addBuffer(msg.getMsgID(), msg.getBuf(), msg.getBuf_size());
+
+	if(msg.isCompact())
+	{
+		CPeerIndex *peer_index=tracker_conn->getPeerIndex();
+		if(peer_index==NULL || !msg.resolveHops(*peer_index))
+		{
+			LOG("Unknown peer index in exploration message ID="+nconvert(msg.getMsgID()), LL_DEBUG);
+			return;
+		}
+	}
+
+	std::pair<unsigned int, unsigned short> next=msg.getNextHop();
+	if(next.first!=0)
+	{
+		msg.incrementHop();
+		char dbuf[cwdata_stack_size];
+		CWData data(dbuf, sizeof(dbuf));
+		msg.getMessage(data);
+		message_thread->sendToUDP(data.getDataPtr(), data.getDataSize(), next.first, next.second, false);
+		++forwarded;
+	}
+	else
+	{
+		next=msg.getTarget();
+		if(next.first!=0)
+		{
+			msg_ack ackmsg(msg.getMsgID(), next.first, next.second, tracker_conn->getTrackerVersion());
+			CWData data;
+			ackmsg.getMessage(data);
+			controller->sendToTracker(data);
+			LOG("ACK for ID="+nconvert(msg.getMsgID()), LL_DEBUG );
+		}
+	}
+}
+
+/**
+* Handle a retransmission from the server. The buffer was requested by this client only,
+* so it is not forwarded to the children
+**/
+void ControllerSlice::ProcessResendMsg(msg_spread &msg)
+{
+	if(msg.hasError() || msg.getChannel()!=channel)
+		return;
+
+	controller->addBuffer(msg.getMsgID(), msg.getBuf(), msg.getBuf_size());
+	LOG("Received retransmission of ID="+nconvert(msg.getMsgID()), LL_DEBUG);
+}
+
+/**
+* Handle a parity message that is send through the tree structure. It is forwarded
+* to the children of the tree it is sent through and used to recover a lost buffer
+**/
+void ControllerSlice::ProcessFecMsg(msg_fec &msg, CRData &data)
+{
+	if(msg.hasError() || msg.getChannel()!=channel)
+		return;
+
+	if(!fec_forward.check(msg.getFirstID()))
+	{
+		++duplicates;
+		return;
+	}
+
+	const std::vector<SRelayNode> &peers=tracker_conn->getPeers(msg.getMsgID());
+	if(!peers.empty())
+	{
+		SSharedBuf *shared=createSharedBuf(data.getDataPtr(), data.getSize());
+		for(size_t i=0;i<peers.size();++i)
+		{
+			message_thread->sendShared(shared, NULL, 0, 0, peers[i].ip, peers[i].port, true);
+		}
+		releaseSharedBuf(shared);
+	}
+	forwarded+=(unsigned int)peers.size();
+
+	controller->addParity(msg);
+}
+
+/**
+* Pass the received buffer with id 'id' to the output thread and the forward error correction.
+* Called by the slices
+**/
+void Controller::addBuffer(unsigned int id, const char *buf, size_t bsize)
+{
+	char *obuf=new char[bsize];
+	memcpy(obuf, buf, bsize);
+	SBufferObject *obj=new SBufferObject;
+	obj->id=id;
+	obj->buf=obuf;
+	obj->bsize=bsize;
+
+	boost::mutex::scoped_lock lock(buffer_mutex);
+	output->addBufferObject(obj);
+	addFecBuffer(id, buf, bsize);
+}
+
+/**
+* Pass the parity message 'msg' to the forward error correction. Called by the slices
+**/
+void Controller::addParity(msg_fec &msg)
+{
+	boost::mutex::scoped_lock lock(buffer_mutex);
+	SBufferObject *obj=fec.addParity(msg);
+	if(obj!=NULL)
+	{
+		output->addBufferObject(obj);
+	}
+}
+
+/**
+* Write the statistics message for the tracker to 'data'. Returns false if the slices
+* are not running yet. Only called by the trackerconnector thread
+**/
+bool Controller::getStats(CWData &data)
+{
+	if(!os_atomic_load(&slices_ready))
+		return false;
+
+	std::vector<SSliceStats> stats(slices.size());
+	unsigned int queue_depth=0;
+	for(size_t i=0;i<slices.size();++i)
+	{
+		slices[i]->getStats(stats[i]);
+		queue_depth+=slices[i]->getQueueDepth();
+	}
+
+	std::vector<unsigned int> cputimes;
+	cputimes.push_back(os_atomic_load(&cpu.cputime));
+	for(size_t i=0;i<slices.size();++i)
+	{
+		slices[i]->getCpuTimes(cputimes);
+	}
+
+	//A single busy thread limits the relay, however many cores are idle. So the load
+	//of the busiest relay thread is reported
+	unsigned int ctime=os_gettimems();
+	unsigned int cpu_load=0;
+	if(ctime!=last_stats_time && cputimes.size()==last_stats_cputimes.size())
+	{
+		for(size_t i=0;i<cputimes.size();++i)
+		{
+			cpu_load=(std::max)(cpu_load, (cputimes[i]-last_stats_cputimes[i])*100/(ctime-last_stats_time));
+		}
+	}
+	last_stats_time=ctime;
+	last_stats_cputimes=cputimes;
+
+	msg_stats msg(stats, output->getLateCount(), output->getLostCount(), queue_depth, output->getJitter(), (unsigned short)(std::min)(cpu_load, 100U));
+	msg.getMessage(data);
+	return true;
+}
+
+/**
+* Add the received buffer to the parity of its group and pass a
+* recovered buffer to the output thread
+**/
+void Controller::addFecBuffer(unsigned int id, const char *buf, size_t bsize)
+{
+	SBufferObject *obj=fec.addBuffer(id, buf, bsize);
+	if(obj!=NULL)
+	{
+		output->addBufferObject(obj);
+	}
+}
+
+/**
+* Initialize the thread with the outgoing udp socket 'udpsock'. It sends at most 'bandwidth' bytes/s
+* (0 for no limit) and reports deferred and dropped messages via 'pTracker_thread'
+**/
+SendMessageThread::SendMessageThread(SOCKET udpsock, unsigned int bandwidth, TrackerMessageThread *pTracker_thread) : tracker_thread(pTracker_thread), cs(udpsock)
+{
+	waiting=0;
+	queued=0;
+	bucket=NULL;
+	explore_reserve=0;
+	initThreadCpu(cpu);
+	if(bandwidth>0)
+	{
+		unsigned int burst=(std::max)(bandwidth/1000*relay_burst_time, relay_min_burst);
+		bucket=new CTokenBucket(bandwidth, burst);
+		explore_reserve=burst/2;
+	}
+}
+
+/**
+* Message queue thread. Sends all queued messages, then waits for new ones
+**/
+void SendMessageThread::operator()(void)
+{
+	//SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL);
+	SSendUDP ns;
+	while(true)
+	{
+		while(to_udp.pop(ns))
+		{
+			os_atomic_add(&queued, 0-1U);
+			if(pace(ns))
+			{
+				SSendBuf bufs[2];
+				size_t nbufs=0;
+				if(ns.hsize>0)
+				{
+					bufs[nbufs].buf=ns.hdr;
+					bufs[nbufs].bsize=ns.hsize;
+					++nbufs;
+				}
+				bufs[nbufs].buf=ns.shared->buf+ns.skip;
+				bufs[nbufs].bsize=ns.shared->bsize-ns.skip;
+				++nbufs;
+				os_sendtov(cs, ns.ip, ns.port, bufs, nbufs);
+			}
+			releaseSharedBuf(ns.shared);
+			updateThreadCpu(cpu);
+		}
+		updateThreadCpu(cpu);
+
+		//'waiting' is set before the queue is checked a last time, so a message is either seen or signalled
+		os_atomic_store(&waiting, 1);
+		if(to_udp.empty())
+		{
+			wake.wait(message_wait_time);
+		}
+		os_atomic_store(&waiting, 0);
+	}
+}
+
+/**
+* Wait for the tokens of message 'ns'. Messages sent through the trees may empty the bucket and wait
+* for it, exploration messages only use the tokens above the reserve. Returns false if it has to be dropped
+**/
+bool SendMessageThread::pace(const SSendUDP &ns)
+{
+	if(bucket==NULL)
+		return true;
+
+	if(!ns.spread)
+	{
+		if(bucket->take(ns.bsize, explore_reserve))
+			return true;
+
+		tracker_thread->addRelayCounts(0, 1);
+		return false;
+	}
+
+	if(bucket->take(ns.bsize, 0))
+		return true;
+
+	do
+	{
+		if(os_gettimems()-ns.qtime>relay_max_defer)
+		{
+			tracker_thread->addRelayCounts(0, 1);
+			return false;
+		}
+		os_sleep(bucket->getWait(ns.bsize));
+	}
+	while(!bucket->take(ns.bsize, 0));
+
+	tracker_thread->addRelayCounts(1, 0);
+	return true;
+}
+
+/**
+* Send data 'buf' of size 'bsize' to peer with ip 'ip' and port 'port using UDP. 'spread' is
+* true for messages sent through the trees. Called by any thread
+**/
+void SendMessageThread::sendToUDP(const char *buf, size_t bsize, unsigned int ip, unsigned short port, bool spread)
+{
+	SSharedBuf *shared=createSharedBuf(buf, bsize);
+	sendShared(shared, NULL, 0, 0, ip, port, spread);
+	releaseSharedBuf(shared);
+}
+
+/**
+* Send header 'hdr' of size 'hsize' followed by 'shared' without its first 'skip' bytes to peer with
+* ip 'ip' and port 'port' using UDP. Takes a reference of 'shared'. 'spread' is true for messages
+* sent through the trees. Called by any thread
+**/
+void SendMessageThread::sendShared(SSharedBuf *shared, const char *hdr, size_t hsize, size_t skip, unsigned int ip, unsigned short port, bool spread)
+{
+	SSendUDP ns;
+	if(hsize>sizeof(ns.hdr))
+		return;
+	os_atomic_add(&shared->refs, 1);
+	ns.shared=shared;
+	ns.skip=skip;
+	if(hsize>0)
+	{
+		memcpy(ns.hdr, hdr, hsize);
+	}
+	ns.hsize=hsize;
+	ns.bsize=hsize+shared->bsize-skip;
+	ns.ip=ip;
+	ns.port=port;
+	ns.spread=spread;
+	ns.qtime=os_gettimems();
+	queueMessage(ns);
+}
+
+/**
+* Queue 'ns' and wake the thread
+**/
+void SendMessageThread::queueMessage(const SSendUDP &ns)
+{
+	//Counted before it is queued, so the thread never counts it down first
+	os_atomic_add(&queued, 1);
+	to_udp.push(ns);
+	if(os_atomic_load(&waiting))
+	{
+		wake.signal();
+	}
+}
+
+/**
+* Returns the number of messages waiting to be sent. Called by any thread
+**/
+unsigned int SendMessageThread::getQueueDepth(void)
+{
+	return os_atomic_load(&queued);
+}
+
+/**
+* Returns the CPU time in ms the thread used. Called by any thread
+**/
+unsigned int SendMessageThread::getCpuTime(void)
+{
+	return os_atomic_load(&cpu.cputime);
+}
+
+/**
+* Initialize the thread with the trackerconnector 'pTracker_conn'
+**/
+TrackerMessageThread::TrackerMessageThread(TrackerConnector *pTracker_conn) : tracker_conn(pTracker_conn)
+{
+	waiting=0;
+	relay_deferred=0;
+	relay_dropped=0;
+	last_report=os_gettimems();
+}
+
+/**
+* Message queue thread. Sends all queued messages, then waits for new ones
+**/
+void TrackerMessageThread::operator()(void)
+{
+	CWData data;
+	while(true)
+	{
+		while(to_tracker.pop(data))
+		{
+			tracker_conn->sendToTracker( data );
+		}
+
+		if(os_gettimems()-last_report>=relay_report_interval)
+		{
+			sendRelayReport();
+		}
+
+		os_atomic_store(&waiting, 1);
+		if(to_tracker.empty())
+		{
+			wake.wait(message_wait_time);
+		}
+		os_atomic_store(&waiting, 0);
+	}
+}
+
+/**
+* Send data 'msg' to the tracker. Called by any thread
+**/
+void TrackerMessageThread::sendToTracker(const CWData &msg)
+{
+	to_tracker.push(msg);
+	if(os_atomic_load(&waiting))
+	{
+		wake.signal();
+	}
+}
+
+/**
+* Count 'deferred' messages which waited for bandwidth and 'dropped' messages for which
+* there was no bandwidth. Reported to the tracker periodically. Called by any thread
+**/
+void TrackerMessageThread::addRelayCounts(unsigned int deferred, unsigned int dropped)
+{
+	if(deferred>0)
+		os_atomic_add(&relay_deferred, deferred);
+	if(dropped>0)
+		os_atomic_add(&relay_dropped, dropped);
+}
+
+/**
+* Send the counts of deferred and dropped messages to the tracker if there are any
+**/
+void TrackerMessageThread::sendRelayReport(void)
+{
+	last_report=os_gettimems();
+
+	unsigned int deferred=os_atomic_load(&relay_deferred);
+	unsigned int dropped=os_atomic_load(&relay_dropped);
+	if(deferred==0 && dropped==0)
+		return;
+
+	//Only subtract what is reported, so counts added meanwhile are kept
+	os_atomic_add(&relay_deferred, 0-deferred);
+	os_atomic_add(&relay_dropped, 0-dropped);
+
+	CWData data;
+	data.addUChar(TRACKER_RELAY);
+	data.addUInt(deferred);
+	data.addUInt(dropped);
+	tracker_conn->sendToTracker(data);
+	LOG("Relay: deferred="+nconvert(deferred)+" dropped="+nconvert(dropped), LL_DEBUG);
+}
+
+/**
+* Send data 'msg' to tracker
+**/
+void Controller::sendToTracker(const CWData &msg)
+{
+	tracker_thread->sendToTracker(msg);
+}
+
+/**
+* Returns the round trip time to the server in seconds
+**/
+float Controller::getServerRtt(void)
+{
+	return tracker_conn->getServerRtt();
 }
\ No newline at end of file
@@ -1,129 +1,394 @@
-/**
-* Controller thread. Receives exploration/exploitation UDP messages from other 
-* clients or from the server and forwards them to the next client in the chain
-* or to its children in the tree.
-* If this node is the last client in a exploration packet it sends an acknowledgement
-* via the trackerconnector thread.
-**/
-
-#include "../common/types.h"
-#include "../common/msg_spread.h"
-#include "../common/msg_data.h"
-
-class TrackerConnector;
-class Output;
-
+/**
+* Controller thread. Receives exploration/exploitation UDP messages from other 
+* clients or from the server and forwards them to the next client in the chain
+* or to its children in the tree.
+* If this node is the last client in a exploration packet it sends an acknowledgement
+* via the trackerconnector thread.
+* The messages can be processed by several slice threads. The controller thread then only
+* receives and hands each message to the slice of its id, so the messages of one id stay in order.
+**/
+
+#include "../common/types.h"
+#include "../common/msg_spread.h"
+#include "../common/msg_data.h"
+#include "../common/msg_fec.h"
+#include "../common/msg_stats.h"
+#include "fecdecoder.h"
+#include "../common/spscqueue.h"
+#include "../common/mpscqueue.h"
+#include "../common/wakeevent.h"
+#include "../common/tokenbucket.h"
+#include "../common/replaywindow.h"
+
+class TrackerConnector;
+class Output;
+class Controller;
+class TrackerMessageThread;
+
 #include <boost/thread/thread.hpp>
-#include <boost/thread/condition.hpp>
+#include <boost/thread/condition.hpp>
 #include <boost/bind.hpp>
-
-/**
-* Structure to save UDP messages that are sent asynchroniously
-**/
-struct SSendUDP
-{
-	char *buf;
-	size_t bsize;
-	unsigned int ip;
-	unsigned short port;
-};
-
-/**
-* Thread to send UDP messages and messages to the tracker asynchroniously
-**/
-class SendMessageThread
-{
-public:
-	/**
-	* Initialize the thread with the trackerconnector 'pTracker_conn' and outgoing udp socket 'udpsock'
-	**/
-	SendMessageThread(TrackerConnector *pTracker_conn, SOCKET udpsock);
-
-	/**
-	* Message queue thread
-	**/
-	void operator()(void);
-
-	/**
-	* Send data 'msg' to the tracker
-	**/
-	void sendToTracker(const CWData &msg);
-
-	/**
-	* Send data 'buf' of size 'bsize' to peer with ip 'ip' and port 'port using UDP
-	**/
-	void sendToUDP(const char *buf, size_t bsize, unsigned int ip, unsigned short port);
-
-private:
-
-	//Mutex and condition to lock and notifiy queue changes
-	boost::mutex mutex;
-	boost::condition cond;
-
-	//Data that has to be send to the tracker
-	std::vector<CWData> to_tracker;
-	//Data that has to be send to a peer via udp
-	std::vector<SSendUDP> to_udp;
-
-	//Pointer to the trackerconnector
-	TrackerConnector *tracker_conn;
-	//UDP socket that is used to send the messages
-	SOCKET cs;
-};
-
-/**
-* Thread to receive, forward and acknowledge UDP packets
-**/
-class Controller
-{
-public:
-	/**
-	* Initialize the contorller. It should listen on UDP port 'pPort' and only utilize
-	* bandwidth 'pBandwidth_out' (bytes/s).
-	* With pointer to trackerconnector 'pTracker_conn' and output thread 'pOutput'
-	**/
-	Controller(unsigned short pPort, TrackerConnector *pTracker_conn, unsigned int pBandwidth_out, Output *pOutput);
-
-	/**
-	* main thread function
-	**/
-	void operator()(void);
-
-	/**
-	* Send data 'msg' to tracker
-	**/
-	void sendToTracker(const CWData &msg);
-private:
-	/**
-	* Handle a message that is send through the tree structure
-	**/
-	void ProcessSpreadMsg(msg_spread &msg, CRData &data);
-	/**
-	* Handle exploration messag with multiple hops
-	**/
-	void ProcessDataMsg(msg_data &msg);
-
-	//Pointers to trackerconnector and output thread
-	TrackerConnector *tracker_conn;
-	Output *output;
-
-	//Thread to send messages asynchonously
-	SendMessageThread *message_thread;
-
-	//UDP listen socket
-	SOCKET cs;
-
-	//Port we listen on
-	unsigned short port;
-
-	//Maximal available bandwidth
-	unsigned int bandwidth_max;
-	//Current used bandwidth
-	unsigned int bandwidth_curr;
-	//Next time 'bandwidth_curr' should be set to zero (once per second)
-	unsigned int last_bandwidth_reset;
-
-
-	//Structure to save which packets it already forwarded to its children
-	std::map<unsigned int, bool> packets_forward;
+
+/**
+* Message shared by the sends to several peers. The send that releases it last deletes it
+**/
+struct SSharedBuf
+{
+	char *buf;
+	size_t bsize;
+	volatile unsigned int refs;
+};
+
+/**
+* CPU time in ms a relay thread used. Published by the thread itself, so the statistics can
+* report the busiest thread
+**/
+struct SThreadCpu
+{
+	volatile unsigned int cputime;
+	//Last time the thread published it
+	unsigned int last_update;
+};
+
+/**
+* Structure to save UDP messages that are sent asynchroniously. The message is 'hdr' followed
+* by the shared message without its first 'skip' bytes. Neither is copied again for sending
+**/
+struct SSendUDP
+{
+	SSharedBuf *shared;
+	size_t skip;
+	//Large enough for the header of a message sent through the trees in each wire format version
+	char hdr[sizeof(SWireSpread)];
+	size_t hsize;
+	//Size of the whole message
+	size_t bsize;
+	unsigned int ip;
+	unsigned short port;
+	//Messages sent through the trees have priority over exploration messages
+	bool spread;
+	//Time the message was queued
+	unsigned int qtime;
+};
+
+/**
+* Thread to send UDP messages asynchroniously. Paces them with a token bucket. Messages sent through
+* the trees wait for tokens, exploration messages are dropped if the bucket runs low
+**/
+class SendMessageThread
+{
+public:
+	/**
+	* Initialize the thread with the outgoing udp socket 'udpsock'. It sends at most 'bandwidth' bytes/s
+	* (0 for no limit) and reports deferred and dropped messages via 'pTracker_thread'
+	**/
+	SendMessageThread(SOCKET udpsock, unsigned int bandwidth, TrackerMessageThread *pTracker_thread);
+
+	/**
+	* Message queue thread
+	**/
+	void operator()(void);
+
+	/**
+	* Send data 'buf' of size 'bsize' to peer with ip 'ip' and port 'port using UDP. 'spread' is
+	* true for messages sent through the trees. Called by any thread
+	**/
+	void sendToUDP(const char *buf, size_t bsize, unsigned int ip, unsigned short port, bool spread);
+
+	/**
+	* Send header 'hdr' of size 'hsize' followed by 'shared' without its first 'skip' bytes to peer with
+	* ip 'ip' and port 'port' using UDP. Takes a reference of 'shared'. 'spread' is true for messages
+	* sent through the trees. Called by any thread
+	**/
+	void sendShared(SSharedBuf *shared, const char *hdr, size_t hsize, size_t skip, unsigned int ip, unsigned short port, bool spread);
+
+	/**
+	* Returns the number of messages waiting to be sent. Called by any thread
+	**/
+	unsigned int getQueueDepth(void);
+
+	/**
+	* Returns the CPU time in ms the thread used. Called by any thread
+	**/
+	unsigned int getCpuTime(void);
+
+private:
+	/**
+	* Wait for the tokens of message 'ns'. Returns false if it has to be dropped
+	**/
+	bool pace(const SSendUDP &ns);
+
+	/**
+	* Queue 'ns' and wake the thread
+	**/
+	void queueMessage(const SSendUDP &ns);
+
+	//Data that has to be send to a peer via udp
+	CMPSCQueue<SSendUDP> to_udp;
+	//Number of messages in 'to_udp'
+	volatile unsigned int queued;
+
+	//Paces the messages. NULL if there is no limit
+	CTokenBucket *bucket;
+	//Tokens exploration messages leave for the messages sent through the trees
+	unsigned int explore_reserve;
+
+	//Thread the deferred and dropped messages are reported to
+	TrackerMessageThread *tracker_thread;
+
+	//Set while the thread waits for new messages
+	volatile unsigned int waiting;
+	//Event to wake the thread
+	CWakeEvent wake;
+	//CPU time the thread used
+	SThreadCpu cpu;
+
+	//UDP socket that is used to send the messages
+	SOCKET cs;
+};
+
+/**
+* Thread to send messages to the tracker asynchroniously. Separate from the UDP messages,
+* so a slow tracker connection does not delay the relayed messages
+**/
+class TrackerMessageThread
+{
+public:
+	/**
+	* Initialize the thread with the trackerconnector 'pTracker_conn'
+	**/
+	TrackerMessageThread(TrackerConnector *pTracker_conn);
+
+	/**
+	* Message queue thread
+	**/
+	void operator()(void);
+
+	/**
+	* Send data 'msg' to the tracker. Called by any thread
+	**/
+	void sendToTracker(const CWData &msg);
+
+	/**
+	* Count 'deferred' messages which waited for bandwidth and 'dropped' messages for which
+	* there was no bandwidth. Reported to the tracker periodically. Called by any thread
+	**/
+	void addRelayCounts(unsigned int deferred, unsigned int dropped);
+
+private:
+	/**
+	* Send the counts of deferred and dropped messages to the tracker if there are any
+	**/
+	void sendRelayReport(void);
+
+	//Data that has to be send to the tracker
+	CMPSCQueue<CWData> to_tracker;
+
+	//Deferred and dropped messages since the last report
+	volatile unsigned int relay_deferred;
+	volatile unsigned int relay_dropped;
+	//Last time they were reported
+	unsigned int last_report;
+
+	//Set while the thread waits for new messages
+	volatile unsigned int waiting;
+	//Event to wake the thread
+	CWakeEvent wake;
+
+	//Pointer to the trackerconnector
+	TrackerConnector *tracker_conn;
+};
+
+/**
+* Structure to save a received UDP message until its slice thread processes it
+**/
+struct SRecvUDP
+{
+	char *buf;
+	size_t bsize;
+};
+
+/**
+* Thread to forward and acknowledge the UDP packets of one slice of the message ids
+**/
+class ControllerSlice
+{
+public:
+	/**
+	* Initialize the slice of controller 'pController'. It sends with the udp socket 'udpsock' and
+	* only utilizes bandwidth 'pBandwidth_out' (bytes/s). Receives channel 'pChannel'.
+	* Duplicates are detected within the last 'pDedupe_width' ids
+	**/
+	ControllerSlice(Controller *pController, TrackerConnector *pTracker_conn, TrackerMessageThread *pTracker_thread, SOCKET udpsock, unsigned int pBandwidth_out, unsigned short pChannel, unsigned int pDedupe_width);
+
+	/**
+	* Handle the received message 'buf' of size 'bsize'
+	**/
+	void processMessage(const char *buf, size_t bsize);
+
+	/**
+	* Queue the received message 'buf' of size 'bsize' for the slice thread. Takes ownership of 'buf'.
+	* Only called by the controller thread
+	**/
+	void addMessage(char *buf, size_t bsize);
+
+	/**
+	* Slice thread. Processes the queued messages
+	**/
+	void operator()(void);
+
+	/**
+	* Set 'stats' to the number of messages received, forwarded and dropped as duplicates. Called by any thread
+	**/
+	void getStats(SSliceStats &stats);
+
+	/**
+	* Returns the number of messages waiting to be relayed. Called by any thread
+	**/
+	unsigned int getQueueDepth(void);
+
+	/**
+	* Add the CPU times in ms the slice thread and its send thread used to 'cputimes'. Called by any thread
+	**/
+	void getCpuTimes(std::vector<unsigned int> &cputimes);
+
+private:
+	/**
+	* Handle a message that is send through the tree structure
+	**/
+	void ProcessSpreadMsg(msg_spread &msg, CRData &data);
+	/**
+	* Handle exploration messag with multiple hops
+	**/
+	void ProcessDataMsg(msg_data &msg);
+	/**
+	* Handle a retransmission from the server
+	**/
+	void ProcessResendMsg(msg_spread &msg);
+	/**
+	* Handle a parity message that is send through the tree structure
+	**/
+	void ProcessFecMsg(msg_fec &msg, CRData &data);
+	//Pointers to the controller and the trackerconnector
+	Controller *controller;
+	TrackerConnector *tracker_conn;
+
+	//Thread to send messages asynchonously
+	SendMessageThread *message_thread;
+
+	//Channel we receive. Messages of other channels are dropped
+	unsigned short channel;
+
+
+	//Structure to save which packets it already forwarded to its children
+	CReplayWindow packets_forward;
+	//Structure to save which parity messages it already forwarded to its children
+	CReplayWindow fec_forward;
+	//Last time the duplicate statistic was logged
+	unsigned int last_stats;
+	//Messages received, forwarded and dropped as duplicates. Only written by the slice thread
+	volatile unsigned int received;
+	volatile unsigned int forwarded;
+	volatile unsigned int duplicates;
+
+	//Messages queued by the controller thread
+	CSPSCQueue<SRecvUDP> queue;
+	//Set while the slice thread waits for new messages
+	volatile unsigned int waiting;
+	//Mutex and condition to wake the slice thread
+	boost::mutex mutex;
+	boost::condition cond;
+	//CPU time the slice thread used
+	SThreadCpu cpu;
+};
+
+/**
+* Thread to receive UDP packets. Processes them itself or hands them to the slice threads
+**/
+class Controller
+{
+public:
+	/**
+	* Initialize the contorller. It should listen on UDP port 'pPort' and only utilize
+	* bandwidth 'pBandwidth_out' (bytes/s).
+	* With pointer to trackerconnector 'pTracker_conn' and output thread 'pOutput'.
+	* With 'pSlices' bigger than one, that many slice threads forward the messages.
+	* Duplicates are detected within the last 'pDedupe_width' ids
+	**/
+	Controller(unsigned short pPort, TrackerConnector *pTracker_conn, unsigned int pBandwidth_out, Output *pOutput, unsigned int pSlices, unsigned int pDedupe_width);
+
+	/**
+	* main thread function
+	**/
+	void operator()(void);
+
+	/**
+	* Send data 'msg' to tracker
+	**/
+	void sendToTracker(const CWData &msg);
+
+	/**
+	* Returns the round trip time to the server in seconds
+	**/
+	float getServerRtt(void);
+
+	/**
+	* Pass the received buffer with id 'id' to the output thread and the forward error correction.
+	* Called by the slices
+	**/
+	void addBuffer(unsigned int id, const char *buf, size_t bsize);
+
+	/**
+	* Pass the parity message 'msg' to the forward error correction. Called by the slices
+	**/
+	void addParity(msg_fec &msg);
+
+	/**
+	* Write the statistics message for the tracker to 'data'. Returns false if the slices
+	* are not running yet. Only called by the trackerconnector thread
+	**/
+	bool getStats(CWData &data);
+
+private:
+	/**
+	* Add a received buffer to the forward error correction
+	**/
+	void addFecBuffer(unsigned int id, const char *buf, size_t bsize);
+
+	//Pointers to trackerconnector and output thread
+	TrackerConnector *tracker_conn;
+	Output *output;
+
+	//Thread to send messages to the tracker asynchonously
+	TrackerMessageThread *tracker_thread;
+
+	//UDP listen socket
+	SOCKET cs;
+
+	//Port we listen on
+	unsigned short port;
+
+	//Maximal available bandwidth. Divided across the slices
+	unsigned int bandwidth_max;
+
+	//Slices processing the messages. The id of a message modulo their number selects the slice
+	std::vector<ControllerSlice*> slices;
+	//Number of slice threads. With one the controller thread processes the messages itself
+	unsigned int nslices;
+	//Number of ids in which the slices detect duplicates
+	unsigned int dedupe_width;
+	//Set once the controller thread created the slices
+	volatile unsigned int slices_ready;
+
+	//CPU time the controller thread used
+	SThreadCpu cpu;
+	//Time of the last statistics message and the CPU times of the relay threads then
+	unsigned int last_stats_time;
+	std::vector<unsigned int> last_stats_cputimes;
+
+	//Mutex to pass buffers to the output thread and the forward error correction from one slice at a time
+	boost::mutex buffer_mutex;
+
+	//Recovers lost buffers with the parity messages
+	FecDecoder fec;
 };
\ No newline at end of file
@@ -0,0 +1,149 @@
+/**
+* Recovers lost buffers with the parity messages the server sends through the trees.
+* Every received buffer is added to the parity of its group. Once the parity message of
+* a group is there and exactly one buffer of the group is missing, that buffer is recovered.
+**/
+
+#include "fecdecoder.h"
+#include "output.h"
+#include "../common/msg_fec.h"
+#include "../common/log.h"
+#include "../common/stringtools.h"
+#include <memory.h>
+
+//Maximal number of groups that are kept for recovery
+const size_t fec_max_groups=64;
+
+FecDecoder::FecDecoder(void)
+{
+	group_size=0;
+	recovered=0;
+	max_first_id=0;
+}
+
+FecDecoder::~FecDecoder(void)
+{
+	for(std::map<unsigned int, SFecDecodeGroup*>::iterator it=groups.begin();it!=groups.end();++it)
+	{
+		delete it->second;
+	}
+}
+
+/**
+* Add the received buffer with id 'id'. Returns a recovered buffer or NULL
+**/
+SBufferObject* FecDecoder::addBuffer(unsigned int id, const char *buf, size_t bsize)
+{
+	//No parity received yet
+	if(group_size==0 || id==0)
+		return NULL;
+
+	SFecDecodeGroup *g=getGroup(id-(id-1)%group_size);
+	if(g->done)
+		return NULL;
+
+	if(!g->acc.add(id, buf, bsize))
+		return NULL;
+
+	return tryRecover(g);
+}
+
+/**
+* Add the parity message 'msg'. Returns a recovered buffer or NULL
+**/
+SBufferObject* FecDecoder::addParity(msg_fec &msg)
+{
+	if(msg.hasError() || msg.getGroupSize()>fec_max_group)
+		return NULL;
+
+	group_size=msg.getGroupSize();
+
+	SFecDecodeGroup *g=getGroup(msg.getFirstID());
+	if(g->done || g->has_parity)
+		return NULL;
+
+	g->parity.assign(msg.getBuf(), msg.getBuf()+msg.getBuf_size());
+	g->parity_size_xor=msg.getSizeXor();
+	g->has_parity=true;
+
+	return tryRecover(g);
+}
+
+/**
+* Returns the number of buffers recovered so far
+**/
+unsigned int FecDecoder::getRecovered(void)
+{
+	return recovered;
+}
+
+/**
+* Get the group starting with 'first_id'. Creates it if necessary
+**/
+FecDecoder::SFecDecodeGroup* FecDecoder::getGroup(unsigned int first_id)
+{
+	std::map<unsigned int, SFecDecodeGroup*>::iterator it=groups.find(first_id);
+	if(it!=groups.end())
+	{
+		if(it->second->acc.getGroupSize()==group_size)
+			return it->second;
+
+		//The server changed the group size
+		delete it->second;
+		groups.erase(it);
+	}
+
+	SFecDecodeGroup *g=new SFecDecodeGroup;
+	g->acc.reset(first_id, group_size);
+	g->parity_size_xor=0;
+	g->has_parity=false;
+	g->done=false;
+	groups[first_id]=g;
+	if(groups.size()==1 || (int)(first_id-max_first_id)>0)
+		max_first_id=first_id;
+
+	while(groups.size()>fec_max_groups)
+	{
+		//The group following the newest one is the oldest, also if the ids wrapped around
+		it=groups.upper_bound(max_first_id);
+		if(it==groups.end())
+			it=groups.begin();
+		delete it->second;
+		groups.erase(it);
+	}
+
+	return g;
+}
+
+/**
+* Recover the missing buffer of group 'g' if possible
+**/
+SBufferObject* FecDecoder::tryRecover(SFecDecodeGroup *g)
+{
+	unsigned int missing=g->acc.getMissing();
+	if(missing==0)
+	{
+		g->done=true;
+		g->parity.clear();
+		return NULL;
+	}
+
+	if(!g->has_parity || missing!=1 || g->parity.empty())
+		return NULL;
+
+	unsigned int id;
+	std::vector<char> buf;
+	g->done=true;
+	if(!g->acc.recover(&g->parity[0], g->parity.size(), g->parity_size_xor, id, buf))
+		return NULL;
+
+	++recovered;
+	LOG("Recovered ID="+nconvert(id)+" with parity", LL_DEBUG);
+
+	SBufferObject *obj=new SBufferObject;
+	obj->id=id;
+	obj->bsize=buf.size();
+	obj->buf=new char[obj->bsize];
+	memcpy(obj->buf, &buf[0], obj->bsize);
+	return obj;
+}
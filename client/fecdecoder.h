@@ -0,0 +1,65 @@
+/**
+* Recovers lost buffers with the parity messages the server sends through the trees.
+* Every received buffer is added to the parity of its group. Once the parity message of
+* a group is there and exactly one buffer of the group is missing, that buffer is recovered.
+**/
+
+#include "../common/fec.h"
+#include <map>
+
+class msg_fec;
+struct SBufferObject;
+
+class FecDecoder
+{
+public:
+	FecDecoder(void);
+	~FecDecoder(void);
+
+	/**
+	* Add the received buffer with id 'id'. Returns a recovered buffer or NULL
+	**/
+	SBufferObject* addBuffer(unsigned int id, const char *buf, size_t bsize);
+
+	/**
+	* Add the parity message 'msg'. Returns a recovered buffer or NULL
+	**/
+	SBufferObject* addParity(msg_fec &msg);
+
+	/**
+	* Returns the number of buffers recovered so far
+	**/
+	unsigned int getRecovered(void);
+
+private:
+	/**
+	* Structure to save the state of a group
+	**/
+	struct SFecDecodeGroup
+	{
+		CFecGroup acc;
+		std::vector<char> parity;
+		unsigned short parity_size_xor;
+		bool has_parity;
+		bool done;
+	};
+
+	/**
+	* Get the group starting with 'first_id'. Creates it if necessary
+	**/
+	SFecDecodeGroup* getGroup(unsigned int first_id);
+
+	/**
+	* Recover the missing buffer of group 'g' if possible
+	**/
+	SBufferObject* tryRecover(SFecDecodeGroup *g);
+
+	//Groups by the id of their first buffer
+	std::map<unsigned int, SFecDecodeGroup*> groups;
+	//Id of the first buffer of the newest group
+	unsigned int max_first_id;
+	//Number of buffers in a group. Learned from the parity messages
+	unsigned int group_size;
+	//Number of recovered buffers
+	unsigned int recovered;
+};
@@ -1,74 +1,114 @@
-/**
-* Process entry point. Parse program parameters.
-* Setup and start the threads with these parameters
-**/
-
-#ifdef _WIN32
-#include <windows.h>
-#endif
-#include "trackerconnector.h"
-#include "output.h"
-#include "controller.h"
-#include "../common/settings.h"
-#include "../common/os_functions.h"
-#include "../common/log.h"
-#include <iostream>
-
-#include <boost/thread/thread.hpp>
-#include <boost/thread/mutex.hpp>
-#include <boost/bind.hpp>
-
-const int num_clients=1;
-
-int main(int argc, char* argv[])
-{
-	if(argc<3)
-	{
-		std::cout << "start with qstream_client [tracker] [bandwidth] ([output port] [controller port])" << std::endl;
-		return 1;
-	}
-	unsigned short out_port=output_port;
-	if(argc>3)
-	{
-		out_port=(unsigned short)atoi(argv[3]);
-	}
-	unsigned short controller_port=client_controller_port;
-	if(argc>4)
-	{
-		controller_port=(unsigned short)atoi(argv[4]);
-	}
-
-	//os_sleep(5000);
-
-	for(int i=0;i<num_clients;++i)
-	{
-		TrackerConnector *tracker_conn=new TrackerConnector(argv[1], tracker_port, controller_port+i,(unsigned int)atoi(argv[2]));
-		Output *output=new Output(out_port+i);
-		Controller *controller=new Controller(controller_port+i, tracker_conn, (unsigned int)atoi(argv[2]), output);
-		output->setController(controller);
-
-
-		boost::thread output_thread(boost::ref(*output));
-		output_thread.yield();
-
-		boost::thread controller_thread(boost::ref(*controller));
-		controller_thread.yield();
-
-		if(i+1>=num_clients)
-		{
-			while(true)
-			{
-				(*tracker_conn)();
-				os_sleep(1000);
-				log("Reconnecting to stracker");
-			}
-		}
-		else
-		{
-			boost::thread tracker_thread(boost::ref(*tracker_conn));
-			tracker_thread.yield();
-		}
-	}
-
-	return 0;
-}
+/**
+* Process entry point. Parse program parameters.
+* Setup and start the threads with these parameters
+**/
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "trackerconnector.h"
+#include "output.h"
+#include "controller.h"
+#include "../common/settings.h"
+#include "../common/os_functions.h"
+#include "../common/log.h"
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/bind.hpp>
+
+const int num_clients=1;
+
+int main(int argc, char* argv[])
+{
+	//Options start with "--". The other parameters are positional
+	std::vector<std::string> args;
+	unsigned int slices=1;
+	unsigned int dedupe_width=replay_default_width;
+	unsigned char wire_version=wire_version_2;
+	unsigned char wire_features=wire_feature_peer_index;
+	for(int i=1;i<argc;++i)
+	{
+		std::string arg=argv[i];
+		if(arg.find("--slices=")==0)
+		{
+			slices=(unsigned int)atoi(arg.substr(9).c_str());
+		}
+		else if(arg.find("--dedupe-window=")==0)
+		{
+			dedupe_width=(unsigned int)atoi(arg.substr(16).c_str());
+		}
+		else if(arg.find("--wire-version=")==0)
+		{
+			wire_version=atoi(arg.substr(15).c_str())==1?wire_version_1:wire_version_2;
+		}
+		else if(arg.find("--peer-index=")==0)
+		{
+			wire_features=atoi(arg.substr(13).c_str())==0?0:wire_feature_peer_index;
+		}
+		else
+		{
+			args.push_back(arg);
+		}
+	}
+
+	if(args.size()<2)
+	{
+		std::cout << "start with qstream_client [tracker] [bandwidth] ([output port] [controller port] [channel]) ([--slices=threads forwarding the received messages] [--dedupe-window=number of ids in which duplicates are detected] [--wire-version=1 to announce the old wire format] [--peer-index=0 to receive exploration messages with ip and port only])" << std::endl;
+		return 1;
+	}
+	unsigned short out_port=output_port;
+	if(args.size()>2)
+	{
+		out_port=(unsigned short)atoi(args[2].c_str());
+	}
+	unsigned short controller_port=client_controller_port;
+	if(args.size()>3)
+	{
+		controller_port=(unsigned short)atoi(args[3].c_str());
+	}
+	unsigned short channel=0;
+	if(args.size()>4)
+	{
+		channel=(unsigned short)atoi(args[4].c_str());
+	}
+	unsigned int bandwidth=(unsigned int)atoi(args[1].c_str());
+
+	//os_sleep(5000);
+
+	for(int i=0;i<num_clients;++i)
+	{
+		TrackerConnector *tracker_conn=new TrackerConnector(args[0], tracker_port, controller_port+i, bandwidth, channel, wire_version, wire_features);
+		Output *output=new Output(out_port+i);
+		Controller *controller=new Controller(controller_port+i, tracker_conn, bandwidth, output, slices, dedupe_width);
+		output->setController(controller);
+		tracker_conn->setController(controller);
+
+
+		boost::thread output_thread(boost::ref(*output));
+		output_thread.yield();
+
+		boost::thread controller_thread(boost::ref(*controller));
+		controller_thread.yield();
+
+		if(i+1>=num_clients)
+		{
+			while(true)
+			{
+				(*tracker_conn)();
+				os_sleep(1000);
+				log("Reconnecting to stracker");
+			}
+		}
+		else
+		{
+			boost::thread tracker_thread(boost::ref(*tracker_conn));
+			tracker_thread.yield();
+		}
+	}
+
+	return 0;
+}
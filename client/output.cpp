@@ -1,319 +1,729 @@
-#ifdef _WIN32
-#include <windows.h>
-#endif
-#include "output.h"
-#include "controller.h"
-#include "../common/socket_functions.h"
-#include "../common/os_functions.h"
-#include "../common/log.h"
-#include "../common/stringtools.h"
-#include "../common/data.h"
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "output.h"
+#include "controller.h"
+#include "../common/socket_functions.h"
+#include "../common/os_functions.h"
+#include "../common/log.h"
+#include "../common/stringtools.h"
+#include "../common/data.h"
 #include <string.h>
-#include "../common/packet_ids.h"
-
-/**
-* Initialize output thread. Listen on port 'pPort'
-**/
-Output::Output(unsigned short pPort) : port(pPort)
-{
-	next_id=0;
-	past_id=0;
-	ints=false;
-	tsleft=-1;
-	nack_next=false;
-	time_last=0;
-}
-
-/**
-* Main thread function
-**/
-void Output::operator()(void)
-{
-	SOCKET cs=os_createSocket(false);
-	if(!os_bind(cs, port))
-	{
-		log("error binding socket to port "+nconvert(port));
-		return;
-	}
-
-	os_listen(cs,1000);
-
-	clients.push_back(cs);
-
-	while(true)
-	{
-		std::vector<SOCKET> md=os_select(clients, 1000);
-		for(size_t i=0;i<md.size();++i)
-		{
-			if(md[i]==cs)
-			{
-				log("New Output client");
-				SOCKET ns=os_accept(cs);
-				clients.push_back(ns);
-				const char *vv="HTTP/1.0 200 OK\r\nContent-Type: video/mpeg\r\n\r\n";
-				os_send(ns, vv, strlen(vv));
-			}
-			else
-			{
-				char buffer[4096];
-				int rc=os_recv(md[i],buffer,4096);
-				if(rc<=0)
-				{
-					log("Lost connection to Output client");
-					for(size_t j=0;j<clients.size();++j)
-					{
-						if(clients[j]==md[i])
-						{
-							clients.erase(clients.begin()+j);
-							break;
-						}
-					}
-				}
-			}
-		}
-
-		{
-			if(os_gettimems()-time_last>2000)
-			{
-				if(nack_next==false)
-				{
-					nack_next=true;
-					CWData data;
-					data.addUChar(TRACKER_NACK);
-					data.addUInt(next_id);
-					controller->sendToTracker(data);
-				}
-			}
-
-			boost::mutex::scoped_lock lock(mutex);
-			while(!buffers.empty() && (buffers.begin()->second->id==next_id || next_id==0
-				|| (os_gettimems()-buffers.begin()->second->atime)>3000) )
-			{
-				time_last=os_gettimems();
-				nack_next=false;
-				if(buffers.begin()->second->id!=next_id)
-				{
-					while(!tspackets.empty())
-					{
-						for(size_t i=0;i<tspackets.front().size();++i)
-						{
-							--tspackets.front()[i].ref->refc;
-							if(tspackets.front()[i].ref->refc==0)
-							{
-								delete [] tspackets.front()[i].ref->buf;
-								delete tspackets.front()[i].ref;
-							}
-						}
-						tspackets.pop();
-					}
-					if(stream_ok)
-					{
-						stream_ok=false;
-						log("Stream not okay. Skipped "+nconvert(buffers.begin()->second->id-next_id)+" packets");
-					}
-					ints=false;
-				}
-				else
-				{
-					if(!stream_ok)
-					{
-						stream_ok=true;
-						log("Stream is okay");
-					}
-				}
-				SBufferObject *obj=buffers.begin()->second;
-				past_id=obj->id;
-				next_id=obj->id+1;
-				obj->refc=1;
-				lock.unlock();
-				size_t offset=0;
-				if(ints==false)
-				{
-					for(size_t i=0;i<obj->bsize;++i)
-					{
-						if(obj->buf[i]==0x47 && i+188<obj->bsize && obj->buf[i+188]==0x47 )
-						{
-							TSPacket tsp;
-							tsp.buf=&obj->buf[i];
-							tsp.bsize=188;
-							tsp.ref=obj;
-							++obj->refc;
-							std::vector<TSPacket> tp;
-							tp.push_back(tsp);
-							tspackets.push(tp);
-							offset=i+188;
-							ints=true;
-							break;
-						}
-					}
-				}
-				if(ints==true && !tspackets.empty() && getSize(tspackets.back())<188)
-				{
-					size_t left=188-getSize(tspackets.back());
-					if(left<obj->bsize && obj->buf[left]==0x47)
-					{
-						TSPacket tsp;
-						tsp.buf=obj->buf;
-						tsp.bsize=left;
-						tsp.ref=obj;
-						tspackets.back().push_back(tsp);
-						++obj->refc;
-						offset=left;
-					}
-					else if(left>=obj->bsize)
-					{
-						TSPacket tsp;
-						tsp.buf=obj->buf;
-						tsp.bsize=obj->bsize;
-						tsp.ref=obj;
-						tspackets.back().push_back(tsp);
-						++obj->refc;
-						offset=left;
-					}
-					else
-					{
-						log("OUTPUT: left packet not found");
-						for(size_t i=0;i<tspackets.back().size();++i)
-						{
-							--tspackets.back()[i].ref->refc;
-							if(tspackets.back()[i].ref->refc==0)
-							{
-								delete [] tspackets.back()[i].ref->buf;
-								delete tspackets.back()[i].ref;
-							}
-						}
-						tspackets.back().clear();
-						ints=false;
-					}
-				}
-				if(ints==true && offset<obj->bsize)
-				{
-					while(true)
-					{
-						if(offset<obj->bsize && obj->buf[offset]==0x47)
-						{
-							if(offset+188<obj->bsize && obj->buf[offset+188] )
-							{
-								TSPacket tsp;
-								tsp.buf=&obj->buf[offset];
-								tsp.bsize=188;
-								tsp.ref=obj;
-								++obj->refc;
-								std::vector<TSPacket> tp; tp.push_back(tsp);
-								tspackets.push(tp);
-								offset+=188;
-							}
-							else
-							{
-								TSPacket tsp;
-								tsp.buf=&obj->buf[offset];
-								tsp.bsize=obj->bsize-offset;
-								tsp.ref=obj;
-								++obj->refc;
-								std::vector<TSPacket> tp; tp.push_back(tsp);
-								tspackets.push(tp);
-								break;
-							}
-						}
-						else
-						{
-							log("Offset wrong");
-							ints=false;
-							break;
-						}
-					}
-				}
-
-				while(!tspackets.empty())
-				{
-					if(tspackets.front().empty())
-					{
-						tspackets.pop();
-						continue;
-					}
-
-					if(getSize(tspackets.front())==188)
-					{
-						for(size_t i=1;i<clients.size();++i)
-						{
-							for(size_t k=0;k<tspackets.front().size();++k)
-							{
-								os_send(clients[i], tspackets.front()[k].buf, tspackets.front()[k].bsize);
-							}
-						}
-						for(size_t k=0;k<tspackets.front().size();++k)
-						{
-							--tspackets.front()[k].ref->refc;
-							if(tspackets.front()[k].ref->refc==0)
-							{
-								delete []tspackets.front()[k].ref->buf;
-								delete tspackets.front()[k].ref;
-							}
-						}
-						tspackets.pop();
-					}
-					else
-					{
-						break;
-					}
-				}
-
-				
-				--obj->refc;
-				if(obj->refc==0)
-				{
-					delete [] obj->buf;
-					delete obj;
-				}
-
-				lock.lock();
-				buffers.erase(buffers.begin());
-			}
-		}
-	}
-}
-
-/**
-* Add a buffer that should be send to all connected video players
-**/
-void Output::addBufferObject(SBufferObject *obj)
-{
-	boost::mutex::scoped_lock lock(mutex);
-	obj->atime=os_gettimems();
-	if(obj->id>past_id || past_id==0)
-	{
-		std::map<unsigned int,SBufferObject*>::iterator iter=buffers.find(obj->id);
-		if(iter==buffers.end())
-		{
-			obj->atime=os_gettimems();
-			obj->nack=false;
-			buffers[obj->id]=obj;
-		}
-		else
-		{
-			delete [] obj->buf;
-			delete obj;
-		}
-	}
-}
-
-/**
-* Add a buffer that should be send to all connected video players
-**/
-size_t Output::getSize(const std::vector<TSPacket> &tsp)
-{
-	size_t ret=0;
-	for(size_t i=0;i<tsp.size();++i)
-	{
-		ret+=tsp[i].bsize;
-	}
-	return ret;
-}
-
-/**
-* Set the pointer to the controller thread
-**/
-void Output::setController(Controller *pController)
-{
-	controller=pController;
+#include "../common/packet_ids.h"
+#include "../common/os_atomic.h"
+
+//Minimal and maximal time in ms a missing buffer is waited for before it is nacked
+const unsigned int nack_min_wait=50;
+const unsigned int nack_max_wait=2000;
+//The wait time before nacking is this multiple of the rtt to the server
+const float nack_rtt_factor=1.5f;
+//Maximal number of ids in one nack
+const unsigned int nack_max_ids=32;
+//Minimal and maximal time in ms a missing buffer is waited for before it is skipped
+const unsigned int jitter_min_delay=100;
+const unsigned int jitter_max_delay=3000;
+//Initial mean time in ms a reordered buffer arrives late
+const float jitter_initial_mean=500.f;
+//Gains of the moving averages of the mean and the mean deviation of the lateness
+const float jitter_mean_gain=1.f/8.f;
+const float jitter_dev_gain=1.f/4.f;
+//The playout delay is the mean lateness plus this multiple of the deviation
+const float jitter_dev_factor=4.f;
+//Time in ms the player socket is polled. Buffers are sent to the players in this interval
+const unsigned int output_tick=10;
+//Interval in ms the statistics are logged
+const unsigned int stats_log_interval=10000;
+//Size of the ring all players send from. Has to be a power of two
+const size_t output_ring_size=4*1024*1024;
+//Maximal number of bytes a player may lag behind. If it lags more, its data is
+//dropped and it continues at the next random access point
+const size_t output_max_lag=2*1024*1024;
+//Time in ms a player waits for a random access point after a drop. Then it continues at the next packet
+const unsigned int output_keyframe_wait=5000;
+//Players are disconnected after this many drops
+const unsigned int output_max_drops=5;
+//Players are disconnected if they don't receive data for this many ms
+const unsigned int output_stall_timeout=10000;
+//Number of buffers in the reorder window. Has to be a power of two, so the slot
+//of an id stays the same when the id wraps around
+const unsigned int reorder_window=4096;
+
+/**
+* Initialize output thread. Listen on port 'pPort'
+**/
+Output::Output(unsigned short pPort) : port(pPort)
+{
+	next_id=0;
+	started=0;
+	first_id=0;
+	has_first=0;
+	max_id=0;
+	sync_losses=0;
+	nack_id=0;
+	nack_time=0;
+	time_last=0;
+	jitter_mean=jitter_initial_mean;
+	jitter_dev=0;
+	jitter_delay=(unsigned int)jitter_initial_mean;
+	late_count=0;
+	lost_count=0;
+	last_stats_log=0;
+
+	ring=new char[output_ring_size];
+	ring_pos=0;
+	ring_rai_pos=0;
+	has_rai=false;
+	ring_pat_pos=0;
+	has_pat=false;
+	ring_start_pos=0;
+	has_start=false;
+
+	window=new SWindowSlot[reorder_window];
+	for(unsigned int i=0;i<reorder_window;++i)
+	{
+		window[i].obj=NULL;
+		//i+1 is never saved in slot i
+		window[i].obj_id=i+1;
+		window[i].arrival_id=i+1;
+		window[i].arrival_time=0;
+		window[i].skip_id=i+1;
+		window[i].skip_time=0;
+		window[i].skip_delay=0;
+	}
+}
+
+/**
+* Main thread function
+**/
+void Output::operator()(void)
+{
+	SOCKET cs=os_createSocket(false);
+	if(!os_bind(cs, port))
+	{
+		log("error binding socket to port "+nconvert(port));
+		return;
+	}
+
+	os_listen(cs,1000);
+
+	poller.add(cs, POLL_READ);
+
+	while(true)
+	{
+		poller.wait(output_tick, poll_events);
+		for(size_t i=0;i<poll_events.size();++i)
+		{
+			SOCKET s=poll_events[i].s;
+			if(s==cs)
+			{
+				log("New Output client");
+				SOCKET ns=os_accept(cs);
+				const char *vv="HTTP/1.0 200 OK\r\nContent-Type: video/mpeg\r\n\r\n";
+				os_send(ns, vv, strlen(vv));
+				os_set_nonblocking(ns, true);
+
+				SOutputClient &client=players[ns];
+				client.s=ns;
+				client.cursor=getStartPos();
+				client.lag_max=0;
+				client.writable=true;
+				client.wait_keyframe=false;
+				client.keyframe_after=0;
+				client.wait_start=0;
+				client.drops=0;
+				client.last_send=os_gettimems();
+				poller.add(ns, POLL_READ);
+
+				//Start with the data since the last random access point, so the player can start decoding at once
+				LOG("Output: Sending "+nconvert((size_t)(ring_pos-client.cursor))+" cached bytes to new player", LL_DEBUG);
+				if(!flushPlayer(client))
+				{
+					removePlayer(ns);
+				}
+				continue;
+			}
+
+			std::map<SOCKET, SOutputClient>::iterator it=players.find(s);
+			if(it==players.end())
+				continue;
+
+			if(poll_events[i].events & POLL_READ)
+			{
+				char buffer[4096];
+				int rc=os_recv(s,buffer,4096);
+				if(rc==0 || (rc<0 && !os_would_block()) )
+				{
+					log("Lost connection to Output client");
+					removePlayer(s);
+					continue;
+				}
+			}
+			if(poll_events[i].events & POLL_WRITE)
+			{
+				it->second.writable=true;
+				poller.modify(s, POLL_READ);
+				if(!flushPlayer(it->second))
+				{
+					log("Lost connection to Output client");
+					removePlayer(s);
+				}
+			}
+		}
+
+		{
+			if(!started && os_atomic_load(&has_first))
+			{
+				os_atomic_store(&next_id, first_id);
+				os_atomic_store(&started, 1);
+			}
+
+			sendNacks();
+
+			unsigned int playout_delay=getPlayoutDelayInt();
+			if(os_gettimems()-last_stats_log>stats_log_interval)
+			{
+				last_stats_log=os_gettimems();
+				LOG("Output: playout delay="+nconvert(playout_delay)+"ms late="+nconvert(os_atomic_load(&late_count))+" lost="+nconvert(lost_count), LL_INFO);
+				for(std::map<SOCKET, SOutputClient>::iterator it=players.begin();it!=players.end();++it)
+				{
+					LOG("Output: player "+nconvert(it->first)+" lag="+nconvert((size_t)(ring_pos-it->second.cursor))+" max="+nconvert(it->second.lag_max)+" drops="+nconvert(it->second.drops), LL_INFO);
+					it->second.lag_max=0;
+				}
+			}
+
+			while(started)
+			{
+				unsigned int obj_id;
+				SBufferObject *obj=getFirstWaiting(obj_id);
+				if(obj==NULL || (obj_id!=next_id && os_gettimems()-obj->atime<=playout_delay) )
+					break;
+
+				time_last=os_gettimems();
+				if(obj_id!=next_id)
+				{
+					unsigned int skipped=obj_id-next_id;
+					skipBuffers(obj_id, playout_delay);
+					if(stream_ok)
+					{
+						stream_ok=false;
+						log("Stream not okay. Skipped "+nconvert(skipped)+" packets after "+nconvert(playout_delay)+"ms");
+					}
+					framer.reset();
+				}
+				else
+				{
+					if(!stream_ok)
+					{
+						stream_ok=true;
+						log("Stream is okay");
+					}
+				}
+				//The buffer is taken out of its slot before the new id is published. The controller thread
+				//only removes buffers with ids below 'next_id' from their slots, so it never removes this one.
+				//A duplicate put into the empty slot in between is removed by it later
+				os_atomic_store_ptr(&window[obj_id%reorder_window].obj, (SBufferObject*)NULL);
+				os_atomic_store(&next_id, obj_id+1);
+				send_bufs.clear();
+				framer.frame(obj->buf, obj->bsize, send_bufs);
+				if(framer.getSyncLosses()!=sync_losses)
+				{
+					sync_losses=framer.getSyncLosses();
+					log("Output: Lost the TS sync");
+				}
+				sendToPlayers();
+
+				delete [] obj->buf;
+				delete obj;
+			}
+		}
+	}
+}
+
+/**
+* Add a buffer that should be send to all connected video players.
+* Does not lock and must only be called by one thread at a time (the controller serializes its slices)
+**/
+void Output::addBufferObject(SBufferObject *obj)
+{
+	obj->atime=os_gettimems();
+	obj->nack=false;
+
+	unsigned int base;
+	if(os_atomic_load(&started))
+	{
+		base=os_atomic_load(&next_id);
+	}
+	else if(os_atomic_load(&has_first))
+	{
+		base=first_id;
+	}
+	else
+	{
+		first_id=obj->id;
+		base=obj->id;
+	}
+
+	SWindowSlot &slot=window[obj->id%reorder_window];
+
+	int diff=(int)(obj->id-base);
+	if(diff<0)
+	{
+		if(os_atomic_load(&slot.skip_id)==obj->id)
+		{
+			//The buffer was skipped, so the playout delay was too short
+			os_atomic_add(&late_count, 1);
+			unsigned int skip_time=os_atomic_load(&slot.skip_time);
+			addLateness(os_atomic_load(&slot.skip_delay)+obj->atime-skip_time);
+			LOG("ID="+nconvert(obj->id)+" arrived "+nconvert(obj->atime-skip_time)+"ms after it was skipped", LL_DEBUG);
+		}
+		delete [] obj->buf;
+		delete obj;
+		return;
+	}
+
+	SBufferObject *old=os_atomic_load_ptr(&slot.obj);
+	if(old!=NULL && (int)(base-slot.obj_id)>0 && os_atomic_cas_ptr(&slot.obj, old, (SBufferObject*)NULL) )
+	{
+		//A buffer whose id was already sent or skipped still occupies the slot. The output
+		//thread only uses buffers with ids from 'next_id' on, so it can be removed
+		delete [] old->buf;
+		delete old;
+	}
+
+	if(diff>=(int)reorder_window || os_atomic_load_ptr(&slot.obj)!=NULL)
+	{
+		//Too far ahead or a duplicate
+		delete [] obj->buf;
+		delete obj;
+		return;
+	}
+
+	if(os_atomic_load(&has_first) && (int)(max_id-obj->id)>0)
+	{
+		//The buffer arrived after a buffer with a higher id. The time since
+		//that one arrived is how long the buffer was waited for
+		for(unsigned int k=obj->id+1;(int)(max_id-k)>=0 && k-obj->id<reorder_window;++k)
+		{
+			SWindowSlot &higher=window[k%reorder_window];
+			if(higher.arrival_id==k)
+			{
+				addLateness(obj->atime-higher.arrival_time);
+				break;
+			}
+		}
+	}
+	else
+	{
+		os_atomic_store(&max_id, obj->id);
+	}
+
+	slot.arrival_id=obj->id;
+	slot.arrival_time=obj->atime;
+	os_atomic_store(&slot.obj_id, obj->id);
+	os_atomic_store_ptr(&slot.obj, obj);
+
+	if(!os_atomic_load(&has_first))
+	{
+		os_atomic_store(&has_first, 1);
+	}
+	else if((int)(obj->id-os_atomic_load(&next_id))<0 && os_atomic_load(&started)
+		&& os_atomic_cas_ptr(&slot.obj, obj, (SBufferObject*)NULL) )
+	{
+		//The output thread sent or skipped this id in the meantime
+		delete [] obj->buf;
+		delete obj;
+	}
+}
+
+/**
+* Returns the time in ms a missing buffer is waited for, before it is nacked
+**/
+unsigned int Output::getNackWait(void)
+{
+	float rtt=controller->getServerRtt();
+	if(rtt<=0)
+		return nack_max_wait;
+
+	unsigned int wait=(unsigned int)(rtt*1000.f*nack_rtt_factor+0.5f);
+	if(wait<nack_min_wait)
+		return nack_min_wait;
+	if(wait>nack_max_wait)
+		return nack_max_wait;
+	return wait;
+}
+
+/**
+* Request retransmissions of the buffers missing before the first waiting buffer.
+* Only called by the output thread
+**/
+void Output::sendNacks(void)
+{
+	if(!started)
+		return;
+
+	unsigned int ctime=os_gettimems();
+	unsigned int nack_wait=getNackWait();
+	unsigned int wait_id;
+	SBufferObject *first=getFirstWaiting(wait_id);
+	if(first==NULL)
+	{
+		//Nothing received at all. Only ask for the next buffer now and then
+		if(ctime-time_last<=nack_max_wait || ctime-nack_time<=nack_max_wait)
+			return;
+		wait_id=next_id+1;
+	}
+	else
+	{
+		//Wait if there is no gap or if the missing buffers might only be reordered
+		if(wait_id==next_id || ctime-first->atime<=nack_wait)
+			return;
+	}
+
+	//Don't nack buffers again, unless the retransmission got lost as well
+	unsigned int start=next_id;
+	if((int)(nack_id-next_id)>=0 && ctime-nack_time<=2*nack_wait)
+		start=nack_id+1;
+
+	if((int)(start-wait_id)>=0)
+		return;
+
+	CWData data;
+	data.addUChar(TRACKER_NACK);
+	unsigned int n=0;
+	for(unsigned int id=start;(int)(wait_id-id)>0 && n<nack_max_ids;++id,++n)
+	{
+		data.addUInt(id);
+	}
+	nack_id=start+n-1;
+	nack_time=ctime;
+	controller->sendToTracker(data);
+}
+
+/**
+* Add the time in ms 'lateness' a buffer arrived after a buffer with a higher id to
+* the jitter statistic. Only called by the controller thread
+**/
+void Output::addLateness(unsigned int lateness)
+{
+	float diff=(float)lateness-jitter_mean;
+	jitter_mean+=jitter_mean_gain*diff;
+	if(diff<0)
+		diff=-diff;
+	jitter_dev+=jitter_dev_gain*(diff-jitter_dev);
+
+	os_atomic_store(&jitter_delay, (unsigned int)(jitter_mean+jitter_dev_factor*jitter_dev+0.5f));
+}
+
+/**
+* Returns the time in ms a missing buffer is waited for, before it is skipped.
+* It is long enough for reordered buffers to arrive and for a retransmission
+* to be requested and received
+**/
+unsigned int Output::getPlayoutDelayInt(void)
+{
+	unsigned int delay=os_atomic_load(&jitter_delay);
+
+	float rtt=controller->getServerRtt();
+	if(rtt>0)
+	{
+		unsigned int resend_delay=getNackWait()+(unsigned int)(rtt*1000.f*nack_rtt_factor+0.5f);
+		if(resend_delay>delay)
+			delay=resend_delay;
+	}
+
+	if(delay<jitter_min_delay)
+		return jitter_min_delay;
+	if(delay>jitter_max_delay)
+		return jitter_max_delay;
+	return delay;
+}
+
+/**
+* Returns the time in ms a missing buffer is currently waited for before it is skipped
+**/
+unsigned int Output::getPlayoutDelay(void)
+{
+	return getPlayoutDelayInt();
+}
+
+/**
+* Returns the number of buffers which arrived after they were skipped
+**/
+unsigned int Output::getLateCount(void)
+{
+	return os_atomic_load(&late_count);
+}
+
+/**
+* Returns the number of buffers which were skipped
+**/
+unsigned int Output::getLostCount(void)
+{
+	return os_atomic_load(&lost_count);
+}
+
+/**
+* Returns how late in ms buffers arrive after buffers with higher ids (mean plus deviations)
+**/
+unsigned int Output::getJitter(void)
+{
+	return os_atomic_load(&jitter_delay);
+}
+
+/**
+* Returns the waiting buffer with the lowest id and sets 'id' to it. Returns NULL if there is none.
+* Only called by the output thread
+**/
+SBufferObject* Output::getFirstWaiting(unsigned int &id)
+{
+	unsigned int last=os_atomic_load(&max_id);
+	for(unsigned int k=next_id;(int)(last-k)>=0 && k-next_id<reorder_window;++k)
+	{
+		SWindowSlot &slot=window[k%reorder_window];
+		//Buffers with other ids may be removed by the controller thread at any time, so only the id of
+		//the slot is compared. It is read again, in case the buffer was replaced in the meantime.
+		//Buffers inserted after their id was skipped are removed by the controller thread
+		if(os_atomic_load(&slot.obj_id)!=k)
+			continue;
+		SBufferObject *obj=os_atomic_load_ptr(&slot.obj);
+		if(obj!=NULL && os_atomic_load(&slot.obj_id)==k)
+		{
+			id=k;
+			return obj;
+		}
+	}
+	return NULL;
+}
+
+/**
+* Skip the missing buffers before the buffer with id 'id'. Saves the time of the skip
+* in their slots, so buffers arriving late can be detected. Only called by the output thread
+**/
+void Output::skipBuffers(unsigned int id, unsigned int playout_delay)
+{
+	unsigned int ctime=os_gettimems();
+	for(unsigned int k=next_id;k!=id;++k)
+	{
+		SWindowSlot &slot=window[k%reorder_window];
+		os_atomic_store(&slot.skip_time, ctime);
+		os_atomic_store(&slot.skip_delay, playout_delay);
+		os_atomic_store(&slot.skip_id, k);
+	}
+	os_atomic_add(&lost_count, id-next_id);
+	os_atomic_store(&next_id, id);
+}
+
+/**
+* Add the packets in 'send_bufs' to the ring and send them to all players. Each player sends
+* from its own position in the ring, so the data is only copied once. Players which are too slow
+* are dropped to the next random access point or disconnected
+**/
+void Output::sendToPlayers(void)
+{
+	if(!send_bufs.empty())
+	{
+		addToRing(&send_bufs[0], send_bufs.size());
+	}
+
+	std::vector<SOCKET> to_remove;
+	unsigned int ctime=os_gettimems();
+	for(std::map<SOCKET, SOutputClient>::iterator it=players.begin();it!=players.end();++it)
+	{
+		SOutputClient &client=it->second;
+		if(client.writable && !flushPlayer(client))
+		{
+			to_remove.push_back(it->first);
+			continue;
+		}
+
+		size_t lag=(size_t)(ring_pos-client.cursor);
+		if(lag>client.lag_max)
+			client.lag_max=lag;
+
+		if(!client.wait_keyframe && lag>output_max_lag)
+		{
+			if(!dropPlayerData(client))
+				to_remove.push_back(it->first);
+		}
+		else if(client.wait_keyframe && client.cursor%ts_packet_size!=0 && lag>output_ring_size-output_max_lag)
+		{
+			log("Output: Player "+nconvert(it->first)+" doesn't finish its packet. Disconnecting");
+			to_remove.push_back(it->first);
+		}
+		else if(!client.writable && ctime-client.last_send>output_stall_timeout)
+		{
+			log("Output: Player "+nconvert(it->first)+" didn't receive data for "+nconvert(output_stall_timeout)+"ms. Disconnecting");
+			to_remove.push_back(it->first);
+		}
+	}
+
+	for(size_t i=0;i<to_remove.size();++i)
+	{
+		removePlayer(to_remove[i]);
+	}
+}
+
+/**
+* Copy the 'count' buffers 'bufs' to the ring and remember the latest random access point
+**/
+void Output::addToRing(const SSendBuf *bufs, size_t count)
+{
+	for(size_t i=0;i<count;++i)
+	{
+		for(size_t off=0;off+ts_packet_size<=bufs[i].bsize;off+=ts_packet_size)
+		{
+			const char *pkt=bufs[i].buf+off;
+			if(ts_is_pat_start(pkt))
+			{
+				ring_pat_pos=ring_pos+off;
+				has_pat=true;
+			}
+			if(ts_is_random_access(pkt))
+			{
+				ring_rai_pos=ring_pos+off;
+				has_rai=true;
+				ring_start_pos=has_pat?ring_pat_pos:ring_rai_pos;
+				has_start=true;
+			}
+		}
+
+		size_t done=0;
+		while(done<bufs[i].bsize)
+		{
+			size_t rpos=(size_t)(ring_pos%output_ring_size);
+			size_t n=bufs[i].bsize-done;
+			if(n>output_ring_size-rpos)
+				n=output_ring_size-rpos;
+			memcpy(&ring[rpos], bufs[i].buf+done, n);
+			done+=n;
+			ring_pos+=n;
+		}
+	}
+}
+
+/**
+* Send as much data from the ring to player 'client' as possible. Returns false if the player should be disconnected
+**/
+bool Output::flushPlayer(SOutputClient &client)
+{
+	boost::uint64_t end=ring_pos;
+	if(client.wait_keyframe)
+	{
+		size_t partial=(size_t)(client.cursor%ts_packet_size);
+		if(partial!=0)
+		{
+			//Finish the packet which was partially sent
+			end=client.cursor+ts_packet_size-partial;
+		}
+		else if(has_rai && ring_rai_pos>=client.keyframe_after)
+		{
+			log("Output: Player "+nconvert(client.s)+" continues at random access point");
+			client.cursor=getStartPos();
+			client.wait_keyframe=false;
+		}
+		else if(os_gettimems()-client.wait_start>output_keyframe_wait)
+		{
+			log("Output: No random access point in the stream. Player "+nconvert(client.s)+" continues at the next packet");
+			client.cursor=ring_pos;
+			client.wait_keyframe=false;
+		}
+		else
+		{
+			client.last_send=os_gettimems();
+			return true;
+		}
+	}
+
+	size_t n=(size_t)(end-client.cursor);
+	if(n==0)
+	{
+		client.last_send=os_gettimems();
+		return true;
+	}
+
+	SSendBuf sb[2];
+	size_t rpos=(size_t)(client.cursor%output_ring_size);
+	sb[0].buf=&ring[rpos];
+	sb[0].bsize=n;
+	size_t count=1;
+	if(n>output_ring_size-rpos)
+	{
+		sb[0].bsize=output_ring_size-rpos;
+		sb[1].buf=ring;
+		sb[1].bsize=n-sb[0].bsize;
+		count=2;
+	}
+
+	int rc=os_sendv(client.s, sb, count);
+	if(rc<0)
+	{
+		if(!os_would_block())
+			return false;
+		rc=0;
+	}
+
+	if(rc>0)
+	{
+		client.cursor+=rc;
+		client.last_send=os_gettimems();
+	}
+
+	if((size_t)rc<n)
+	{
+		client.writable=false;
+		poller.modify(client.s, POLL_READ|POLL_WRITE);
+	}
+	return true;
+}
+
+/**
+* Drop the data not sent to player 'client' yet. It continues at the next random access point.
+* Returns false if the player should be disconnected
+**/
+bool Output::dropPlayerData(SOutputClient &client)
+{
+	++client.drops;
+	if(client.drops>output_max_drops)
+	{
+		log("Output: Player "+nconvert(client.s)+" is too slow. Disconnecting");
+		return false;
+	}
+
+	log("Output: Player "+nconvert(client.s)+" is too slow. Dropping "+nconvert((size_t)(ring_pos-client.cursor))+" bytes");
+	client.wait_keyframe=true;
+	client.keyframe_after=ring_pos;
+	client.wait_start=os_gettimems();
+	return true;
+}
+
+/**
+* Returns the ring position a player should start sending at. This is the last program association
+* table before the latest random access point, if the data since then is still in the ring
+**/
+boost::uint64_t Output::getStartPos(void)
+{
+	if(has_start && ring_pos-ring_start_pos<=output_max_lag)
+		return ring_start_pos;
+	else if(has_rai && ring_pos-ring_rai_pos<=output_max_lag)
+		return ring_rai_pos;
+	else
+		return ring_pos;
+}
+
+/**
+* Disconnect the player with socket 's'
+**/
+void Output::removePlayer(SOCKET s)
+{
+	poller.remove(s);
+	os_closesocket(s);
+	players.erase(s);
+}
+
+/**
+* Set the pointer to the controller thread
+**/
+void Output::setController(Controller *pController)
+{
+	controller=pController;
 }
\ No newline at end of file
@@ -1,102 +1,214 @@
-/**
-* Output thread. Listens on a TCP socket and sends the
-* video stream to all applications who connect to it.
-**/
-
-#include <map>
-#include <vector>
-#include <queue>
-#include <boost/thread/mutex.hpp>
-#include "../common/types.h"
-
-class Controller;
-
-/**
-* Structure to save a buffer
-**/
-struct SBufferObject
-{
-	bool operator<(const SBufferObject &other)
-	{
-		return id<other.id;
-	}
-	unsigned int id;
-	char *buf;
-	size_t bsize;
-	unsigned int atime;
-	int refc;
-	bool nack;
-};
-
-/**
-* Structure to save a pointer to a ts(transport stream) packet
-**/
-struct TSPacket
-{
-	char *buf;
-	size_t bsize;
-	SBufferObject *ref;
-};
-
-/**
-* output thread class
-**/
-class Output
-{
-public:
-	/**
-	* Initialize output thread. Listen on port 'pPort'
-	**/
-	Output(unsigned short pPort);
-
-	/**
-	* Main thread function
-	**/
-	void operator()(void);
-
-	/**
-	* Add a buffer that should be send to all connected video players
-	**/
-	void addBufferObject(SBufferObject *obj);
-
-	/**
-	* Set the pointer to the controller thread
-	**/
-	void setController(Controller *pController);
-
-private:
-	// Id of the buffer which should be send next
-	unsigned int next_id;
-	// Id of the last buffer sent
-	unsigned int past_id;
-	// If true send a nack if 'next_id' is not present in time
-	bool nack_next;
-	// Time at which the last next buffer was present
-	unsigned int time_last;
-
-	//Port the output thread is listeing on
-	unsigned short port;
-
-	//True if there are no skipped packets
-	bool stream_ok;
-
-	//Returns the size of an accumulation of ts packets
-	size_t getSize(const std::vector<TSPacket> &tsp);
-
-
-	//Synchonize accesses to the buffers
-	boost::mutex mutex;
-	//True if we're in the middle of a ts packet
-	bool ints;
-	//Number of bytes left in the current ts packet
-	int tsleft;
-	//Structure to save received buffers
-	std::map<unsigned int,SBufferObject*> buffers;
-	//Queue of tspackets to be send
-	std::queue<std::vector<TSPacket> > tspackets;
-	//List of client sockets (clients here are the video players)
-	std::vector<SOCKET> clients;
-
-	//Pointer to the controller thread
-	Controller *controller;
+/**
+* Output thread. Listens on a TCP socket and sends the
+* video stream to all applications who connect to it.
+**/
+
+#include <map>
+#include <vector>
+#include <queue>
+#include <stddef.h>
+#include "../common/types.h"
+#include "../common/tspacket.h"
+#include "../common/poller.h"
+#include <boost/cstdint.hpp>
+
+class Controller;
+
+/**
+* Structure to save a buffer
+**/
+struct SBufferObject
+{
+	bool operator<(const SBufferObject &other)
+	{
+		return id<other.id;
+	}
+	unsigned int id;
+	char *buf;
+	size_t bsize;
+	unsigned int atime;
+	bool nack;
+};
+
+/**
+* Structure to save a connected video player
+**/
+struct SOutputClient
+{
+	SOCKET s;
+	//Position in the ring of the next byte to send
+	boost::uint64_t cursor;
+	//Maximal number of bytes not sent yet since the statistics were logged
+	size_t lag_max;
+	//True if the socket accepts data. Otherwise the player waits for it to become writable
+	bool writable;
+	//True if data was dropped and the player waits for the next random access point
+	//after ring position 'keyframe_after'. Waiting started at 'wait_start'
+	bool wait_keyframe;
+	boost::uint64_t keyframe_after;
+	unsigned int wait_start;
+	//Number of times data was dropped
+	unsigned int drops;
+	//Time data was sent last or there was nothing to send
+	unsigned int last_send;
+};
+
+/**
+* Slot of the reorder window. The buffer with id 'id' is saved in slot 'id' modulo the window size
+**/
+struct SWindowSlot
+{
+	//Buffer waiting to be sent. Set by the controller thread and cleared by the output thread
+	SBufferObject * volatile obj;
+	//Id of 'obj'. Written by the controller thread before 'obj' is set, so the output thread
+	//can check the id without accessing a buffer the controller thread may remove
+	volatile unsigned int obj_id;
+	//Id and time of the last buffer which arrived for this slot. Only used by the controller thread
+	unsigned int arrival_id;
+	unsigned int arrival_time;
+	//Id of the last buffer skipped for this slot, the time of the skip and the playout
+	//delay then. Written by the output thread
+	volatile unsigned int skip_id;
+	volatile unsigned int skip_time;
+	volatile unsigned int skip_delay;
+};
+
+/**
+* output thread class
+**/
+class Output
+{
+public:
+	/**
+	* Initialize output thread. Listen on port 'pPort'
+	**/
+	Output(unsigned short pPort);
+
+	/**
+	* Main thread function
+	**/
+	void operator()(void);
+
+	/**
+	* Add a buffer that should be send to all connected video players.
+	* Does not lock and must only be called by one thread at a time (the controller serializes its slices)
+	**/
+	void addBufferObject(SBufferObject *obj);
+
+	/**
+	* Set the pointer to the controller thread
+	**/
+	void setController(Controller *pController);
+
+	/**
+	* Returns the time in ms a missing buffer is currently waited for before it is skipped
+	**/
+	unsigned int getPlayoutDelay(void);
+
+	/**
+	* Returns the number of buffers which arrived after they were skipped
+	**/
+	unsigned int getLateCount(void);
+
+	/**
+	* Returns the number of buffers which were skipped
+	**/
+	unsigned int getLostCount(void);
+
+	/**
+	* Returns how late in ms buffers arrive after buffers with higher ids (mean plus deviations)
+	**/
+	unsigned int getJitter(void);
+
+private:
+	// Id of the buffer which should be send next. Written by the output thread
+	volatile unsigned int next_id;
+	// True if the output thread started sending
+	volatile unsigned int started;
+	// Id of the first buffer which arrived and if it is set. Written by the controller thread
+	unsigned int first_id;
+	volatile unsigned int has_first;
+	// Highest id which arrived. Written by the controller thread
+	volatile unsigned int max_id;
+	// Highest id a nack was sent for
+	unsigned int nack_id;
+	// Time the last nack was sent
+	unsigned int nack_time;
+	// Time at which the last next buffer was present
+	unsigned int time_last;
+
+	//Port the output thread is listeing on
+	unsigned short port;
+
+	//True if there are no skipped packets
+	bool stream_ok;
+
+	//Returns the time in ms a missing buffer is waited for, before it is nacked
+	unsigned int getNackWait(void);
+	//Request retransmissions of the buffers missing before the first waiting buffer
+	void sendNacks(void);
+	//Returns the time in ms a missing buffer is waited for, before it is skipped
+	unsigned int getPlayoutDelayInt(void);
+	//Add the time in ms 'lateness' a buffer arrived after a buffer with a higher id to the jitter statistic
+	void addLateness(unsigned int lateness);
+	//Returns the waiting buffer with the lowest id and sets 'id' to it. Returns NULL if there is none
+	SBufferObject* getFirstWaiting(unsigned int &id);
+	//Skip the missing buffers before the buffer with id 'id'
+	void skipBuffers(unsigned int id, unsigned int playout_delay);
+	//Add the packets in 'send_bufs' to the ring and send them to all players
+	void sendToPlayers(void);
+	//Copy the 'count' buffers 'bufs' to the ring
+	void addToRing(const SSendBuf *bufs, size_t count);
+	//Send as much data from the ring to player 'client' as possible. Returns false if the player should be disconnected
+	bool flushPlayer(SOutputClient &client);
+	//Drop the data not sent to player 'client' yet. Returns false if the player should be disconnected
+	bool dropPlayerData(SOutputClient &client);
+	//Returns the ring position a player should start sending at
+	boost::uint64_t getStartPos(void);
+	//Disconnect the player with socket 's'
+	void removePlayer(SOCKET s);
+
+	//Mean and mean deviation of the time buffers arrive after buffers with higher ids.
+	//Only used by the controller thread
+	float jitter_mean;
+	float jitter_dev;
+	//Playout delay computed from the jitter statistic. Written by the controller thread
+	volatile unsigned int jitter_delay;
+	//Number of buffers which arrived after they were skipped
+	volatile unsigned int late_count;
+	//Number of skipped buffers
+	volatile unsigned int lost_count;
+	//Time the statistics were logged last
+	unsigned int last_stats_log;
+
+	//Circular window of received buffers
+	SWindowSlot *window;
+	//Cuts the buffers into ts packets
+	CTSFramer framer;
+	//Number of times the ts sync was lost
+	unsigned int sync_losses;
+	//Runs of ts packets to be send
+	std::vector<SSendBuf> send_bufs;
+	//Connected video players by their socket
+	std::map<SOCKET, SOutputClient> players;
+	//Waits for new players and for players which can receive data
+	CPoller poller;
+	std::vector<SPollEvent> poll_events;
+	//Ring of ts packets all players send from
+	char *ring;
+	//Number of bytes written to the ring. Ring position p is at ring[p%output_ring_size]
+	boost::uint64_t ring_pos;
+	//Ring position of the latest packet with the random access indicator set
+	boost::uint64_t ring_rai_pos;
+	bool has_rai;
+	//Ring position of the latest program association table
+	boost::uint64_t ring_pat_pos;
+	bool has_pat;
+	//Ring position players can start decoding at. This is the last program association table
+	//before the latest random access point
+	boost::uint64_t ring_start_pos;
+	bool has_start;
+
+	//Pointer to the controller thread
+	Controller *controller;
 };
\ No newline at end of file
@@ -0,0 +1,161 @@
+/**
+* Measures how many relayed packets per second can look up their children. Compares the
+* locked copy getPeers returned before the child tables with TrackerConnector::getPeers. Not installed.
+* Start with relaybench ([trees] [children per tree] [threads] [ms per measurement])
+**/
+
+#include "trackerconnector.h"
+#include "../common/os_functions.h"
+#include "../common/os_atomic.h"
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+
+/**
+* The children lookup before the child tables: locks and returns a copy of the children
+**/
+class COldChildren
+{
+public:
+	/**
+	* Set the children in tree 'k' of 'slices' trees to 'nodes'
+	**/
+	void setChildren(int k, int slices, const std::vector<SRelayNode> &nodes)
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		if((int)peers.size()!=slices)
+		{
+			peers.resize(slices);
+		}
+		peers[k]=nodes;
+	}
+
+	/**
+	* Returns a copy of the children for a message with id 'msgid'
+	**/
+	std::vector<SRelayNode> getPeers(unsigned int msgid)
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		if(peers.empty())
+			return std::vector<SRelayNode>();
+
+		return peers[msgid%peers.size()];
+	}
+
+private:
+	std::vector<std::vector<SRelayNode> > peers;
+	boost::mutex mutex;
+};
+
+/**
+* Thread relaying packets with consecutive ids until 'stop' is set. Reads the
+* address of every child, like the sends to them do
+**/
+template<class T>
+class CRelayWorker
+{
+public:
+	CRelayWorker(T *pChildren, volatile unsigned int *pStop, unsigned int pFirst_id)
+		: children(pChildren), stop(pStop), first_id(pFirst_id), packets(0), sum(0)
+	{
+	}
+
+	void operator()(void)
+	{
+		unsigned int id=first_id;
+		while(!os_atomic_load(stop))
+		{
+			for(unsigned int i=0;i<1000;++i,++id)
+			{
+				const std::vector<SRelayNode> &peers=children->getPeers(id);
+				for(size_t j=0;j<peers.size();++j)
+				{
+					sum+=peers[j].ip+peers[j].port;
+				}
+			}
+			packets+=1000;
+		}
+	}
+
+	T *children;
+	volatile unsigned int *stop;
+	unsigned int first_id;
+	double packets;
+	unsigned int sum;
+};
+
+/**
+* Relay with 'nthreads' threads looking up their children in 'children' for 'duration' ms.
+* Prints the packets per second
+**/
+template<class T>
+static void measure(const std::string &name, T *children, unsigned int nthreads, unsigned int duration)
+{
+	volatile unsigned int stop=0;
+	std::vector<CRelayWorker<T>*> workers;
+	boost::thread_group threads;
+	unsigned int start=os_gettimems();
+	for(unsigned int i=0;i<nthreads;++i)
+	{
+		workers.push_back(new CRelayWorker<T>(children, &stop, i*1000000));
+		threads.create_thread(boost::ref(*workers[i]));
+	}
+	os_sleep(duration);
+	os_atomic_store(&stop, 1);
+	threads.join_all();
+	unsigned int ms=os_gettimems()-start;
+
+	double packets=0;
+	for(size_t i=0;i<workers.size();++i)
+	{
+		packets+=workers[i]->packets;
+		delete workers[i];
+	}
+	if(ms==0)
+		ms=1;
+	std::cout << name << ": " << (unsigned int)(packets*1000.0/ms+0.5) << " packets/s" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	int trees=32;
+	unsigned int nchildren=4;
+	unsigned int nthreads=1;
+	unsigned int duration=1000;
+	if(argc>1)
+		trees=atoi(argv[1]);
+	if(argc>2)
+		nchildren=(unsigned int)atoi(argv[2]);
+	if(argc>3)
+		nthreads=(unsigned int)atoi(argv[3]);
+	if(argc>4)
+		duration=(unsigned int)atoi(argv[4]);
+	if(trees<1 || nthreads<1)
+	{
+		std::cout << "Start with relaybench ([trees] [children per tree] [threads] [ms per measurement])" << std::endl;
+		return 1;
+	}
+
+	COldChildren old_children;
+	TrackerConnector tracker_conn("127.0.0.1", 0, 0, 0, 0, wire_version_2, 0);
+	for(int k=0;k<trees;++k)
+	{
+		std::vector<SRelayNode> nodes(nchildren);
+		for(unsigned int i=0;i<nchildren;++i)
+		{
+			nodes[i].ip=0x0100007f+(i<<24);
+			nodes[i].port=(unsigned short)(17000+k*nchildren+i);
+			nodes[i].version=wire_version_2;
+		}
+		old_children.setChildren(k, trees, nodes);
+		tracker_conn.setChildren(k, trees, nodes);
+	}
+	std::cout << trees << " trees, " << nchildren << " children, " << nthreads << " threads" << std::endl;
+
+	measure("relay locked copy", &old_children, nthreads, duration);
+	measure("relay child table", &tracker_conn, nthreads, duration);
+	return 0;
+}
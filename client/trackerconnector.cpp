@@ -1,138 +1,272 @@
-#ifdef _WIN32
-#include <windows.h>
-#endif
-#include "trackerconnector.h"
-#include "../common/socket_functions.h"
-#include "../common/log.h"
-#include "../common/stringtools.h"
-#include "../common/data.h"
-#include "../common/packet_ids.h"
-#include "../common/msg_tree.h"
-
-/**
-* Initialize the tracker connector by giving the name of the tracker (ip or dns-name) 'pTracker' the port on which the tracker
-* accepts tcp connections, the port which is used by this client to receive udp packets and the bandwidth this client has to
-* forward packets.
-**/
-TrackerConnector::TrackerConnector(std::string pTracker, unsigned short pTrackerport, unsigned short pControllerport, unsigned int pBandwidth_out)
-: tracker(pTracker), trackerport(pTrackerport), controllerport(pControllerport), bandwidth_out(pBandwidth_out)
-{
-
-}
-
-/**
-* Main thread function
-**/
-void TrackerConnector::operator()(void)
-{
-	unsigned int trackerip=os_resolv(tracker);
-	cs=os_createSocket(false);
-	bool b=os_connect(cs, trackerip, trackerport);
-	if(!b)
-	{
-		log("Could not connect to tracker "+tracker+" on port "+nconvert(trackerport));
-		os_closesocket(cs);
-		return;
-	}
-
-	log("Connected to tracker.");
-	os_nagle(cs, false);
-
-	{
-		CWData msg;
-		msg.addUChar(TRACKER_PORT);
-		msg.addUShort(controllerport);
-		msg.addUInt(bandwidth_out);
-		stack.Send(cs,msg);
-	}
-
-	while(true)
-	{
-		char buffer[4096];
-		int rc=os_recv(cs, buffer, 4096);
-		if(rc<=0)
-		{
-			log("Connection to tracker lost!");
-			os_closesocket(cs);
-			return;
-		}
-		else
-		{
-			stack.AddData(buffer, rc);
-			size_t bsize;
-			char *buf;
-			while( (buf=stack.getPacket(&bsize))!=NULL)
-			{
-				CRData msg(buf, bsize);
-				receivePacket(msg);
-				delete []buf;
-			}
-		}
-	}
-}
-
-/**
-* Returns a list of ip,port pairs of children for a message with id 'msgid'. The msgid is used to
-* calculate which slice the message is in.
-**/
-std::vector<std::pair<unsigned int, unsigned short> > TrackerConnector::getPeers(unsigned int msgid)
-{
-	boost::mutex::scoped_lock lock(mutex);
-	if(peers.empty())
-		return std::vector<std::pair<unsigned int, unsigned short> >();
-
-	int k=msgid%peers.size();
-	if(k<(int)peers.size())
-	{
-		return peers[k];
-	}
-	else
-	{
-		return std::vector<std::pair<unsigned int, unsigned short> >();
-	}
-}
-
-/**
-* Handle the message 'msg' received from the tracker
-**/
-void TrackerConnector::receivePacket(CRData &msg)
-{
-	unsigned char type;
-	if(msg.getUChar(&type) )
-	{
-		switch(type)
-		{
-		case TRACKER_PING:
-			{
-				CWData repl;
-				repl.addUChar(TRACKER_PONG);
-				stack.Send(cs, repl);
-			}break;
-		case TRACKER_TREE:
-			{
-				msg_tree tree(msg);
-				if(!tree.hasError())
-				{
-					boost::mutex::scoped_lock lock(mutex);
-					if(peers.size()!=tree.getSlices())
-					{
-						peers.resize(tree.getSlices());
-					}
-					peers[tree.getK()]=tree.getRelayNodes();
-				}
-				else
-				{
-					log("tree message has error");
-				}
-			};
-		}
-	}
-}
-
-/**
-* Send data 'data' to the tracker using the TCP connection
-**/
-void TrackerConnector::sendToTracker(CWData &data)
-{
-	stack.Send(cs, data);
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "trackerconnector.h"
+#include "controller.h"
+#include "../common/socket_functions.h"
+#include "../common/log.h"
+#include "../common/stringtools.h"
+#include "../common/data.h"
+#include "../common/packet_ids.h"
+#include "../common/msg_tree.h"
+#include "../common/msg_peers.h"
+#include "../common/os_functions.h"
+#include "../common/os_atomic.h"
+
+//Time in ms a replaced child table is kept, so controller threads still using it can finish
+const unsigned int child_table_grace=5000;
+//Interval in ms in which the statistics are sent to the tracker
+const unsigned int client_stats_interval=5000;
+
+//Returned if there are no children
+static const std::vector<SRelayNode> no_children;
+
+/**
+* Initialize the tracker connector by giving the name of the tracker (ip or dns-name) 'pTracker' the port on which the tracker
+* accepts tcp connections, the port which is used by this client to receive udp packets, the bandwidth this client has to
+* forward packets and the channel 'pChannel' it subscribes to. It announces that it understands wire format version 'pWire_version'
+* and the features 'pWire_features' of version 2.
+**/
+TrackerConnector::TrackerConnector(std::string pTracker, unsigned short pTrackerport, unsigned short pControllerport, unsigned int pBandwidth_out, unsigned short pChannel, unsigned char pWire_version, unsigned char pWire_features)
+: tracker(pTracker), trackerport(pTrackerport), controllerport(pControllerport), bandwidth_out(pBandwidth_out), channel(pChannel), wire_version(pWire_version), wire_features(pWire_features)
+{
+	if(wire_version<wire_version_2)
+	{
+		wire_features=0;
+	}
+	peer_index=NULL;
+	if(wire_features & wire_feature_peer_index)
+	{
+		peer_index=new CPeerIndex;
+	}
+	tracker_version=wire_version_1;
+	server_rtt=0;
+	controller=NULL;
+	last_stats=os_gettimems();
+	children=new SChildTable;
+	children->retired=0;
+}
+
+/**
+* Main thread function
+**/
+void TrackerConnector::operator()(void)
+{
+	unsigned int trackerip=os_resolv(tracker);
+	cs=os_createSocket(false);
+	bool b=os_connect(cs, trackerip, trackerport);
+	if(!b)
+	{
+		log("Could not connect to tracker "+tracker+" on port "+nconvert(trackerport));
+		os_closesocket(cs);
+		return;
+	}
+
+	log("Connected to tracker.");
+	os_nagle(cs, false);
+
+	{
+		CWData msg;
+		msg.addUChar(TRACKER_PORT);
+		msg.addUShort(controllerport);
+		msg.addUInt(bandwidth_out);
+		msg.addUShort(channel);
+		msg.addUChar(wire_version);
+		if(wire_version>=wire_version_2)
+		{
+			msg.addUChar(wire_features);
+		}
+		stack.Send(cs,msg);
+	}
+
+	while(true)
+	{
+		char buffer[4096];
+		int rc=os_recv(cs, buffer, 4096);
+		if(rc<=0)
+		{
+			log("Connection to tracker lost!");
+			os_closesocket(cs);
+			return;
+		}
+		else
+		{
+			stack.AddData(buffer, rc);
+			size_t bsize;
+			char *buf;
+			while( (buf=stack.getPacket(&bsize))!=NULL)
+			{
+				CRData msg(buf, bsize);
+				receivePacket(msg);
+				delete []buf;
+			}
+		}
+	}
+}
+
+/**
+* Returns the children for a message with id 'msgid'. The msgid is used to
+* calculate which slice the message is in. Does not lock. The list stays valid for at least
+* 'child_table_grace' ms, so it has to be used right away.
+**/
+const std::vector<SRelayNode>& TrackerConnector::getPeers(unsigned int msgid)
+{
+	SChildTable *table=os_atomic_load_ptr(&children);
+	if(table->peers.empty())
+		return no_children;
+
+	return table->peers[msgid%table->peers.size()];
+}
+
+/**
+* Set the children in tree 'k' of 'slices' trees to 'nodes'. Publishes a new table. Only called
+* by the tracker connector thread
+**/
+void TrackerConnector::setChildren(int k, int slices, const std::vector<SRelayNode> &nodes)
+{
+	//Only this thread replaces the table, so it is copied without locking
+	SChildTable *table=children;
+	SChildTable *nt=new SChildTable(*table);
+	if((int)nt->peers.size()!=slices)
+	{
+		nt->peers.resize(slices);
+	}
+	nt->peers[k]=nodes;
+	os_atomic_store_ptr(&children, nt);
+
+	unsigned int ctime=os_gettimems();
+	table->retired=ctime;
+	retired_tables.push_back(table);
+	while(!retired_tables.empty() && ctime-retired_tables.front()->retired>child_table_grace)
+	{
+		delete retired_tables.front();
+		retired_tables.pop_front();
+	}
+}
+
+/**
+* Handle the message 'msg' received from the tracker
+**/
+void TrackerConnector::receivePacket(CRData &msg)
+{
+	unsigned char type;
+	if(msg.getUChar(&type) )
+	{
+		unsigned char version=wire_version_1;
+		if(type==wire_v2_marker)
+		{
+			version=wire_version_2;
+			if(!msg.getUChar(&type))
+				return;
+		}
+
+		switch(type)
+		{
+		case TRACKER_PING:
+			{
+				float rtt;
+				if(msg.getFloat(&rtt) && rtt>0)
+				{
+					boost::mutex::scoped_lock lock(mutex);
+					server_rtt=rtt;
+				}
+				CWData repl;
+				repl.addUChar(TRACKER_PONG);
+				stack.Send(cs, repl);
+
+				//The statistics are sent with the pongs, so they need no timer
+				unsigned int ctime=os_gettimems();
+				if(controller!=NULL && ctime-last_stats>=client_stats_interval)
+				{
+					last_stats=ctime;
+					CWData stats;
+					if(controller->getStats(stats))
+					{
+						stack.Send(cs, stats);
+					}
+				}
+			}break;
+		case TRACKER_TREE:
+			{
+				msg_tree tree(msg, version);
+				if(!tree.hasError() && tree.getChannel()==channel && tree.getK()>=0 && tree.getK()<tree.getSlices())
+				{
+					os_atomic_store(&tracker_version, version);
+					setChildren(tree.getK(), tree.getSlices(), tree.getRelayNodes());
+				}
+				else
+				{
+					log("tree message has error");
+				}
+			}break;
+		case TRACKER_PEERS:
+			{
+				if(version!=wire_version_2 || peer_index==NULL)
+					break;
+				msg_peers peers(msg);
+				if(!peers.hasError() && peers.getChannel()==channel)
+				{
+					const std::vector<SIndexedPeer> &np=peers.getPeers();
+					for(size_t i=0;i<np.size();++i)
+					{
+						peer_index->set(np[i].index, np[i].ip, np[i].port);
+					}
+				}
+				else
+				{
+					log("peer index message has error");
+				}
+			}break;
+		}
+	}
+}
+
+/**
+* Send data 'data' to the tracker using the TCP connection
+**/
+void TrackerConnector::sendToTracker(CWData &data)
+{
+	stack.Send(cs, data);
+}
+
+/**
+* Returns the round trip time to the server the tracker measured (in seconds)
+**/
+float TrackerConnector::getServerRtt(void)
+{
+	boost::mutex::scoped_lock lock(mutex);
+	return server_rtt;
+}
+
+/**
+* Returns the channel this client subscribed to
+**/
+unsigned short TrackerConnector::getChannel(void)
+{
+	return channel;
+}
+
+/**
+* Returns the version of the wire format the tracker understands. Known after its first tree message
+**/
+unsigned char TrackerConnector::getTrackerVersion(void)
+{
+	return (unsigned char)os_atomic_load(&tracker_version);
+}
+
+/**
+* Returns the peers of the channel by the index the tracker assigned them. NULL if
+* this client doesn't resolve peer indices
+**/
+CPeerIndex* TrackerConnector::getPeerIndex(void)
+{
+	return peer_index;
+}
+
+/**
+* Set the controller whose statistics are sent to the tracker
+**/
+void TrackerConnector::setController(Controller *pController)
+{
+	controller=pController;
 }
\ No newline at end of file
@@ -1,59 +1,128 @@
-/**
-* Thread that connects itself to the tracker. Announces the port this clients listens for UDP packets and the
-* bandwidth it thinks it is able to handle. Receives the children of this node fore different stream slices
-* and responds to pings.
-**/
-#include "../common/types.h"
-#include "../common/tcpstack.h"
-#include "../common/data.h"
-#include <boost/thread/mutex.hpp>
-
-class TrackerConnector
-{
-public:
-	/**
-	* Initialize the tracker connector by giving the name of the tracker (ip or dns-name) 'pTracker' the port on which the tracker
-	* accepts tcp connections, the port which is used by this client to receive udp packets and the bandwidth this client has to
-	* forward packets.
-	**/
-	TrackerConnector(std::string pTracker, unsigned short pTrackerport, unsigned short pControllerport, unsigned int pBandwidth_out);
-
-	/**
-	* Main thread function
-	**/
-	void operator()(void);
-
-	/**
-	* Returns a list of ip,port pairs of children for a message with id 'msgid'. The msgid is used to
-	* calculate which slice the message is in.
-	**/
-	std::vector<std::pair<unsigned int, unsigned short> > getPeers(unsigned int msgid);
-
-	/**
-	* Send data 'data' to the tracker using the TCP connection
-	**/
-	void sendToTracker(CWData &data);
-
-private:
-	/**
-	* Handle the message 'msg' received from the tracker
-	**/
-	void receivePacket(CRData &msg);
-
-	//name of the tracker
-	std::string tracker;
-	//tcp port of the tracker
-	unsigned short trackerport;
-	//port this clients listens for UDP packets
-	unsigned short controllerport;
-	//List of children this node has for each of the k trees. The List of children consists of ip, port pairs
-	std::vector<std::vector<std::pair<unsigned int, unsigned short> > > peers;
-	//Mutex to synchonize accesses to the class that handles tcp packeting
-	boost::mutex mutex;
-	//class to packetize tcp messages
-	CTCPStack stack;
-	//tcp socket
-	SOCKET cs;
-	//Available bandwidth
-	unsigned int bandwidth_out;
+/**
+* Thread that connects itself to the tracker. Announces the port this clients listens for UDP packets, the
+* bandwidth it thinks it is able to handle and the channel it wants to receive. Receives the children of this node fore different stream slices
+* and responds to pings.
+**/
+#include "../common/types.h"
+#include "../common/tcpstack.h"
+#include "../common/data.h"
+#include "../common/wire.h"
+#include "../common/peerindex.h"
+#include <boost/thread/mutex.hpp>
+#include <deque>
+
+class Controller;
+
+/**
+* Children of this node in each of the trees. A table is never changed after it was published.
+* Each tree message publishes a new one, so the controller reads the children without locking
+**/
+struct SChildTable
+{
+	//List of children for each of the k trees
+	std::vector<std::vector<SRelayNode> > peers;
+	//Time the table was replaced by a newer one
+	unsigned int retired;
+};
+
+class TrackerConnector
+{
+public:
+	/**
+	* Initialize the tracker connector by giving the name of the tracker (ip or dns-name) 'pTracker' the port on which the tracker
+	* accepts tcp connections, the port which is used by this client to receive udp packets, the bandwidth this client has to
+	* forward packets and the channel 'pChannel' it subscribes to. It announces that it understands wire format version 'pWire_version'
+	* and the features 'pWire_features' of version 2.
+	**/
+	TrackerConnector(std::string pTracker, unsigned short pTrackerport, unsigned short pControllerport, unsigned int pBandwidth_out, unsigned short pChannel, unsigned char pWire_version, unsigned char pWire_features);
+
+	/**
+	* Main thread function
+	**/
+	void operator()(void);
+
+	/**
+	* Returns the children for a message with id 'msgid'. The msgid is used to
+	* calculate which slice the message is in. Does not lock. The list stays valid for at least
+	* 'child_table_grace' ms, so it has to be used right away.
+	**/
+	const std::vector<SRelayNode>& getPeers(unsigned int msgid);
+
+	/**
+	* Set the children in tree 'k' of 'slices' trees to 'nodes'. Publishes a new table. Only called
+	* by the tracker connector thread
+	**/
+	void setChildren(int k, int slices, const std::vector<SRelayNode> &nodes);
+
+	/**
+	* Send data 'data' to the tracker using the TCP connection
+	**/
+	void sendToTracker(CWData &data);
+
+	/**
+	* Returns the round trip time to the server the tracker measured (in seconds)
+	**/
+	float getServerRtt(void);
+
+	/**
+	* Returns the channel this client subscribed to
+	**/
+	unsigned short getChannel(void);
+
+	/**
+	* Returns the version of the wire format the tracker understands. Known after its first tree message
+	**/
+	unsigned char getTrackerVersion(void);
+
+	/**
+	* Returns the peers of the channel by the index the tracker assigned them. NULL if
+	* this client doesn't resolve peer indices
+	**/
+	CPeerIndex* getPeerIndex(void);
+
+	/**
+	* Set the controller whose statistics are sent to the tracker
+	**/
+	void setController(Controller *pController);
+
+private:
+	/**
+	* Handle the message 'msg' received from the tracker
+	**/
+	void receivePacket(CRData &msg);
+
+	//name of the tracker
+	std::string tracker;
+	//tcp port of the tracker
+	unsigned short trackerport;
+	//port this clients listens for UDP packets
+	unsigned short controllerport;
+	//Current children of this node. Replaced by the tracker connector thread
+	SChildTable * volatile children;
+	//Replaced tables. Deleted once no controller thread can use them anymore
+	std::deque<SChildTable*> retired_tables;
+	//Mutex to synchonize accesses to the round trip time
+	boost::mutex mutex;
+	//class to packetize tcp messages
+	CTCPStack stack;
+	//tcp socket
+	SOCKET cs;
+	//Available bandwidth
+	unsigned int bandwidth_out;
+	//Round trip time to the server. Sent by the tracker with each ping
+	float server_rtt;
+	//Channel this client receives
+	unsigned short channel;
+	//Version of the wire format this client announces
+	unsigned char wire_version;
+	//Features of version 2 this client announces
+	unsigned char wire_features;
+	//Peers by their index. Filled by the tracker connector thread
+	CPeerIndex *peer_index;
+	//Version of the wire format the tracker sent the tree messages in
+	volatile unsigned int tracker_version;
+	//Controller whose statistics are sent to the tracker
+	Controller *controller;
+	//Last time the statistics were sent
+	unsigned int last_stats;
 };
\ No newline at end of file
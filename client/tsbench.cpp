@@ -0,0 +1,299 @@
+/**
+* Measures how fast received buffers are cut into transport stream packets. Compares the
+* byte-wise framing the output used before CTSFramer with CTSFramer. Not installed.
+* Start with tsbench [ts file] ([buffer size] [ms per measurement])
+**/
+
+#include "../common/tspacket.h"
+#include "../common/os_functions.h"
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+* A part of a packet in a buffer
+**/
+struct SPacketPart
+{
+	const char *buf;
+	size_t bsize;
+};
+
+/**
+* The framing of the output before CTSFramer: searches sync bytes one byte at a time
+* and queues every packet as its own list of parts. Sending is replaced by counting
+**/
+class COldFramer
+{
+public:
+	COldFramer(void)
+	{
+		ints=false;
+	}
+
+	/**
+	* Frame the buffer 'buf' of size 'bsize'. Returns the number of bytes of the complete packets
+	**/
+	size_t frame(const char *buf, size_t bsize)
+	{
+		size_t offset=0;
+		if(ints==false)
+		{
+			for(size_t i=0;i<bsize;++i)
+			{
+				if(buf[i]==0x47 && i+188<bsize && buf[i+188]==0x47 )
+				{
+					SPacketPart tsp;
+					tsp.buf=&buf[i];
+					tsp.bsize=188;
+					std::vector<SPacketPart> tp;
+					tp.push_back(tsp);
+					tspackets.push(tp);
+					offset=i+188;
+					ints=true;
+					break;
+				}
+			}
+		}
+		if(ints==true && !tspackets.empty() && getSize(tspackets.back())<188)
+		{
+			size_t left=188-getSize(tspackets.back());
+			if(left<bsize && buf[left]==0x47)
+			{
+				SPacketPart tsp;
+				tsp.buf=buf;
+				tsp.bsize=left;
+				tspackets.back().push_back(tsp);
+				offset=left;
+			}
+			else if(left>=bsize)
+			{
+				SPacketPart tsp;
+				tsp.buf=buf;
+				tsp.bsize=bsize;
+				tspackets.back().push_back(tsp);
+				offset=left;
+			}
+			else
+			{
+				tspackets.back().clear();
+				ints=false;
+			}
+		}
+		if(ints==true && offset<bsize)
+		{
+			while(true)
+			{
+				if(offset<bsize && buf[offset]==0x47)
+				{
+					SPacketPart tsp;
+					tsp.buf=&buf[offset];
+					std::vector<SPacketPart> tp;
+					if(offset+188<bsize && buf[offset+188])
+					{
+						tsp.bsize=188;
+						tp.push_back(tsp);
+						tspackets.push(tp);
+						offset+=188;
+					}
+					else
+					{
+						tsp.bsize=bsize-offset;
+						tp.push_back(tsp);
+						tspackets.push(tp);
+						break;
+					}
+				}
+				else
+				{
+					ints=false;
+					break;
+				}
+			}
+		}
+
+		size_t ret=0;
+		while(!tspackets.empty())
+		{
+			if(tspackets.front().empty())
+			{
+				tspackets.pop();
+				continue;
+			}
+			if(getSize(tspackets.front())==188)
+			{
+				ret+=188;
+				tspackets.pop();
+			}
+			else
+			{
+				break;
+			}
+		}
+		return ret;
+	}
+
+private:
+	size_t getSize(const std::vector<SPacketPart> &tsp)
+	{
+		size_t ret=0;
+		for(size_t i=0;i<tsp.size();++i)
+		{
+			ret+=tsp[i].bsize;
+		}
+		return ret;
+	}
+
+	bool ints;
+	std::queue<std::vector<SPacketPart> > tspackets;
+};
+
+/**
+* Print the throughput of 'bytes' processed in 'ms'
+**/
+static void printRate(const std::string &name, double bytes, unsigned int ms)
+{
+	if(ms==0)
+		ms=1;
+	std::cout << name << ": " << (unsigned int)(bytes/1000.0/ms+0.5) << " MB/s" << std::endl;
+}
+
+/**
+* The sync search of the output before CTSFramer
+**/
+static size_t bytewise_find_sync(const char *buf, size_t bsize)
+{
+	for(size_t i=0;i<bsize;++i)
+	{
+		if(buf[i]==0x47 && i+188<bsize && buf[i+188]==0x47 )
+			return i;
+	}
+	return bsize;
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc<2)
+	{
+		std::cout << "Start with tsbench [ts file] ([buffer size] [ms per measurement])" << std::endl;
+		return 1;
+	}
+	size_t bsize=1316;
+	unsigned int duration=1000;
+	if(argc>2)
+		bsize=(size_t)atoi(argv[2]);
+	if(argc>3)
+		duration=(unsigned int)atoi(argv[3]);
+	if(bsize==0)
+		return 1;
+
+	std::vector<char> file;
+	FILE *f=fopen(argv[1], "rb");
+	if(f==NULL)
+	{
+		std::cout << "Could not open " << argv[1] << std::endl;
+		return 1;
+	}
+	char rbuf[65536];
+	size_t rc;
+	while((rc=fread(rbuf, 1, sizeof(rbuf), f))>0)
+	{
+		file.insert(file.end(), rbuf, rbuf+rc);
+	}
+	fclose(f);
+	if(file.size()<bsize)
+	{
+		std::cout << "File is smaller than one buffer" << std::endl;
+		return 1;
+	}
+	size_t nbufs=file.size()/bsize;
+	std::cout << "file size " << file.size() << ", buffer size " << bsize << std::endl;
+
+	//Both framers have to find the same packets
+	size_t old_bytes=0;
+	size_t new_bytes=0;
+	{
+		COldFramer old_framer;
+		CTSFramer framer;
+		std::vector<SSendBuf> out;
+		for(size_t i=0;i<nbufs;++i)
+		{
+			old_bytes+=old_framer.frame(&file[i*bsize], bsize);
+			out.clear();
+			framer.frame(&file[i*bsize], bsize, out);
+			for(size_t j=0;j<out.size();++j)
+			{
+				new_bytes+=out[j].bsize;
+			}
+		}
+		std::cout << "packet bytes: old " << old_bytes << ", CTSFramer " << new_bytes << std::endl;
+	}
+
+	{
+		COldFramer old_framer;
+		double bytes=0;
+		unsigned int start=os_gettimems();
+		while(os_gettimems()-start<duration)
+		{
+			for(size_t i=0;i<nbufs;++i)
+			{
+				old_framer.frame(&file[i*bsize], bsize);
+			}
+			bytes+=(double)nbufs*bsize;
+		}
+		printRate("frame old", bytes, os_gettimems()-start);
+	}
+
+	{
+		CTSFramer framer;
+		std::vector<SSendBuf> out;
+		double bytes=0;
+		unsigned int start=os_gettimems();
+		while(os_gettimems()-start<duration)
+		{
+			for(size_t i=0;i<nbufs;++i)
+			{
+				out.clear();
+				framer.frame(&file[i*bsize], bsize, out);
+			}
+			bytes+=(double)nbufs*bsize;
+		}
+		printRate("frame CTSFramer", bytes, os_gettimems()-start);
+	}
+
+	//Searching the sync after it was lost. The file without its sync bytes is scanned
+	{
+		std::vector<char> nosync(file);
+		for(size_t i=0;i<nosync.size();++i)
+		{
+			if(nosync[i]==ts_sync_byte)
+				nosync[i]=0;
+		}
+
+		double bytes=0;
+		size_t found=0;
+		unsigned int start=os_gettimems();
+		while(os_gettimems()-start<duration)
+		{
+			found+=bytewise_find_sync(&nosync[0], nosync.size());
+			bytes+=(double)nosync.size();
+		}
+		printRate("sync search old", bytes, os_gettimems()-start);
+
+		bytes=0;
+		start=os_gettimems();
+		while(os_gettimems()-start<duration)
+		{
+			found+=ts_find_sync(&nosync[0], nosync.size(), 0);
+			bytes+=(double)nosync.size();
+		}
+		printRate("sync search ts_find_sync", bytes, os_gettimems()-start);
+		if(found==0)
+			return 1;
+	}
+
+	return old_bytes==new_bytes?0:1;
+}
@@ -1,91 +1,162 @@
 #include <memory.h>
 #include "data.h"
 
+//Bytes the heap storage starts with
+const size_t cwdata_min_capacity=64;
+
+CWData::CWData(void)
+{
+	buf=NULL;
+	capacity=0;
+	size=0;
+}
+
+/**
+* Write into 'pBuf' of size 'pBsize', e.g. a buffer on the stack. If the data does not
+* fit anymore it is moved to the heap. 'pBuf' has to live as long as this object.
+* Copies always use the heap
+**/
+CWData::CWData(char *pBuf, size_t pBsize)
+{
+	buf=pBuf;
+	capacity=pBsize;
+	size=0;
+}
+
+CWData::CWData(const CWData &other)
+{
+	buf=NULL;
+	capacity=0;
+	size=0;
+	addBuffer(other.buf, other.size);
+}
+
+CWData& CWData::operator=(const CWData &other)
+{
+	if(this!=&other)
+	{
+		size=0;
+		addBuffer(other.buf, other.size);
+	}
+	return *this;
+}
 
 char* CWData::getDataPtr(void)
 {
-	if(data.size()>0)
-		return &data[0];
+	if(size>0)
+		return buf;
 	else
 		return NULL;
 }
 
 unsigned long CWData::getDataSize(void)
 {
-	return (unsigned long)data.size();
+	return (unsigned long)size;
+}
+
+/**
+* Make room for 'n' bytes in total, so adding them does not reallocate
+**/
+void CWData::reserve(size_t n)
+{
+	if(n<=capacity)
+		return;
+
+	if(heap.empty() && size>0)
+	{
+		//Move the data from the buffer given to the constructor to the heap
+		std::vector<char> nheap(n);
+		memcpy(&nheap[0], buf, size);
+		heap.swap(nheap);
+	}
+	else
+	{
+		heap.resize(n);
+	}
+	buf=&heap[0];
+	capacity=n;
+}
+
+/**
+* Remove the data but keep the memory, so the object can be reused
+**/
+void CWData::clear(void)
+{
+	size=0;
+}
+
+/**
+* Returns a pointer to 'n' bytes appended to the data
+**/
+char* CWData::append(size_t n)
+{
+	if(size+n>capacity)
+	{
+		size_t ncapacity=capacity*2;
+		if(ncapacity<size+n)
+			ncapacity=size+n;
+		if(ncapacity<cwdata_min_capacity)
+			ncapacity=cwdata_min_capacity;
+		reserve(ncapacity);
+	}
+	char *ret=buf+size;
+	size+=n;
+	return ret;
 }
 
 void CWData::addInt(int ta)
 {
-	size_t cpos=data.size();
-	data.resize(cpos+sizeof(int) );
-	memcpy(&data[cpos],&ta,sizeof(int) );
+	memcpy(append(sizeof(int)),&ta,sizeof(int) );
 }
 
 void CWData::addUInt(unsigned int ta)
 {
-	size_t cpos=data.size();
-	data.resize(cpos+sizeof(unsigned int) );
-	memcpy(&data[cpos],&ta,sizeof(unsigned int) );
+	memcpy(append(sizeof(unsigned int)),&ta,sizeof(unsigned int) );
 }
 
 void CWData::addInt64(_i64 ta)
 {
-	size_t cpos=data.size();
-	data.resize(cpos+sizeof(_i64) );
-	memcpy(&data[cpos],&ta,sizeof(_i64) );
+	memcpy(append(sizeof(_i64)),&ta,sizeof(_i64) );
 }
 
 void CWData::addFloat(float ta)
 {
-	size_t cpos=data.size();
-	data.resize(cpos+sizeof(float) );
-	memcpy(&data[cpos],&ta,sizeof(float) );
+	memcpy(append(sizeof(float)),&ta,sizeof(float) );
 }
 
 void CWData::addUShort(unsigned short ta)
 {
-	size_t cpos=data.size();
-	data.resize(cpos+sizeof(unsigned short) );
-	memcpy(&data[cpos],&ta,sizeof(unsigned short) );
+	memcpy(append(sizeof(unsigned short)),&ta,sizeof(unsigned short) );
 }	
 
 void CWData::addString(std::string ta)
 {
-	size_t cpos=data.size();
-	data.resize(cpos+sizeof(unsigned int)+ta.size() );
 	unsigned int len=(unsigned int)ta.size();
-	memcpy(&data[cpos], &len, sizeof(unsigned int) );
-	cpos+=sizeof(unsigned int);
-	memcpy(&data[cpos],ta.c_str(), ta.size() );
+	char *p=append(sizeof(unsigned int)+ta.size());
+	memcpy(p, &len, sizeof(unsigned int) );
+	memcpy(p+sizeof(unsigned int),ta.c_str(), ta.size() );
 }
 
 void CWData::addChar(char ta)
 {
-	size_t cpos=data.size();
-	data.resize(cpos+sizeof(char) );
-	data[cpos]=ta;
+	*append(sizeof(char))=ta;
 }
 
 void CWData::addUChar(unsigned char ta)
 {
-	size_t cpos=data.size();
-	data.resize(cpos+sizeof(unsigned char) );
-	data[cpos]=ta;
+	*append(sizeof(unsigned char))=(char)ta;
 }
 
 void CWData::addVoidPtr(void* ta)
 {
-	size_t cpos=data.size();
-	data.resize(cpos+sizeof(void*) );
-	memcpy(&data[cpos],&ta,sizeof(void*) );
+	memcpy(append(sizeof(void*)),&ta,sizeof(void*) );
 }
 
 void CWData::addBuffer(const char* buffer, size_t bsize)
 {
-	size_t cpos=data.size();
-	data.resize(cpos+bsize);
-	memcpy(&data[cpos], buffer, bsize);
+	if(bsize==0)
+		return;
+	memcpy(append(bsize), buffer, bsize);
 }
 
 CRData::CRData(const char* c,size_t datalength, bool pCopy)
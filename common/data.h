@@ -6,12 +6,34 @@
 
 typedef long long int _i64;
 
+//Size of stack buffers for UDP messages. Larger messages are moved to the heap
+const size_t cwdata_stack_size=1600;
+
 class CWData
 {
 public:
+	CWData(void);
+	/**
+	* Write into 'pBuf' of size 'pBsize', e.g. a buffer on the stack. If the data does not
+	* fit anymore it is moved to the heap. 'pBuf' has to live as long as this object.
+	* Copies always use the heap
+	**/
+	CWData(char *pBuf, size_t pBsize);
+	CWData(const CWData &other);
+	CWData& operator=(const CWData &other);
+
 	char* getDataPtr(void);
 	unsigned long getDataSize(void);
 
+	/**
+	* Make room for 'n' bytes in total, so adding them does not reallocate
+	**/
+	void reserve(size_t n);
+	/**
+	* Remove the data but keep the memory, so the object can be reused
+	**/
+	void clear(void);
+
 	void addInt(int ta);
 	void addUInt(unsigned int ta);
 	void addInt64(_i64 ta);
@@ -24,7 +46,16 @@ public:
 	void addBuffer(const char* buffer, size_t bsize);
 
 private:
-	std::vector<char> data;
+	/**
+	* Returns a pointer to 'n' bytes appended to the data
+	**/
+	char* append(size_t n);
+
+	//Memory that is written to. Either the buffer given to the constructor or 'heap'
+	char *buf;
+	size_t capacity;
+	size_t size;
+	std::vector<char> heap;
 };
 
 class CRData
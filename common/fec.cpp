@@ -0,0 +1,148 @@
+/**
+* Forward error correction using xor parity. One parity buffer protects a group
+* of consecutive buffers and allows the recovery of one lost buffer per group.
+**/
+
+#include "fec.h"
+#include <memory.h>
+
+/**
+* Xor 'len' bytes of 'src' into 'dst'
+**/
+void fec_xor(char *dst, const char *src, size_t len)
+{
+	size_t i=0;
+	//Work on whole words. The compiler can vectorize this loop
+	for(;i+sizeof(size_t)<=len;i+=sizeof(size_t))
+	{
+		size_t a, b;
+		memcpy(&a, dst+i, sizeof(size_t));
+		memcpy(&b, src+i, sizeof(size_t));
+		a^=b;
+		memcpy(dst+i, &a, sizeof(size_t));
+	}
+	for(;i<len;++i)
+	{
+		dst[i]^=src[i];
+	}
+}
+
+CFecGroup::CFecGroup(void)
+{
+	reset(0, 0);
+}
+
+/**
+* Start a new group with the buffers 'pFirst_id' to 'pFirst_id'+'pGroup_size'-1
+**/
+void CFecGroup::reset(unsigned int pFirst_id, unsigned int pGroup_size)
+{
+	first_id=pFirst_id;
+	group_size=pGroup_size;
+	if(group_size>fec_max_group)
+		group_size=fec_max_group;
+	mask=0;
+	size_xor=0;
+	parity.clear();
+}
+
+/**
+* Add the buffer with id 'id'. Returns false if it is not in the group or was already added
+**/
+bool CFecGroup::add(unsigned int id, const char *buf, size_t bsize)
+{
+	if(id-first_id>=group_size || has(id))
+		return false;
+
+	mask|=1u<<(id-first_id);
+	size_xor^=(unsigned short)bsize;
+	if(parity.size()<bsize)
+	{
+		parity.resize(bsize, 0);
+	}
+	fec_xor(&parity[0], buf, bsize);
+	return true;
+}
+
+/**
+* Returns if the buffer with id 'id' was added
+**/
+bool CFecGroup::has(unsigned int id)
+{
+	if(id-first_id>=group_size)
+		return false;
+
+	return (mask & (1u<<(id-first_id)))!=0;
+}
+
+/**
+* Returns the number of buffers of the group which were not added yet
+**/
+unsigned int CFecGroup::getMissing(void)
+{
+	unsigned int ret=0;
+	for(unsigned int i=0;i<group_size;++i)
+	{
+		if((mask & (1u<<i))==0)
+			++ret;
+	}
+	return ret;
+}
+
+/**
+* Recover the only missing buffer using the parity 'pParity' with size 'pParity_size' and the xor of all
+* buffer sizes 'pSize_xor'. Returns false if not exactly one buffer is missing
+**/
+bool CFecGroup::recover(const char *pParity, size_t pParity_size, unsigned short pSize_xor, unsigned int &id, std::vector<char> &buf)
+{
+	if(getMissing()!=1 || pParity_size<parity.size())
+		return false;
+
+	for(unsigned int i=0;i<group_size;++i)
+	{
+		if((mask & (1u<<i))==0)
+		{
+			id=first_id+i;
+			break;
+		}
+	}
+
+	size_t bsize=pSize_xor^size_xor;
+	if(bsize==0 || bsize>pParity_size)
+		return false;
+
+	buf.assign(pParity, pParity+pParity_size);
+	if(!parity.empty())
+	{
+		fec_xor(&buf[0], &parity[0], parity.size());
+	}
+	buf.resize(bsize);
+	return true;
+}
+
+const char *CFecGroup::getParity(void)
+{
+	if(parity.empty())
+		return NULL;
+	return &parity[0];
+}
+
+size_t CFecGroup::getParitySize(void)
+{
+	return parity.size();
+}
+
+unsigned short CFecGroup::getSizeXor(void)
+{
+	return size_xor;
+}
+
+unsigned int CFecGroup::getFirstID(void)
+{
+	return first_id;
+}
+
+unsigned int CFecGroup::getGroupSize(void)
+{
+	return group_size;
+}
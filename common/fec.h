@@ -0,0 +1,70 @@
+/**
+* Forward error correction using xor parity. One parity buffer protects a group
+* of consecutive buffers and allows the recovery of one lost buffer per group.
+**/
+
+#ifndef FEC_H
+#define FEC_H
+
+#include <vector>
+#include <stddef.h>
+
+//Maximal number of buffers a parity buffer can protect. Has to be smaller than
+//the number of slices, so each buffer of a group is sent through a different tree
+const unsigned int fec_max_group=32;
+
+/**
+* Xor 'len' bytes of 'src' into 'dst'
+**/
+void fec_xor(char *dst, const char *src, size_t len);
+
+/**
+* Accumulates the parity of a group of buffers
+**/
+class CFecGroup
+{
+public:
+	CFecGroup(void);
+
+	/**
+	* Start a new group with the buffers 'pFirst_id' to 'pFirst_id'+'pGroup_size'-1
+	**/
+	void reset(unsigned int pFirst_id, unsigned int pGroup_size);
+
+	/**
+	* Add the buffer with id 'id'. Returns false if it is not in the group or was already added
+	**/
+	bool add(unsigned int id, const char *buf, size_t bsize);
+
+	/**
+	* Returns if the buffer with id 'id' was added
+	**/
+	bool has(unsigned int id);
+
+	/**
+	* Returns the number of buffers of the group which were not added yet
+	**/
+	unsigned int getMissing(void);
+
+	/**
+	* Recover the only missing buffer using the parity 'pParity' with size 'pParity_size' and the xor of all
+	* buffer sizes 'pSize_xor'. Returns false if not exactly one buffer is missing
+	**/
+	bool recover(const char *pParity, size_t pParity_size, unsigned short pSize_xor, unsigned int &id, std::vector<char> &buf);
+
+	const char *getParity(void);
+	size_t getParitySize(void);
+	unsigned short getSizeXor(void);
+	unsigned int getFirstID(void);
+	unsigned int getGroupSize(void);
+
+private:
+	std::vector<char> parity;
+	unsigned short size_xor;
+	unsigned int mask;
+
+	unsigned int first_id;
+	unsigned int group_size;
+};
+
+#endif //FEC_H
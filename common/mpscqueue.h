@@ -0,0 +1,84 @@
+#ifndef MPSCQUEUE_H_
+#define MPSCQUEUE_H_
+
+#include "os_atomic.h"
+#include <stddef.h>
+
+/**
+* Unbounded queue with many producer threads and one consumer thread. Neither of them locks.
+* A producer swaps its node in as the last one and links the previous last node to it afterwards,
+* so a value may become visible to the consumer slightly after push returned in another thread
+**/
+template<typename T>
+class CMPSCQueue
+{
+public:
+	CMPSCQueue(void)
+	{
+		tail=new SNode;
+		tail->next=NULL;
+		head=tail;
+	}
+
+	~CMPSCQueue(void)
+	{
+		while(tail!=NULL)
+		{
+			SNode *next=tail->next;
+			delete tail;
+			tail=next;
+		}
+	}
+
+	/**
+	* Append 'value'. Called by any producer
+	**/
+	void push(const T &value)
+	{
+		SNode *n=new SNode;
+		n->value=value;
+		n->next=NULL;
+		SNode *prev=os_atomic_exchange_ptr(&head, n);
+		os_atomic_store_ptr(&prev->next, n);
+	}
+
+	/**
+	* Remove the first value and save it in 'value'. Returns false if the queue
+	* is empty. Only called by the consumer
+	**/
+	bool pop(T &value)
+	{
+		SNode *next=os_atomic_load_ptr(&tail->next);
+		if(next==NULL)
+			return false;
+
+		value=next->value;
+		//The node becomes the dummy node. Don't keep the value alive in it
+		next->value=T();
+		delete tail;
+		tail=next;
+		return true;
+	}
+
+	/**
+	* Returns if there is no value to pop. Only called by the consumer
+	**/
+	bool empty(void)
+	{
+		return os_atomic_load_ptr(&tail->next)==NULL;
+	}
+
+private:
+	struct SNode
+	{
+		T value;
+		SNode * volatile next;
+	};
+
+	//Last node. Swapped by the producers
+	SNode * volatile head;
+	//Dummy node in front of the first value. Owned by the consumer
+	SNode *tail;
+};
+
+#endif /*MPSCQUEUE_H_*/
@@ -1,29 +1,31 @@
-/**
-* Class to parse and construct an acknowldegement, which will be send
-* from a client to the tracker on receiving an exploration packet (and
-* being the last client in the chain in this packet)
-**/
-#include "data.h"
-
-class msg_ack
-{
-public:
-	msg_ack(CRData &data);
-	msg_ack(unsigned int pMsg_id, unsigned int pSource_ip, unsigned short pSource_port);
-
-	void getMessage(CWData &data);
-
-	unsigned int getMsgID(void);
-	unsigned int getSourceIP(void);
-	unsigned short getSourcePort(void);
-
-	bool hasError(void);
-
-private:
-
-	unsigned int msg_id;
-	unsigned int source_ip;
-	unsigned short source_port;
-
-	bool err;
+/**
+* Class to parse and construct an acknowldegement, which will be send
+* from a client to the tracker on receiving an exploration packet (and
+* being the last client in the chain in this packet). In version 1 or 2 of the wire format
+**/
+#include "data.h"
+#include "wire.h"
+
+class msg_ack
+{
+public:
+	msg_ack(CRData &data, unsigned char pVersion=wire_version_1);
+	msg_ack(unsigned int pMsg_id, unsigned int pSource_ip, unsigned short pSource_port, unsigned char pVersion=wire_version_1);
+
+	void getMessage(CWData &data);
+
+	unsigned int getMsgID(void);
+	unsigned int getSourceIP(void);
+	unsigned short getSourcePort(void);
+
+	bool hasError(void);
+
+private:
+
+	unsigned int msg_id;
+	unsigned int source_ip;
+	unsigned short source_port;
+	unsigned char version;
+
+	bool err;
 };
\ No newline at end of file
@@ -1,158 +1,324 @@
-#include "msg_data.h"
-#include "packet_ids.h"
-
-/**
-* Parse an exploration packet
-**/
-msg_data::msg_data(CRData &data)
-{
-	err=false;
-	if(!data.getUInt(&msgid) )
-	{
-		err=true;
-		return;
-	}
-	unsigned char nhops;
-	if(!data.getUChar(&nhops))
-	{
-		err=true;
-		return;
-	}
-	for(unsigned char i=0;i<nhops;++i)
-	{
-		unsigned int hop_ip;
-		unsigned short hop_port;
-		if(!data.getUInt(&hop_ip) )
-		{
-			err=true;
-			return;
-		}
-		if(!data.getUShort(&hop_port) )
-		{
-			err=true;
-			return;
-		}
-		hops.push_back(std::pair<unsigned int, unsigned short>(hop_ip, hop_port) );
-	}
-	if(!data.getUChar(&curr_hop))
-	{
-		err=true;
-		return;
-	}
-	if(curr_hop>nhops)
-	{
-		err=true;
-		return;
-	}
-	if(!data.getUShort(&buf_size) )
-	{
-		err=true;
-		return;
-	}
-	if(data.getLeft()<buf_size)
-	{
-		err=true;
-		return;
-	}
-	buf=data.getCurrDataPtr();
-}
-
-/**
-* Returns if there was an error parsing the packet
-**/
-bool msg_data::hasError(void)
-{
-	return err;
-}
-
-/**
-* Construct an exploration packet with id 'pMsgid'. Hops 'pHops' consisting of pairs of ip and port. And payload data 'pBuf' with
-* size 'pBuf_size'
-**/
-msg_data::msg_data(unsigned int pMsgid,const std::vector<std::pair<unsigned int, unsigned short> > pHops, const char* pBuf, size_t pBuf_size)
-{
-	hops=pHops;
-	curr_hop=0;
-	buf=pBuf;
-	buf_size=pBuf_size;
-	msgid=pMsgid;
-}
-
-/**
-* Get the next hop of this packet. Returns 0,0 if this is the last hop
-**/
-std::pair<unsigned int, unsigned short> msg_data::getNextHop(void)
-{
-	if(curr_hop<hops.size())
-	{
-		return hops[curr_hop];
-	}
-	else
-		return std::pair<unsigned int, unsigned short>(0,0);
-}
-
-/**
-* Return the ultimate target of this packet
-**/
-std::pair<unsigned int, unsigned short> msg_data::getTarget(void)
-{
-	if(!hops.empty())
-	{
-		return hops[hops.size()-1];
-	}
-	else
-	{
-		return std::pair<unsigned int, unsigned short>(0,0);
-	}
-}
-
-/**
-* Increment the current hop
-**/
-void msg_data::incrementHop(void)
-{
-	if((size_t)curr_hop+1<=hops.size())
-		++curr_hop;
-}
-
-/**
-* Return the data saved in this message
-**/
-const char *msg_data::getBuf(void)
-{
-	return buf;
-}
-
-/**
-* Return the size of the data saved in this message
-**/
-unsigned short msg_data::getBuf_size(void)
-{
-	return buf_size;
-}
-
-/**
-* Return the id of this pacekt
-**/
-unsigned int msg_data::getMsgID(void)
-{
-	return msgid;
-}
-
-/**
-* Construct the message
-**/
-void msg_data::getMessage(CWData &data)
-{
-	data.addUChar(CC_DATA);
-	data.addUInt(msgid);
-	data.addUChar((unsigned char)hops.size());
-	for(size_t i=0;i<hops.size();++i)
-	{
-		data.addUInt(hops[i].first);
-		data.addUShort(hops[i].second);
-	}
-	data.addUChar(curr_hop);
-	data.addUShort(buf_size);
-	data.addBuffer(buf, buf_size);
+#include "msg_data.h"
+#include "packet_ids.h"
+#include "peerindex.h"
+#include <algorithm>
+
+/**
+* Parse an exploration packet of wire format version 'pVersion'. With 'pCompact' a compact one,
+* whose hops have to be resolved with resolveHops()
+**/
+msg_data::msg_data(CRData &data, unsigned char pVersion, bool pCompact)
+{
+	err=false;
+	version=pVersion;
+	compact=pCompact;
+	if(version==wire_version_2)
+	{
+		parseV2(data);
+		return;
+	}
+
+	if(!data.getUShort(&channel) )
+	{
+		err=true;
+		return;
+	}
+	if(!data.getUInt(&msgid) )
+	{
+		err=true;
+		return;
+	}
+	unsigned char nhops;
+	if(!data.getUChar(&nhops))
+	{
+		err=true;
+		return;
+	}
+	for(unsigned char i=0;i<nhops;++i)
+	{
+		unsigned int hop_ip;
+		unsigned short hop_port;
+		if(!data.getUInt(&hop_ip) )
+		{
+			err=true;
+			return;
+		}
+		if(!data.getUShort(&hop_port) )
+		{
+			err=true;
+			return;
+		}
+		hops.push_back(std::pair<unsigned int, unsigned short>(hop_ip, hop_port) );
+	}
+	if(!data.getUChar(&curr_hop))
+	{
+		err=true;
+		return;
+	}
+	if(curr_hop>nhops)
+	{
+		err=true;
+		return;
+	}
+	if(!data.getUShort(&buf_size) )
+	{
+		err=true;
+		return;
+	}
+	if(data.getLeft()<buf_size)
+	{
+		err=true;
+		return;
+	}
+	buf=data.getCurrDataPtr();
+}
+
+/**
+* Parse an exploration packet in version 2 of the wire format. The marker and type were already read
+**/
+void msg_data::parseV2(CRData &data)
+{
+	if(data.getSize()<sizeof(SWireData))
+	{
+		err=true;
+		return;
+	}
+	const SWireData *h=(const SWireData*)data.getDataPtr();
+	channel=wire_get16(h->channel);
+	msgid=wire_get32(h->msgid);
+	buf_size=wire_get16(h->buf_size);
+	curr_hop=h->curr_hop;
+	size_t hops_size=h->nhops*(compact?sizeof(SWireHopIndex):sizeof(SWireHop));
+	if(curr_hop>h->nhops || data.getSize()<sizeof(SWireData)+hops_size+buf_size)
+	{
+		err=true;
+		return;
+	}
+
+	hops.resize(h->nhops);
+	if(compact)
+	{
+		//The hops are resolved later
+		const SWireHopIndex *wire_hops=(const SWireHopIndex*)(data.getDataPtr()+sizeof(SWireData));
+		hop_indices.resize(h->nhops);
+		for(unsigned char i=0;i<h->nhops;++i)
+		{
+			hop_indices[i]=wire_get16(wire_hops[i].index);
+		}
+	}
+	else
+	{
+		const SWireHop *wire_hops=(const SWireHop*)(data.getDataPtr()+sizeof(SWireData));
+		for(unsigned char i=0;i<h->nhops;++i)
+		{
+			hops[i].first=wire_get_ip(wire_hops[i].ip);
+			hops[i].second=wire_get16(wire_hops[i].port);
+		}
+	}
+	data.setStreampos(sizeof(SWireData)+hops_size);
+	buf=data.getCurrDataPtr();
+}
+
+/**
+* Returns if there was an error parsing the packet
+**/
+bool msg_data::hasError(void)
+{
+	return err;
+}
+
+/**
+* Construct an exploration packet of channel 'pChannel' with id 'pMsgid'. Hops 'pHops' consisting of pairs of ip and port. And payload data 'pBuf' with
+* size 'pBuf_size'. It is constructed in wire format version 'pVersion'
+**/
+msg_data::msg_data(unsigned short pChannel, unsigned int pMsgid,const std::vector<std::pair<unsigned int, unsigned short> > pHops, const char* pBuf, size_t pBuf_size, unsigned char pVersion)
+{
+	err=false;
+	version=pVersion;
+	compact=false;
+	channel=pChannel;
+	hops=pHops;
+	curr_hop=0;
+	buf=pBuf;
+	buf_size=pBuf_size;
+	msgid=pMsgid;
+}
+
+/**
+* Construct a compact exploration packet of channel 'pChannel' with id 'pMsgid'. Hops 'pHop_indices' are peer indices.
+* And payload data 'pBuf' with size 'pBuf_size'. It is constructed in wire format version 2
+**/
+msg_data::msg_data(unsigned short pChannel, unsigned int pMsgid, const std::vector<unsigned short> &pHop_indices, const char* pBuf, size_t pBuf_size)
+{
+	err=false;
+	version=wire_version_2;
+	compact=true;
+	channel=pChannel;
+	hop_indices=pHop_indices;
+	hops.resize(hop_indices.size());
+	curr_hop=0;
+	buf=pBuf;
+	buf_size=pBuf_size;
+	msgid=pMsgid;
+}
+
+/**
+* Look up the ip and port of the hops still ahead and the target of a compact packet in 'index'.
+* Returns false if one of them is unknown
+**/
+bool msg_data::resolveHops(CPeerIndex &index)
+{
+	//The last hop receives the packet with all hops behind it, but acknowledges it with its own address
+	size_t first=(std::min)((size_t)curr_hop, hop_indices.size()-1);
+	for(size_t i=first;i<hop_indices.size();++i)
+	{
+		if(!index.get(hop_indices[i], hops[i].first, hops[i].second))
+			return false;
+	}
+	return true;
+}
+
+/**
+* Returns if the hops are addressed by their peer index
+**/
+bool msg_data::isCompact(void)
+{
+	return compact;
+}
+
+/**
+* Get the next hop of this packet. Returns 0,0 if this is the last hop
+**/
+std::pair<unsigned int, unsigned short> msg_data::getNextHop(void)
+{
+	if(curr_hop<hops.size())
+	{
+		return hops[curr_hop];
+	}
+	else
+		return std::pair<unsigned int, unsigned short>(0,0);
+}
+
+/**
+* Return the ultimate target of this packet
+**/
+std::pair<unsigned int, unsigned short> msg_data::getTarget(void)
+{
+	if(!hops.empty())
+	{
+		return hops[hops.size()-1];
+	}
+	else
+	{
+		return std::pair<unsigned int, unsigned short>(0,0);
+	}
+}
+
+/**
+* Increment the current hop
+**/
+void msg_data::incrementHop(void)
+{
+	if((size_t)curr_hop+1<=hops.size())
+		++curr_hop;
+}
+
+/**
+* Return the data saved in this message
+**/
+const char *msg_data::getBuf(void)
+{
+	return buf;
+}
+
+/**
+* Return the size of the data saved in this message
+**/
+unsigned short msg_data::getBuf_size(void)
+{
+	return buf_size;
+}
+
+/**
+* Return the id of this pacekt
+**/
+unsigned int msg_data::getMsgID(void)
+{
+	return msgid;
+}
+
+/**
+* Return the channel of this packet
+**/
+unsigned short msg_data::getChannel(void)
+{
+	return channel;
+}
+
+/**
+* Return the wire format version of this packet
+**/
+unsigned char msg_data::getVersion(void)
+{
+	return version;
+}
+
+/**
+* Construct the message
+**/
+void msg_data::getMessage(CWData &data)
+{
+	getHeader(data);
+	data.addBuffer(buf, buf_size);
+}
+
+/**
+* Construct the message without the payload. It has to be sent together with getBuf()
+**/
+void msg_data::getHeader(CWData &data)
+{
+	if(version==wire_version_2)
+	{
+		//Header and hops are written with one copy
+		unsigned char hdr[sizeof(SWireData)+255*sizeof(SWireHop)];
+		size_t nhops=(std::min)(hops.size(), (size_t)255);
+		SWireData *h=(SWireData*)hdr;
+		h->marker=wire_v2_marker;
+		h->type=compact?CC_DATA_COMPACT:CC_DATA;
+		wire_put16(h->channel, channel);
+		wire_put32(h->msgid, msgid);
+		wire_put16(h->buf_size, buf_size);
+		h->nhops=(unsigned char)nhops;
+		h->curr_hop=curr_hop;
+		if(compact)
+		{
+			SWireHopIndex *wire_hops=(SWireHopIndex*)(hdr+sizeof(SWireData));
+			for(size_t i=0;i<nhops;++i)
+			{
+				wire_put16(wire_hops[i].index, hop_indices[i]);
+			}
+			data.addBuffer((const char*)hdr, sizeof(SWireData)+nhops*sizeof(SWireHopIndex));
+			return;
+		}
+		SWireHop *wire_hops=(SWireHop*)(hdr+sizeof(SWireData));
+		for(size_t i=0;i<nhops;++i)
+		{
+			wire_put_ip(wire_hops[i].ip, hops[i].first);
+			wire_put16(wire_hops[i].port, hops[i].second);
+		}
+		data.addBuffer((const char*)hdr, sizeof(SWireData)+nhops*sizeof(SWireHop));
+		return;
+	}
+
+	data.addUChar(CC_DATA);
+	data.addUShort(channel);
+	data.addUInt(msgid);
+	data.addUChar((unsigned char)hops.size());
+	for(size_t i=0;i<hops.size();++i)
+	{
+		data.addUInt(hops[i].first);
+		data.addUShort(hops[i].second);
+	}
+	data.addUChar(curr_hop);
+	data.addUShort(buf_size);
 }
\ No newline at end of file
@@ -1,65 +1,107 @@
-/**
-* Class to parse and construct a exploration packet.
-**/
-
-#include "data.h"
-
-class msg_data
-{
-public:
-	/**
-	* Parse an exploration packet
-	**/
-	msg_data(CRData &data);
-	/**
-	* Construct an exploration packet with id 'pMsgid'. Hops 'pHops' consisting of pairs of ip and port. And payload data 'pBuf' with
-	* size 'pBuf_size'
-	**/
-	msg_data(unsigned int pMsgid, const std::vector<std::pair<unsigned int, unsigned short> > pHops, const char* pBuf, size_t pBuf_size);
-
-	/**
-	* Get the next hop of this packet. Returns 0,0 if this is the last hop
-	**/
-	std::pair<unsigned int, unsigned short> getNextHop(void);
-	/**
-	* Return the ultimate target of this packet
-	**/
-	std::pair<unsigned int, unsigned short> getTarget(void);
-	/**
-	* Increment the current hop
-	**/
-	void incrementHop(void);
-
-	/**
-	* Construct the message
-	**/
-	void getMessage(CWData &data);
-	/**
-	* Return the data saved in this message
-	**/
-	const char *getBuf(void);
-	/**
-	* Return the size of the data saved in this message
-	**/
-	unsigned short getBuf_size(void);
-	/**
-	* Return the id of this pacekt
-	**/
-	unsigned int getMsgID(void);
-
-	/**
-	* Returns if there was an error parsing the packet
-	**/
-	bool hasError(void);
-
-private:
-	std::vector<std::pair<unsigned int, unsigned short> > hops;
-	unsigned char curr_hop;
-
-	const char *buf;
-	unsigned short buf_size;
-
-	unsigned int msgid;
-
-	bool err;
+/**
+* Class to parse and construct a exploration packet. In version 1 or 2 of the wire format.
+* The compact packet of version 2 addresses the hops by their peer index instead of ip and port.
+**/
+
+#include "data.h"
+#include "wire.h"
+
+class CPeerIndex;
+
+class msg_data
+{
+public:
+	/**
+	* Parse an exploration packet of wire format version 'pVersion'. With 'pCompact' a compact one,
+	* whose hops have to be resolved with resolveHops()
+	**/
+	msg_data(CRData &data, unsigned char pVersion=wire_version_1, bool pCompact=false);
+	/**
+	* Construct an exploration packet of channel 'pChannel' with id 'pMsgid'. Hops 'pHops' consisting of pairs of ip and port. And payload data 'pBuf' with
+	* size 'pBuf_size'. It is constructed in wire format version 'pVersion'
+	**/
+	msg_data(unsigned short pChannel, unsigned int pMsgid, const std::vector<std::pair<unsigned int, unsigned short> > pHops, const char* pBuf, size_t pBuf_size, unsigned char pVersion=wire_version_1);
+	/**
+	* Construct a compact exploration packet of channel 'pChannel' with id 'pMsgid'. Hops 'pHop_indices' are peer indices.
+	* And payload data 'pBuf' with size 'pBuf_size'. It is constructed in wire format version 2
+	**/
+	msg_data(unsigned short pChannel, unsigned int pMsgid, const std::vector<unsigned short> &pHop_indices, const char* pBuf, size_t pBuf_size);
+
+	/**
+	* Look up the ip and port of the hops still ahead and the target of a compact packet in 'index'.
+	* Returns false if one of them is unknown
+	**/
+	bool resolveHops(CPeerIndex &index);
+	/**
+	* Returns if the hops are addressed by their peer index
+	**/
+	bool isCompact(void);
+
+	/**
+	* Get the next hop of this packet. Returns 0,0 if this is the last hop
+	**/
+	std::pair<unsigned int, unsigned short> getNextHop(void);
+	/**
+	* Return the ultimate target of this packet
+	**/
+	std::pair<unsigned int, unsigned short> getTarget(void);
+	/**
+	* Increment the current hop
+	**/
+	void incrementHop(void);
+
+	/**
+	* Construct the message
+	**/
+	void getMessage(CWData &data);
+	/**
+	* Construct the message without the payload. It has to be sent together with getBuf()
+	**/
+	void getHeader(CWData &data);
+	/**
+	* Return the data saved in this message
+	**/
+	const char *getBuf(void);
+	/**
+	* Return the size of the data saved in this message
+	**/
+	unsigned short getBuf_size(void);
+	/**
+	* Return the id of this pacekt
+	**/
+	unsigned int getMsgID(void);
+	/**
+	* Return the channel of this packet
+	**/
+	unsigned short getChannel(void);
+	/**
+	* Return the wire format version of this packet
+	**/
+	unsigned char getVersion(void);
+
+	/**
+	* Returns if there was an error parsing the packet
+	**/
+	bool hasError(void);
+
+private:
+	/**
+	* Parse an exploration packet in version 2 of the wire format. The marker and type were already read
+	**/
+	void parseV2(CRData &data);
+
+	std::vector<std::pair<unsigned int, unsigned short> > hops;
+	//Peer indices of the hops of a compact packet
+	std::vector<unsigned short> hop_indices;
+	bool compact;
+	unsigned char curr_hop;
+
+	const char *buf;
+	unsigned short buf_size;
+
+	unsigned int msgid;
+	unsigned short channel;
+	unsigned char version;
+
+	bool err;
 };
\ No newline at end of file
@@ -0,0 +1,134 @@
+/**
+* Class to construct and parse a parity message. It is sent through the tree
+* and carries the xor of a group of consecutive buffers, so a client can
+* recover one lost buffer of the group.
+**/
+
+#include "msg_fec.h"
+#include "packet_ids.h"
+
+/**
+* Parse a parity message
+**/
+msg_fec::msg_fec(CRData &data)
+{
+	err=false;
+	if(!data.getUShort(&channel) )
+	{
+		err=true;
+		return;
+	}
+	if(!data.getUInt(&first_id) )
+	{
+		err=true;
+		return;
+	}
+	if(!data.getUChar(&group_size) || group_size==0)
+	{
+		err=true;
+		return;
+	}
+	if(!data.getUShort(&size_xor) )
+	{
+		err=true;
+		return;
+	}
+	if(!data.getUShort(&buf_size) )
+	{
+		err=true;
+		return;
+	}
+	if(data.getLeft()<buf_size)
+	{
+		err=true;
+		return;
+	}
+	buf=data.getCurrDataPtr();
+}
+
+/**
+* Construct a parity message of channel 'pChannel' for the buffers 'pFirst_id' to 'pFirst_id'+'pGroup_size'-1 with the
+* xor of the buffer sizes 'pSize_xor' and the parity data 'pBuf' of size 'pBuf_size'
+**/
+msg_fec::msg_fec(unsigned short pChannel, unsigned int pFirst_id, unsigned char pGroup_size, unsigned short pSize_xor, const char* pBuf, size_t pBuf_size)
+{
+	channel=pChannel;
+	first_id=pFirst_id;
+	group_size=pGroup_size;
+	size_xor=pSize_xor;
+	buf=pBuf;
+	buf_size=(unsigned short)pBuf_size;
+	err=false;
+}
+
+/**
+* Construct the message
+**/
+void msg_fec::getMessage(CWData &data)
+{
+	data.addUChar(CC_FEC);
+	data.addUShort(channel);
+	data.addUInt(first_id);
+	data.addUChar(group_size);
+	data.addUShort(size_xor);
+	data.addUShort(buf_size);
+	data.addBuffer(buf, buf_size);
+}
+
+/**
+* Return the id which selects the tree this message is spread through
+**/
+unsigned int msg_fec::getMsgID(void)
+{
+	return first_id+group_size;
+}
+
+/**
+* Return the id of the first buffer in the group
+**/
+unsigned int msg_fec::getFirstID(void)
+{
+	return first_id;
+}
+
+/**
+* Return the number of buffers in the group
+**/
+unsigned char msg_fec::getGroupSize(void)
+{
+	return group_size;
+}
+
+/**
+* Return the xor of the sizes of all buffers in the group
+**/
+unsigned short msg_fec::getSizeXor(void)
+{
+	return size_xor;
+}
+
+/**
+* Return the channel of the buffers
+**/
+unsigned short msg_fec::getChannel(void)
+{
+	return channel;
+}
+
+const char *msg_fec::getBuf(void)
+{
+	return buf;
+}
+
+unsigned short msg_fec::getBuf_size(void)
+{
+	return buf_size;
+}
+
+/**
+* Returns if there was an error parsing the packet
+**/
+bool msg_fec::hasError(void)
+{
+	return err;
+}
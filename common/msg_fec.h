@@ -0,0 +1,68 @@
+/**
+* Class to construct and parse a parity message. It is sent through the tree
+* and carries the xor of a group of consecutive buffers, so a client can
+* recover one lost buffer of the group.
+**/
+
+#include "data.h"
+
+class msg_fec
+{
+public:
+	/**
+	* Parse a parity message
+	**/
+	msg_fec(CRData &data);
+	/**
+	* Construct a parity message of channel 'pChannel' for the buffers 'pFirst_id' to 'pFirst_id'+'pGroup_size'-1 with the
+	* xor of the buffer sizes 'pSize_xor' and the parity data 'pBuf' of size 'pBuf_size'
+	**/
+	msg_fec(unsigned short pChannel, unsigned int pFirst_id, unsigned char pGroup_size, unsigned short pSize_xor, const char* pBuf, size_t pBuf_size);
+
+	/**
+	* Construct the message
+	**/
+	void getMessage(CWData &data);
+
+	/**
+	* Return the id which selects the tree this message is spread through. This is the
+	* id following the group, so the parity is not sent through the same tree as one of
+	* the buffers it protects
+	**/
+	unsigned int getMsgID(void);
+	/**
+	* Return the id of the first buffer in the group
+	**/
+	unsigned int getFirstID(void);
+	/**
+	* Return the number of buffers in the group
+	**/
+	unsigned char getGroupSize(void);
+	/**
+	* Return the xor of the sizes of all buffers in the group
+	**/
+	unsigned short getSizeXor(void);
+	/**
+	* Return the channel of the buffers
+	**/
+	unsigned short getChannel(void);
+
+	const char *getBuf(void);
+	unsigned short getBuf_size(void);
+
+	/**
+	* Returns if there was an error parsing the packet
+	**/
+	bool hasError(void);
+
+private:
+	unsigned short channel;
+	unsigned int first_id;
+	unsigned char group_size;
+	unsigned short size_xor;
+
+	const char *buf;
+	unsigned short buf_size;
+
+	bool err;
+};
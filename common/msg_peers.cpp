@@ -0,0 +1,97 @@
+/**
+* Class to parse and construct the peer index message. The tracker tells the clients which index it
+* assigned to the peers of their channel, so exploration messages can address hops by it. Only in
+* version 2 of the wire format.
+**/
+
+#include "msg_peers.h"
+#include "packet_ids.h"
+
+/**
+* Parse a peer index message. The marker and type were already read
+**/
+msg_peers::msg_peers(CRData &data)
+{
+	err=false;
+	if(data.getSize()<sizeof(SWirePeers))
+	{
+		err=true;
+		return;
+	}
+	const SWirePeers *h=(const SWirePeers*)data.getDataPtr();
+	channel=wire_get16(h->channel);
+	unsigned short npeers=wire_get16(h->npeers);
+	if(data.getSize()<sizeof(SWirePeers)+npeers*sizeof(SWirePeer))
+	{
+		err=true;
+		return;
+	}
+
+	const SWirePeer *wire_peers=(const SWirePeer*)(data.getDataPtr()+sizeof(SWirePeers));
+	peers.resize(npeers);
+	for(unsigned short i=0;i<npeers;++i)
+	{
+		peers[i].index=wire_get16(wire_peers[i].index);
+		peers[i].ip=wire_get_ip(wire_peers[i].ip);
+		peers[i].port=wire_get16(wire_peers[i].port);
+	}
+	data.setStreampos(sizeof(SWirePeers)+npeers*sizeof(SWirePeer));
+}
+
+/**
+* Construct a peer index message of channel 'pChannel' with the peers 'pPeers'
+**/
+msg_peers::msg_peers(const std::vector<SIndexedPeer> &pPeers, unsigned short pChannel)
+	: peers(pPeers), channel(pChannel)
+{
+	err=false;
+	if(peers.size()>65535)
+	{
+		peers.resize(65535);
+	}
+}
+
+/**
+* Construct the message
+**/
+void msg_peers::getMessage(CWData &data)
+{
+	std::vector<unsigned char> buf(sizeof(SWirePeers)+peers.size()*sizeof(SWirePeer));
+	SWirePeers *h=(SWirePeers*)&buf[0];
+	h->marker=wire_v2_marker;
+	h->type=TRACKER_PEERS;
+	wire_put16(h->channel, channel);
+	wire_put16(h->npeers, (unsigned short)peers.size());
+	SWirePeer *wire_peers=(SWirePeer*)(&buf[0]+sizeof(SWirePeers));
+	for(size_t i=0;i<peers.size();++i)
+	{
+		wire_put16(wire_peers[i].index, peers[i].index);
+		wire_put_ip(wire_peers[i].ip, peers[i].ip);
+		wire_put16(wire_peers[i].port, peers[i].port);
+	}
+	data.addBuffer((const char*)&buf[0], buf.size());
+}
+
+/**
+* Get the peers
+**/
+const std::vector<SIndexedPeer>& msg_peers::getPeers(void)
+{
+	return peers;
+}
+
+/**
+* Get the channel of the peers
+**/
+unsigned short msg_peers::getChannel(void)
+{
+	return channel;
+}
+
+/**
+* Returns if there was an error parsing the message
+**/
+bool msg_peers::hasError(void)
+{
+	return err;
+}
@@ -0,0 +1,57 @@
+/**
+* Class to parse and construct the peer index message. The tracker tells the clients which index it
+* assigned to the peers of their channel, so exploration messages can address hops by it. Only in
+* version 2 of the wire format.
+**/
+
+#include "data.h"
+#include "wire.h"
+#include <vector>
+
+/**
+* A peer and the index the tracker assigned it
+**/
+struct SIndexedPeer
+{
+	unsigned short index;
+	unsigned int ip;
+	unsigned short port;
+};
+
+class msg_peers
+{
+public:
+	/**
+	* Parse a peer index message. The marker and type were already read
+	**/
+	msg_peers(CRData &data);
+	/**
+	* Construct a peer index message of channel 'pChannel' with the peers 'pPeers'
+	**/
+	msg_peers(const std::vector<SIndexedPeer> &pPeers, unsigned short pChannel);
+
+	/**
+	* Construct the message
+	**/
+	void getMessage(CWData &data);
+
+	/**
+	* Get the peers
+	**/
+	const std::vector<SIndexedPeer>& getPeers(void);
+	/**
+	* Get the channel of the peers
+	**/
+	unsigned short getChannel(void);
+
+	/**
+	* Returns if there was an error parsing the message
+	**/
+	bool hasError(void);
+
+private:
+	std::vector<SIndexedPeer> peers;
+	unsigned short channel;
+
+	bool err;
+};
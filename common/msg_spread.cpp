@@ -1,64 +1,125 @@
-/**
-* Class to construct and parse a message that is send through the tree.
-* The message is constructed with a certain id and data it has to
-* carry.
-**/
-
-#include "msg_spread.h"
-#include "packet_ids.h"
-
-msg_spread::msg_spread(CRData &data)
-{
-	err=false;
-	if(!data.getUInt(&msgid) )
-	{
-		err=true;
-		return;
-	}
-	if(!data.getUShort(&buf_size))
-	{
-		err=true;
-		return;
-	}
-	if(data.getLeft()<buf_size)
-	{
-		err=true;
-		return;
-	}
-	buf=data.getCurrDataPtr();
-}
-
-msg_spread::msg_spread(unsigned int pMsgid, const char* pBuf, size_t pBuf_size)
-{
-	buf=pBuf;
-	buf_size=pBuf_size;
-	msgid=pMsgid;
-}
-
-const char *msg_spread::getBuf(void)
-{
-	return buf;
-}
-
-unsigned short msg_spread::getBuf_size(void)
-{
-	return buf_size;
-}
-
-void msg_spread::getMessage(CWData &data)
-{
-	data.addUChar(CC_SPREAD);
-	data.addUInt(msgid);
-	data.addUShort(buf_size);
-	data.addBuffer(buf, buf_size);
-}
-
-bool msg_spread::hasError(void)
-{
-	return err;
-}
-
-unsigned int msg_spread::getMsgID(void)
-{
-	return msgid;
+/**
+* Class to construct and parse a message that is send through the tree.
+* The message is constructed with the channel it belongs to, a certain
+* id and data it has to carry. Retransmissions use the same layout, but are sent with a
+* different message type, so they are not relayed through the tree.
+* It is parsed and constructed in version 1 or 2 of the wire format.
+**/
+
+#include "msg_spread.h"
+#include "packet_ids.h"
+
+msg_spread::msg_spread(CRData &data, unsigned char pVersion)
+{
+	err=false;
+	version=pVersion;
+	if(version==wire_version_2)
+	{
+		//The marker and type were already read. The header starts with them
+		if(data.getSize()<sizeof(SWireSpread))
+		{
+			err=true;
+			return;
+		}
+		const SWireSpread *h=(const SWireSpread*)data.getDataPtr();
+		channel=wire_get16(h->channel);
+		msgid=wire_get32(h->msgid);
+		buf_size=wire_get16(h->buf_size);
+		data.setStreampos(sizeof(SWireSpread));
+	}
+	else
+	{
+		if(!data.getUShort(&channel) )
+		{
+			err=true;
+			return;
+		}
+		if(!data.getUInt(&msgid) )
+		{
+			err=true;
+			return;
+		}
+		if(!data.getUShort(&buf_size))
+		{
+			err=true;
+			return;
+		}
+	}
+	if(data.getLeft()<buf_size)
+	{
+		err=true;
+		return;
+	}
+	buf=data.getCurrDataPtr();
+}
+
+msg_spread::msg_spread(unsigned short pChannel, unsigned int pMsgid, const char* pBuf, size_t pBuf_size, unsigned char pVersion)
+{
+	version=pVersion;
+	err=false;
+	channel=pChannel;
+	buf=pBuf;
+	buf_size=pBuf_size;
+	msgid=pMsgid;
+}
+
+const char *msg_spread::getBuf(void)
+{
+	return buf;
+}
+
+unsigned short msg_spread::getBuf_size(void)
+{
+	return buf_size;
+}
+
+void msg_spread::getMessage(CWData &data, bool resend)
+{
+	getHeader(data, resend);
+	data.addBuffer(buf, buf_size);
+}
+
+void msg_spread::getHeader(CWData &data, bool resend)
+{
+	if(version==wire_version_2)
+	{
+		SWireSpread h;
+		h.marker=wire_v2_marker;
+		h.type=resend?CC_RESEND:CC_SPREAD;
+		wire_put16(h.channel, channel);
+		wire_put32(h.msgid, msgid);
+		wire_put16(h.buf_size, buf_size);
+		data.addBuffer((const char*)&h, sizeof(SWireSpread));
+		return;
+	}
+
+	data.addUChar(resend?CC_RESEND:CC_SPREAD);
+	data.addUShort(channel);
+	data.addUInt(msgid);
+	data.addUShort(buf_size);
+}
+
+bool msg_spread::hasError(void)
+{
+	return err;
+}
+
+unsigned int msg_spread::getMsgID(void)
+{
+	return msgid;
+}
+
+unsigned short msg_spread::getChannel(void)
+{
+	return channel;
+}
+
+unsigned char msg_spread::getVersion(void)
+{
+	return version;
+}
+
+void msg_spread::setVersion(unsigned char pVersion)
+{
+	version=pVersion;
 }
\ No newline at end of file
@@ -1,30 +1,41 @@
-/**
-* Class to construct and parse a message that is send through the tree.
-* The message is constructed with a certain id and data it has to
-* carry.
-**/
-
-#include "data.h"
-
-class msg_spread
-{
-public:
-	msg_spread(CRData &data);
-	msg_spread(unsigned int pMsgid, const char* pBuf, size_t pBuf_size);
-
-	void getMessage(CWData &data);
-	const char *getBuf(void);
-	unsigned short getBuf_size(void);
-
-	unsigned int getMsgID(void);
-
-	bool hasError(void);
-
-private:
-
-	const char *buf;
-	unsigned short buf_size;
-	unsigned int msgid;
-
-	bool err;
+/**
+* Class to construct and parse a message that is send through the tree.
+* The message is constructed with the channel it belongs to, a certain
+* id and data it has to carry. Retransmissions use the same layout, but are sent with a
+* different message type, so they are not relayed through the tree.
+* It is parsed and constructed in version 1 or 2 of the wire format.
+**/
+
+#include "data.h"
+#include "wire.h"
+
+class msg_spread
+{
+public:
+	msg_spread(CRData &data, unsigned char pVersion=wire_version_1);
+	msg_spread(unsigned short pChannel, unsigned int pMsgid, const char* pBuf, size_t pBuf_size, unsigned char pVersion=wire_version_1);
+
+	void getMessage(CWData &data, bool resend=false);
+	//The message without the payload. It has to be sent together with getBuf()
+	void getHeader(CWData &data, bool resend=false);
+	const char *getBuf(void);
+	unsigned short getBuf_size(void);
+
+	unsigned int getMsgID(void);
+	unsigned short getChannel(void);
+
+	unsigned char getVersion(void);
+	void setVersion(unsigned char pVersion);
+
+	bool hasError(void);
+
+private:
+
+	const char *buf;
+	unsigned short buf_size;
+	unsigned int msgid;
+	unsigned short channel;
+	unsigned char version;
+
+	bool err;
 };
\ No newline at end of file
@@ -0,0 +1,108 @@
+/**
+* Class to parse and construct the statistics a client periodically sends
+* to the tracker. The counters count since the client started
+**/
+#include "msg_stats.h"
+#include "packet_ids.h"
+
+msg_stats::msg_stats(CRData &data)
+{
+	err=false;
+	unsigned char nslices;
+	if(!data.getUChar(&nslices))
+	{
+		err=true;
+		return;
+	}
+	slices.resize(nslices);
+	for(unsigned char i=0;i<nslices;++i)
+	{
+		if(!data.getUInt(&slices[i].received) || !data.getUInt(&slices[i].forwarded) || !data.getUInt(&slices[i].duplicates))
+		{
+			err=true;
+			return;
+		}
+	}
+	if(!data.getUInt(&late) || !data.getUInt(&lost))
+	{
+		err=true;
+		return;
+	}
+	if(!data.getUInt(&queue_depth) || !data.getUInt(&jitter))
+	{
+		err=true;
+		return;
+	}
+	if(!data.getUShort(&cpu_load))
+	{
+		err=true;
+		return;
+	}
+}
+
+msg_stats::msg_stats(const std::vector<SSliceStats> &pSlices, unsigned int pLate, unsigned int pLost, unsigned int pQueue_depth, unsigned int pJitter, unsigned short pCpu_load)
+	: slices(pSlices)
+{
+	late=pLate;
+	lost=pLost;
+	queue_depth=pQueue_depth;
+	jitter=pJitter;
+	cpu_load=pCpu_load;
+	err=false;
+	if(slices.size()>255)
+	{
+		slices.resize(255);
+	}
+}
+
+void msg_stats::getMessage(CWData &data)
+{
+	data.addUChar(TRACKER_STATS);
+	data.addUChar((unsigned char)slices.size());
+	for(size_t i=0;i<slices.size();++i)
+	{
+		data.addUInt(slices[i].received);
+		data.addUInt(slices[i].forwarded);
+		data.addUInt(slices[i].duplicates);
+	}
+	data.addUInt(late);
+	data.addUInt(lost);
+	data.addUInt(queue_depth);
+	data.addUInt(jitter);
+	data.addUShort(cpu_load);
+}
+
+const std::vector<SSliceStats>& msg_stats::getSlices(void)
+{
+	return slices;
+}
+
+unsigned int msg_stats::getLate(void)
+{
+	return late;
+}
+
+unsigned int msg_stats::getLost(void)
+{
+	return lost;
+}
+
+unsigned int msg_stats::getQueueDepth(void)
+{
+	return queue_depth;
+}
+
+unsigned int msg_stats::getJitter(void)
+{
+	return jitter;
+}
+
+unsigned short msg_stats::getCpuLoad(void)
+{
+	return cpu_load;
+}
+
+bool msg_stats::hasError(void)
+{
+	return err;
+}
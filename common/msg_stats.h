@@ -0,0 +1,48 @@
+/**
+* Class to parse and construct the statistics a client periodically sends
+* to the tracker. The counters count since the client started
+**/
+#include "data.h"
+#include <vector>
+
+/**
+* Messages one slice thread of a client handled
+**/
+struct SSliceStats
+{
+	unsigned int received;
+	unsigned int forwarded;
+	unsigned int duplicates;
+};
+
+class msg_stats
+{
+public:
+	msg_stats(CRData &data);
+	msg_stats(const std::vector<SSliceStats> &pSlices, unsigned int pLate, unsigned int pLost, unsigned int pQueue_depth, unsigned int pJitter, unsigned short pCpu_load);
+
+	void getMessage(CWData &data);
+
+	const std::vector<SSliceStats>& getSlices(void);
+	unsigned int getLate(void);
+	unsigned int getLost(void);
+	unsigned int getQueueDepth(void);
+	unsigned int getJitter(void);
+	unsigned short getCpuLoad(void);
+
+	bool hasError(void);
+
+private:
+
+	std::vector<SSliceStats> slices;
+	unsigned int late;
+	unsigned int lost;
+	//Messages waiting in the relay queues
+	unsigned int queue_depth;
+	//Jitter of the received buffers in ms
+	unsigned int jitter;
+	//CPU time the busiest relay thread used in percent
+	unsigned short cpu_load;
+
+	bool err;
+};
@@ -1,107 +1,200 @@
-#include "msg_tree.h"
-#include "packet_ids.h"
-
-/**
-* Parse a tree message
-**/
-msg_tree::msg_tree(CRData &data)
-{
-	err=false;
-
-	if(!data.getInt(&k))
-	{
-		err=true;
-		return;
-	}
-
-	if(!data.getInt(&slices))
-	{
-		err=true;
-		return;
-	}
-
-	unsigned int r_nodes;
-	if(!data.getUInt(&r_nodes))
-	{
-		err=true;
-		return;
-	}
-
-	for(unsigned int i=0;i<r_nodes;++i)
-	{
-		unsigned int ip;
-		if(!data.getUInt(&ip))
-		{
-			err=true;
-			return;
-		}
-		unsigned short port;
-		if(!data.getUShort(&port))
-		{
-			err=true;
-			return;
-		}
-		relay_nodes.push_back(std::pair<unsigned int, unsigned short>(ip,port));
-	}
-}
-
-/**
-* Construct a tree message. The client this message is sent to has the children in 'pRelay_nodes'.
-* 'pRelay_nodes' is a list of pairs consisting of ip and port. 'pK' says which tree corresponds to
-* these children. 'pSlices' says how many trees there are.
-**/
-msg_tree::msg_tree(std::vector<std::pair<unsigned int,unsigned short> > pRelay_nodes, int pK, int pSlices)
-{
-	relay_nodes=pRelay_nodes;
-	k=pK;
-	slices=pSlices;
-}
-
-/**
-* Get the children. (List of ip,port pairs
-**/
-std::vector<std::pair<unsigned int,unsigned short> > msg_tree::getRelayNodes(void)
-{
-	return relay_nodes;
-}
-
-/**
-* Construct the message
-**/
-void msg_tree::getMessage(CWData &data)
-{
-	data.addUChar(TRACKER_TREE);
-	data.addInt(k);
-	data.addInt(slices);
-	data.addUInt(relay_nodes.size());
-	for(size_t i=0;i<relay_nodes.size();++i)
-	{
-		data.addUInt(relay_nodes[i].first);
-		data.addUInt(relay_nodes[i].second);
-	}
-}
-
-/**
-* Returns if there was a parsing error
-**/
-bool msg_tree::hasError(void)
-{
-	return err;
-}
-
-/**
-* Get the tree number
-**/
-int msg_tree::getK(void)
-{
-	return k;
-}
-
-/**
-* Get the total number of trees
-**/
-int msg_tree::getSlices(void)
-{
-	return slices;
-}
-
+#include "msg_tree.h"
+#include "packet_ids.h"
+
+/**
+* Parse a tree message of wire format version 'pVersion'
+**/
+msg_tree::msg_tree(CRData &data, unsigned char pVersion)
+{
+	err=false;
+	version=pVersion;
+	if(version==wire_version_2)
+	{
+		parseV2(data);
+		return;
+	}
+
+	if(!data.getInt(&k))
+	{
+		err=true;
+		return;
+	}
+
+	if(!data.getInt(&slices))
+	{
+		err=true;
+		return;
+	}
+
+	if(!data.getUShort(&channel))
+	{
+		err=true;
+		return;
+	}
+
+	unsigned int r_nodes;
+	if(!data.getUInt(&r_nodes))
+	{
+		err=true;
+		return;
+	}
+
+	for(unsigned int i=0;i<r_nodes;++i)
+	{
+		unsigned int ip;
+		if(!data.getUInt(&ip))
+		{
+			err=true;
+			return;
+		}
+		unsigned short port;
+		if(!data.getUShort(&port))
+		{
+			err=true;
+			return;
+		}
+		SRelayNode node;
+		node.ip=ip;
+		node.port=port;
+		node.version=wire_version_1;
+		relay_nodes.push_back(node);
+	}
+}
+
+/**
+* Parse a tree message in version 2 of the wire format. The marker and type were already read
+**/
+void msg_tree::parseV2(CRData &data)
+{
+	if(data.getSize()<sizeof(SWireTree))
+	{
+		err=true;
+		return;
+	}
+	const SWireTree *h=(const SWireTree*)data.getDataPtr();
+	channel=wire_get16(h->channel);
+	k=wire_get16(h->k);
+	slices=wire_get16(h->slices);
+	unsigned short nnodes=wire_get16(h->nnodes);
+	if(data.getSize()<sizeof(SWireTree)+nnodes*sizeof(SWireNode))
+	{
+		err=true;
+		return;
+	}
+
+	const SWireNode *nodes=(const SWireNode*)(data.getDataPtr()+sizeof(SWireTree));
+	relay_nodes.resize(nnodes);
+	for(unsigned short i=0;i<nnodes;++i)
+	{
+		relay_nodes[i].ip=wire_get_ip(nodes[i].ip);
+		relay_nodes[i].port=wire_get16(nodes[i].port);
+		relay_nodes[i].version=nodes[i].version;
+	}
+}
+
+/**
+* Construct a tree message. The client this message is sent to has the children in 'pRelay_nodes'.
+* 'pK' says which tree corresponds to these children. 'pSlices' says how many trees there are.
+* 'pChannel' is the channel the tree belongs to. It is constructed in wire format version 'pVersion'
+**/
+msg_tree::msg_tree(const std::vector<SRelayNode> &pRelay_nodes, int pK, int pSlices, unsigned short pChannel, unsigned char pVersion)
+{
+	err=false;
+	version=pVersion;
+	channel=pChannel;
+	relay_nodes=pRelay_nodes;
+	k=pK;
+	slices=pSlices;
+}
+
+/**
+* Get the children. In version 1 all of them understand version 1 only
+**/
+const std::vector<SRelayNode>& msg_tree::getRelayNodes(void)
+{
+	return relay_nodes;
+}
+
+/**
+* Construct the message
+**/
+void msg_tree::getMessage(CWData &data)
+{
+	if(version==wire_version_2)
+	{
+		SWireTree h;
+		h.marker=wire_v2_marker;
+		h.type=TRACKER_TREE;
+		wire_put16(h.channel, channel);
+		wire_put16(h.k, (unsigned short)k);
+		wire_put16(h.slices, (unsigned short)slices);
+		wire_put16(h.nnodes, (unsigned short)relay_nodes.size());
+		data.addBuffer((const char*)&h, sizeof(SWireTree));
+
+		std::vector<SWireNode> nodes(relay_nodes.size());
+		for(size_t i=0;i<relay_nodes.size();++i)
+		{
+			wire_put_ip(nodes[i].ip, relay_nodes[i].ip);
+			wire_put16(nodes[i].port, relay_nodes[i].port);
+			nodes[i].version=relay_nodes[i].version;
+			nodes[i].reserved=0;
+		}
+		if(!nodes.empty())
+		{
+			data.addBuffer((const char*)&nodes[0], nodes.size()*sizeof(SWireNode));
+		}
+		return;
+	}
+
+	data.addUChar(TRACKER_TREE);
+	data.addInt(k);
+	data.addInt(slices);
+	data.addUShort(channel);
+	data.addUInt(relay_nodes.size());
+	for(size_t i=0;i<relay_nodes.size();++i)
+	{
+		data.addUInt(relay_nodes[i].ip);
+		data.addUShort(relay_nodes[i].port);
+	}
+}
+
+/**
+* Returns if there was a parsing error
+**/
+bool msg_tree::hasError(void)
+{
+	return err;
+}
+
+/**
+* Get the tree number
+**/
+int msg_tree::getK(void)
+{
+	return k;
+}
+
+/**
+* Get the total number of trees
+**/
+int msg_tree::getSlices(void)
+{
+	return slices;
+}
+
+/**
+* Get the channel of the tree
+**/
+unsigned short msg_tree::getChannel(void)
+{
+	return channel;
+}
+
+/**
+* Get the wire format version of the message
+**/
+unsigned char msg_tree::getVersion(void)
+{
+	return version;
+}
+
@@ -1,52 +1,68 @@
-/**
-* Class to contruct and parse the tree message. This message is used to inform a client about which
-* children it has in a certain tree.
-**/
-
-#include "data.h"
-
-class msg_tree
-{
-public:
-	/**
-	* Parse a tree message
-	**/
-	msg_tree(CRData &data);
-	/**
-	* Construct a tree message. The client this message is sent to has the children in 'pRelay_nodes'.
-	* 'pRelay_nodes' is a list of pairs consisting of ip and port. 'pK' says which tree corresponds to
-	* these children. 'pSlices' says how many trees there are.
-	**/
-	msg_tree(std::vector<std::pair<unsigned int,unsigned short> > pRelay_nodes, int pK, int pSlices);
-
-	/**
-	* Construct the message
-	**/
-	void getMessage(CWData &data);
-
-	/**
-	* Get the children. (List of ip,port pairs
-	**/
-	std::vector<std::pair<unsigned int,unsigned short> > getRelayNodes(void);
-	/**
-	* Get the tree number
-	**/
-	int getK(void);
-	/**
-	* Get the total number of trees
-	**/
-	int getSlices(void);
-
-	/**
-	* Returns if there was a parsing error
-	**/
-	bool hasError(void);
-
-private:
-
-	std::vector<std::pair<unsigned int,unsigned short> > relay_nodes;
-	int k;
-	int slices;
-
-	bool err;
+/**
+* Class to contruct and parse the tree message. This message is used to inform a client about which
+* children it has in a certain tree of a channel. In version 1 or 2 of the wire format. Version 2
+* also says which wire format version each child understands.
+**/
+
+#include "data.h"
+#include "wire.h"
+
+class msg_tree
+{
+public:
+	/**
+	* Parse a tree message of wire format version 'pVersion'
+	**/
+	msg_tree(CRData &data, unsigned char pVersion=wire_version_1);
+	/**
+	* Construct a tree message. The client this message is sent to has the children in 'pRelay_nodes'.
+	* 'pK' says which tree corresponds to these children. 'pSlices' says how many trees there are.
+	* 'pChannel' is the channel the tree belongs to. It is constructed in wire format version 'pVersion'
+	**/
+	msg_tree(const std::vector<SRelayNode> &pRelay_nodes, int pK, int pSlices, unsigned short pChannel, unsigned char pVersion=wire_version_1);
+
+	/**
+	* Construct the message
+	**/
+	void getMessage(CWData &data);
+
+	/**
+	* Get the children. In version 1 all of them understand version 1 only
+	**/
+	const std::vector<SRelayNode>& getRelayNodes(void);
+	/**
+	* Get the tree number
+	**/
+	int getK(void);
+	/**
+	* Get the total number of trees
+	**/
+	int getSlices(void);
+	/**
+	* Get the channel of the tree
+	**/
+	unsigned short getChannel(void);
+	/**
+	* Get the wire format version of the message
+	**/
+	unsigned char getVersion(void);
+
+	/**
+	* Returns if there was a parsing error
+	**/
+	bool hasError(void);
+
+private:
+	/**
+	* Parse a tree message in version 2 of the wire format. The marker and type were already read
+	**/
+	void parseV2(CRData &data);
+
+	std::vector<SRelayNode> relay_nodes;
+	int k;
+	int slices;
+	unsigned short channel;
+	unsigned char version;
+
+	bool err;
 };
\ No newline at end of file
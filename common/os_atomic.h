@@ -0,0 +1,135 @@
+#ifndef OS_ATOMIC_H_
+#define OS_ATOMIC_H_
+
+/**
+* Atomic operations on integers and pointers. All of them are full memory barriers,
+* so a value written before a store is visible to a thread that loads the stored value.
+**/
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/**
+* Load the value of 'p'
+**/
+inline unsigned int os_atomic_load(volatile unsigned int *p)
+{
+#ifdef _WIN32
+	unsigned int r=*p;
+	MemoryBarrier();
+	return r;
+#else
+	unsigned int r=*p;
+	__sync_synchronize();
+	return r;
+#endif
+}
+
+/**
+* Store 'v' in 'p'
+**/
+inline void os_atomic_store(volatile unsigned int *p, unsigned int v)
+{
+#ifdef _WIN32
+	MemoryBarrier();
+	*p=v;
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+	*p=v;
+	__sync_synchronize();
+#endif
+}
+
+/**
+* Add 'v' to 'p'. Returns the new value
+**/
+inline unsigned int os_atomic_add(volatile unsigned int *p, unsigned int v)
+{
+#ifdef _WIN32
+	return (unsigned int)InterlockedExchangeAdd((volatile LONG*)p, (LONG)v)+v;
+#else
+	return __sync_add_and_fetch(p, v);
+#endif
+}
+
+/**
+* Set 'p' to 'newv' if it is 'oldv'. Returns true if it was set
+**/
+inline bool os_atomic_cas(volatile unsigned int *p, unsigned int oldv, unsigned int newv)
+{
+#ifdef _WIN32
+	return (unsigned int)InterlockedCompareExchange((volatile LONG*)p, (LONG)newv, (LONG)oldv)==oldv;
+#else
+	return __sync_bool_compare_and_swap(p, oldv, newv);
+#endif
+}
+
+/**
+* Load the pointer 'p'
+**/
+template<typename T>
+inline T* os_atomic_load_ptr(T * volatile *p)
+{
+#ifdef _WIN32
+	T *r=*p;
+	MemoryBarrier();
+	return r;
+#else
+	T *r=*p;
+	__sync_synchronize();
+	return r;
+#endif
+}
+
+/**
+* Store the pointer 'v' in 'p'
+**/
+template<typename T>
+inline void os_atomic_store_ptr(T * volatile *p, T *v)
+{
+#ifdef _WIN32
+	MemoryBarrier();
+	*p=v;
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+	*p=v;
+	__sync_synchronize();
+#endif
+}
+
+/**
+* Set the pointer 'p' to 'newv' if it is 'oldv'. Returns true if it was set
+**/
+template<typename T>
+inline bool os_atomic_cas_ptr(T * volatile *p, T *oldv, T *newv)
+{
+#ifdef _WIN32
+	return InterlockedCompareExchangePointer((PVOID volatile*)p, newv, oldv)==oldv;
+#else
+	return __sync_bool_compare_and_swap(p, oldv, newv);
+#endif
+}
+
+/**
+* Set the pointer 'p' to 'v'. Returns the previous value
+**/
+template<typename T>
+inline T* os_atomic_exchange_ptr(T * volatile *p, T *v)
+{
+#ifdef _WIN32
+	return (T*)InterlockedExchangePointer((PVOID volatile*)p, v);
+#else
+	T *r;
+	do
+	{
+		r=*p;
+	}
+	while(!__sync_bool_compare_and_swap(p, r, v));
+	return r;
+#endif
+}
+
+#endif /*OS_ATOMIC_H_*/
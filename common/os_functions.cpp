@@ -1,6 +1,8 @@
 #include "os_functions.h"
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <sys/resource.h>
 #endif
 #include <boost/thread/xtime.hpp>
 
@@ -27,4 +29,24 @@ void os_sleep(unsigned int ms)
 #endif
 }
 
-
+unsigned int os_getthreadcputimems(void)
+{
+#ifdef _WIN32
+	FILETIME creation_time, exit_time, kernel_time, user_time;
+	if(!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time))
+		return 0;
+	ULARGE_INTEGER kt, ut;
+	kt.LowPart=kernel_time.dwLowDateTime;
+	kt.HighPart=kernel_time.dwHighDateTime;
+	ut.LowPart=user_time.dwLowDateTime;
+	ut.HighPart=user_time.dwHighDateTime;
+	//100 ns units
+	return (unsigned int)((kt.QuadPart+ut.QuadPart)/10000);
+#else
+	rusage usage;
+	if(getrusage(RUSAGE_THREAD, &usage)!=0)
+		return 0;
+	return (unsigned int)(usage.ru_utime.tv_sec*1000+usage.ru_utime.tv_usec/1000
+		+usage.ru_stime.tv_sec*1000+usage.ru_stime.tv_usec/1000);
+#endif
+}
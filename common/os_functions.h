@@ -3,5 +3,6 @@
 
 unsigned int os_gettimems(void);
 void os_sleep(unsigned int ms);
+unsigned int os_getthreadcputimems(void);
 
 #endif /*OS_FUNCTIONS_H_*/
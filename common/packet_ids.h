@@ -1,14 +1,20 @@
-typedef unsigned char UCHAR;
-
-
-const UCHAR TRACKER_PING=0;
-const UCHAR TRACKER_PONG=1;
-const UCHAR TRACKER_TREE=2;
-const UCHAR TRACKER_PORT=3;
-const UCHAR TRACKER_ACK=4;
-const UCHAR TRACKER_NACK=5;
-
-
-const UCHAR CC_DATA=0;
-const UCHAR CC_ACK=1;
-const UCHAR CC_SPREAD=2;
\ No newline at end of file
+typedef unsigned char UCHAR;
+
+
+const UCHAR TRACKER_PING=0;
+const UCHAR TRACKER_PONG=1;
+const UCHAR TRACKER_TREE=2;
+const UCHAR TRACKER_PORT=3;
+const UCHAR TRACKER_ACK=4;
+const UCHAR TRACKER_NACK=5;
+const UCHAR TRACKER_RELAY=6;
+const UCHAR TRACKER_STATS=7;
+const UCHAR TRACKER_PEERS=8;
+
+
+const UCHAR CC_DATA=0;
+const UCHAR CC_ACK=1;
+const UCHAR CC_SPREAD=2;
+const UCHAR CC_RESEND=3;
+const UCHAR CC_FEC=4;
+const UCHAR CC_DATA_COMPACT=5;
\ No newline at end of file
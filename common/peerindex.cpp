@@ -0,0 +1,46 @@
+#include "peerindex.h"
+#include "os_atomic.h"
+
+CPeerIndex::CPeerIndex(void)
+{
+	entries=new SPeerIndexEntry[peer_index_size];
+	for(size_t i=0;i<peer_index_size;++i)
+	{
+		entries[i].ip=0;
+		entries[i].port=0;
+	}
+}
+
+CPeerIndex::~CPeerIndex(void)
+{
+	delete [] entries;
+}
+
+/**
+* Set the peer with index 'index' to ip 'ip' and port 'port'. Only called by one thread
+**/
+void CPeerIndex::set(unsigned short index, unsigned int ip, unsigned short port)
+{
+	//The entry is invalid while the ip is changed, so a reader never combines the ip of one peer with the port of another
+	SPeerIndexEntry &e=entries[index];
+	os_atomic_store(&e.port, 0);
+	os_atomic_store(&e.ip, ip);
+	os_atomic_store(&e.port, port);
+}
+
+/**
+* Set 'ip' and 'port' to the peer with index 'index'. Returns false if it is unknown
+* or was changed while it was read. Called by any thread
+**/
+bool CPeerIndex::get(unsigned short index, unsigned int &ip, unsigned short &port)
+{
+	SPeerIndexEntry &e=entries[index];
+	unsigned int p=os_atomic_load(&e.port);
+	if(p==0)
+		return false;
+	ip=os_atomic_load(&e.ip);
+	if(os_atomic_load(&e.port)!=p)
+		return false;
+	port=(unsigned short)p;
+	return true;
+}
@@ -0,0 +1,44 @@
+/**
+* Table of the peers of a channel by the index the tracker assigned them. Compact exploration
+* messages address their hops by these indices. Written by one thread, read by any thread without locking.
+**/
+
+#ifndef PEERINDEX_H
+#define PEERINDEX_H
+
+#include "wire.h"
+
+//Number of peer indices. One more than the largest index
+const size_t peer_index_size=65536;
+
+/**
+* A peer in the table. Port 0 marks an unused index
+**/
+struct SPeerIndexEntry
+{
+	volatile unsigned int ip;
+	volatile unsigned int port;
+};
+
+class CPeerIndex
+{
+public:
+	CPeerIndex(void);
+	~CPeerIndex(void);
+
+	/**
+	* Set the peer with index 'index' to ip 'ip' and port 'port'. Only called by one thread
+	**/
+	void set(unsigned short index, unsigned int ip, unsigned short port);
+
+	/**
+	* Set 'ip' and 'port' to the peer with index 'index'. Returns false if it is unknown
+	* or was changed while it was read. Called by any thread
+	**/
+	bool get(unsigned short index, unsigned int &ip, unsigned short &port);
+
+private:
+	SPeerIndexEntry *entries;
+};
+
+#endif //PEERINDEX_H
@@ -0,0 +1,174 @@
+/**
+* Waits for events on multiple sockets. Uses epoll on Linux and select otherwise.
+**/
+
+#include "socket_header.h"
+#include "poller.h"
+#include "log.h"
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+//Maximal number of events returned by one wait
+const int poll_max_events=64;
+
+#ifdef __linux__
+
+/**
+* Convert POLL_READ/POLL_WRITE to epoll events
+**/
+unsigned int toEpollEvents(int events)
+{
+	unsigned int ret=0;
+	if(events & POLL_READ)
+		ret|=EPOLLIN;
+	if(events & POLL_WRITE)
+		ret|=EPOLLOUT;
+	return ret;
+}
+
+CPoller::CPoller(void)
+{
+	epfd=epoll_create(poll_max_events);
+	if(epfd==-1)
+	{
+		log("Error creating epoll instance");
+	}
+}
+
+CPoller::~CPoller(void)
+{
+	close(epfd);
+}
+
+/**
+* Wait for the events 'events' (POLL_READ and/or POLL_WRITE) on socket 's'
+**/
+bool CPoller::add(SOCKET s, int events)
+{
+	epoll_event ev;
+	ev.events=toEpollEvents(events);
+	ev.data.fd=s;
+	return epoll_ctl(epfd, EPOLL_CTL_ADD, s, &ev)==0;
+}
+
+/**
+* Change the events socket 's' is waited for to 'events'
+**/
+bool CPoller::modify(SOCKET s, int events)
+{
+	epoll_event ev;
+	ev.events=toEpollEvents(events);
+	ev.data.fd=s;
+	return epoll_ctl(epfd, EPOLL_CTL_MOD, s, &ev)==0;
+}
+
+/**
+* Stop waiting for events on socket 's'
+**/
+void CPoller::remove(SOCKET s)
+{
+	epoll_event ev;
+	epoll_ctl(epfd, EPOLL_CTL_DEL, s, &ev);
+}
+
+/**
+* Wait at most 'timeoutms' ms for events and save them in 'ret'
+**/
+void CPoller::wait(unsigned int timeoutms, std::vector<SPollEvent> &ret)
+{
+	ret.clear();
+	epoll_event evs[poll_max_events];
+	int rc=epoll_wait(epfd, evs, poll_max_events, (int)timeoutms);
+	for(int i=0;i<rc;++i)
+	{
+		SPollEvent pe;
+		pe.s=evs[i].data.fd;
+		pe.events=0;
+		//Errors and closed connections are reported when reading
+		if(evs[i].events & (EPOLLIN|EPOLLERR|EPOLLHUP))
+			pe.events|=POLL_READ;
+		if(evs[i].events & EPOLLOUT)
+			pe.events|=POLL_WRITE;
+		ret.push_back(pe);
+	}
+}
+
+#else //__linux__
+
+CPoller::CPoller(void)
+{
+}
+
+CPoller::~CPoller(void)
+{
+}
+
+/**
+* Wait for the events 'events' (POLL_READ and/or POLL_WRITE) on socket 's'
+**/
+bool CPoller::add(SOCKET s, int events)
+{
+	sockets[s]=events;
+	return true;
+}
+
+/**
+* Change the events socket 's' is waited for to 'events'
+**/
+bool CPoller::modify(SOCKET s, int events)
+{
+	sockets[s]=events;
+	return true;
+}
+
+/**
+* Stop waiting for events on socket 's'
+**/
+void CPoller::remove(SOCKET s)
+{
+	sockets.erase(s);
+}
+
+/**
+* Wait at most 'timeoutms' ms for events and save them in 'ret'
+**/
+void CPoller::wait(unsigned int timeoutms, std::vector<SPollEvent> &ret)
+{
+	ret.clear();
+	fd_set readset;
+	fd_set writeset;
+	FD_ZERO(&readset);
+	FD_ZERO(&writeset);
+	SOCKET max=0;
+	for(std::map<SOCKET, int>::iterator it=sockets.begin();it!=sockets.end();++it)
+	{
+		if(it->first>max)
+			max=it->first;
+		if(it->second & POLL_READ)
+			FD_SET(it->first, &readset);
+		if(it->second & POLL_WRITE)
+			FD_SET(it->first, &writeset);
+	}
+	timeval lon;
+	lon.tv_sec=timeoutms/1000;
+	lon.tv_usec=timeoutms%1000*1000;
+	int rc=select((int)max+1, &readset, &writeset, 0, &lon);
+	if(rc<=0)
+		return;
+
+	for(std::map<SOCKET, int>::iterator it=sockets.begin();it!=sockets.end();++it)
+	{
+		SPollEvent pe;
+		pe.s=it->first;
+		pe.events=0;
+		if(FD_ISSET(it->first, &readset))
+			pe.events|=POLL_READ;
+		if(FD_ISSET(it->first, &writeset))
+			pe.events|=POLL_WRITE;
+		if(pe.events!=0)
+			ret.push_back(pe);
+	}
+}
+
+#endif //__linux__
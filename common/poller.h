@@ -0,0 +1,60 @@
+/**
+* Waits for events on multiple sockets. Uses epoll on Linux and select otherwise.
+**/
+
+#ifndef POLLER_H_
+#define POLLER_H_
+
+#include "types.h"
+#include <vector>
+#include <map>
+
+//Socket is readable, closed or has an error
+const int POLL_READ=1;
+//Socket is writable
+const int POLL_WRITE=2;
+
+/**
+* Event on a socket
+**/
+struct SPollEvent
+{
+	SOCKET s;
+	int events;
+};
+
+class CPoller
+{
+public:
+	CPoller(void);
+	~CPoller(void);
+
+	/**
+	* Wait for the events 'events' (POLL_READ and/or POLL_WRITE) on socket 's'
+	**/
+	bool add(SOCKET s, int events);
+
+	/**
+	* Change the events socket 's' is waited for to 'events'
+	**/
+	bool modify(SOCKET s, int events);
+
+	/**
+	* Stop waiting for events on socket 's'
+	**/
+	void remove(SOCKET s);
+
+	/**
+	* Wait at most 'timeoutms' ms for events and save them in 'ret'
+	**/
+	void wait(unsigned int timeoutms, std::vector<SPollEvent> &ret);
+
+private:
+#ifdef __linux__
+	int epfd;
+#else
+	std::map<SOCKET, int> sockets;
+#endif
+};
+
+#endif /*POLLER_H_*/
@@ -0,0 +1,104 @@
+/**
+* Sliding window of the message ids seen last, like the anti-replay window of IPsec.
+* One bit per id in a ring of bits. Ids which wrapped around are compared by their distance.
+**/
+
+#include "replaywindow.h"
+#include <algorithm>
+
+/**
+* Remember the last 'pWidth' ids. The width is rounded up to a power of two, at least 32,
+* so the ring positions stay consecutive when the ids wrap around
+**/
+CReplayWindow::CReplayWindow(unsigned int pWidth)
+{
+	width=32;
+	while(width<pWidth && width<0x80000000)
+		width*=2;
+	bits.resize(width/32, 0);
+	max_id=0;
+	has_max=false;
+	duplicates=0;
+	too_old=0;
+}
+
+/**
+* Mark 'id' as seen. Returns false if it was already seen or is too old for the window
+**/
+bool CReplayWindow::check(unsigned int id)
+{
+	if(!has_max)
+	{
+		has_max=true;
+		max_id=id;
+		setBit(id);
+		return true;
+	}
+
+	int diff=(int)(id-max_id);
+	if(diff>0)
+	{
+		//Slide the window. The ids skipped over were not seen yet
+		if((unsigned int)diff>=width)
+		{
+			std::fill(bits.begin(), bits.end(), 0);
+		}
+		else
+		{
+			for(unsigned int k=max_id+1;k!=id;++k)
+				clearBit(k);
+		}
+		max_id=id;
+		setBit(id);
+		return true;
+	}
+
+	if(max_id-id>=width)
+	{
+		++too_old;
+		return false;
+	}
+
+	if(getBit(id))
+	{
+		++duplicates;
+		return false;
+	}
+
+	setBit(id);
+	return true;
+}
+
+/**
+* Returns the number of ids which were seen before
+**/
+unsigned int CReplayWindow::getDuplicates(void)
+{
+	return duplicates;
+}
+
+/**
+* Returns the number of ids which were too old for the window
+**/
+unsigned int CReplayWindow::getTooOld(void)
+{
+	return too_old;
+}
+
+void CReplayWindow::setBit(unsigned int id)
+{
+	unsigned int pos=id&(width-1);
+	bits[pos/32]|=1U<<(pos%32);
+}
+
+void CReplayWindow::clearBit(unsigned int id)
+{
+	unsigned int pos=id&(width-1);
+	bits[pos/32]&=~(1U<<(pos%32));
+}
+
+bool CReplayWindow::getBit(unsigned int id)
+{
+	unsigned int pos=id&(width-1);
+	return (bits[pos/32] & (1U<<(pos%32)))!=0;
+}
@@ -0,0 +1,54 @@
+/**
+* Sliding window of the message ids seen last, like the anti-replay window of IPsec.
+* One bit per id in a ring of bits. Ids which wrapped around are compared by their distance.
+**/
+
+#ifndef REPLAYWINDOW_H
+#define REPLAYWINDOW_H
+
+#include <vector>
+
+//Default number of ids the window covers
+const unsigned int replay_default_width=1024;
+
+class CReplayWindow
+{
+public:
+	/**
+	* Remember the last 'pWidth' ids. The width is rounded up to a power of two, at least 32,
+	* so the ring positions stay consecutive when the ids wrap around
+	**/
+	CReplayWindow(unsigned int pWidth=replay_default_width);
+
+	/**
+	* Mark 'id' as seen. Returns false if it was already seen or is too old for the window
+	**/
+	bool check(unsigned int id);
+
+	/**
+	* Returns the number of ids which were seen before
+	**/
+	unsigned int getDuplicates(void);
+
+	/**
+	* Returns the number of ids which were too old for the window
+	**/
+	unsigned int getTooOld(void);
+
+private:
+	void setBit(unsigned int id);
+	void clearBit(unsigned int id);
+	bool getBit(unsigned int id);
+
+	std::vector<unsigned int> bits;
+	unsigned int width;
+
+	//Newest id seen and if there is one
+	unsigned int max_id;
+	bool has_max;
+
+	unsigned int duplicates;
+	unsigned int too_old;
+};
+
+#endif //REPLAYWINDOW_H
@@ -1,4 +1,4 @@
-
-const unsigned short tracker_port=5713;
-const unsigned short output_port=5714;
+
+const unsigned short tracker_port=5713;
+const unsigned short output_port=5714;
 const unsigned short client_controller_port=5715;
\ No newline at end of file
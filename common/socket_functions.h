@@ -9,8 +9,18 @@
 #include <vector>
 #include <string>
 
+/**
+* Buffer of a send with multiple buffers
+**/
+struct SSendBuf
+{
+	const char *buf;
+	size_t bsize;
+};
+
 SOCKET os_createSocket(bool pUDP=true);
 int os_sendto(SOCKET s, unsigned int ip, unsigned short port, const char *buffer, unsigned int bsize);
+int os_sendtov(SOCKET s, unsigned int ip, unsigned short port, const SSendBuf *bufs, size_t count);
 int os_recvfrom(SOCKET s, char *buffer, unsigned int bsize, unsigned int &fromip, unsigned short &fromport);
 bool os_bind(SOCKET s, unsigned short port);
 unsigned short os_getsocketport(SOCKET s);
@@ -20,12 +30,18 @@ SOCKET os_accept(SOCKET s, unsigned int *ip=NULL);
 bool os_listen(SOCKET s, int count);
 int os_recv(SOCKET s, char *buffer, size_t blen);
 int os_send(SOCKET s, const char *buffer, size_t blen);
+int os_sendv(SOCKET s, const SSendBuf *bufs, size_t count);
 unsigned int os_resolv(std::string name);
 bool os_connect(SOCKET s, unsigned int server_ip, unsigned short server_port);
 void os_nagle(SOCKET s, bool b);
 bool os_set_recv_window(SOCKET s, unsigned int size);
 bool os_set_send_window(SOCKET s, unsigned int size);
+bool os_set_reuseport(SOCKET s);
+bool os_join_multicast(SOCKET s, unsigned int group_ip);
+bool os_is_multicast(unsigned int ip);
 void os_closesocket(SOCKET s);
+bool os_set_nonblocking(SOCKET s, bool b);
+bool os_would_block(void);
 
 #ifndef SOCKET_ERROR
 #	define SOCKET_ERROR -1
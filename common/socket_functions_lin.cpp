@@ -1,87 +1,128 @@
-#include <memory.h>
-#include "socket_header.h"
-#include "socket_functions.h"
-#include "log.h"
-
-bool setSockP(SOCKET sock)
-{
-#ifdef _WIN32
-		DWORD dwBytesReturned = 0;
-		BOOL bNewBehavior = FALSE;
-		int status;
-
-		// disable  new behavior using
-		// IOCTL: SIO_UDP_CONNRESET
-		#define SIO_UDP_CONNRESET _WSAIOW(IOC_VENDOR,12)
-		status = WSAIoctl(sock, SIO_UDP_CONNRESET,
-						&bNewBehavior, sizeof(bNewBehavior),
-					NULL, 0, &dwBytesReturned,
-					NULL, NULL);
-		if (SOCKET_ERROR == status)
-		{
-			return false;
-		}
-#endif
-        return true;
-}
-
-SOCKET os_createSocket(bool pUDP)
-{
-#ifdef _WIN32
-	WSADATA wsadata;
-	int rc = WSAStartup(MAKEWORD(2,0), &wsadata);
-	if(rc == SOCKET_ERROR)	return 0;
-#endif
-
-
-	SOCKET s;
-	if(pUDP)
-	{
-		s= socket(AF_INET, SOCK_DGRAM, 0);	
-		setSockP(s);
-	}
-	else
-	{
-		s=socket(AF_INET, SOCK_STREAM, 0);
-	}
-	return s;
-}
-
-int os_sendto(SOCKET s, unsigned int ip, unsigned short port, const char *buffer, unsigned int bsize)
-{
-	sockaddr_in addr;
-	addr.sin_addr.s_addr=ip;
-	addr.sin_port=htons( port );
-	addr.sin_family=AF_INET;
-	
-	return sendto(s, buffer, bsize, MSG_NOSIGNAL, (sockaddr*)&addr, sizeof(sockaddr_in) );
-}
-
-int os_recvfrom(SOCKET s, char *buffer, unsigned int bsize, unsigned int &fromip, unsigned short &fromport)
-{
-	socklen_t sockaddrlen=sizeof(sockaddr_in);
-	sockaddr_in addr;
-	int rc=recvfrom(s, buffer, bsize, 0, (sockaddr*)&addr, &sockaddrlen);
-	fromip=addr.sin_addr.s_addr;
-	fromport=ntohs(addr.sin_port);
-	return rc;	 
-}
-
-bool os_bind(SOCKET s, unsigned short port)
-{
-	sockaddr_in addr;
-	memset(&addr, 0, sizeof(sockaddr_in));
-	addr.sin_family=AF_INET;
-	addr.sin_port=htons(port);
-	addr.sin_addr.s_addr=INADDR_ANY;
-	int rc=bind(s,(sockaddr*)&addr,sizeof(addr));
-	if(rc==-1)
-	{
-		return false;
-	}
-	else
-		return true;
-}
+#include <memory.h>
+#include "socket_header.h"
+#include "socket_functions.h"
+#include "log.h"
+
+bool setSockP(SOCKET sock)
+{
+#ifdef _WIN32
+		DWORD dwBytesReturned = 0;
+		BOOL bNewBehavior = FALSE;
+		int status;
+
+		// disable  new behavior using
+		// IOCTL: SIO_UDP_CONNRESET
+		#define SIO_UDP_CONNRESET _WSAIOW(IOC_VENDOR,12)
+		status = WSAIoctl(sock, SIO_UDP_CONNRESET,
+						&bNewBehavior, sizeof(bNewBehavior),
+					NULL, 0, &dwBytesReturned,
+					NULL, NULL);
+		if (SOCKET_ERROR == status)
+		{
+			return false;
+		}
+#endif
+        return true;
+}
+
+SOCKET os_createSocket(bool pUDP)
+{
+#ifdef _WIN32
+	WSADATA wsadata;
+	int rc = WSAStartup(MAKEWORD(2,0), &wsadata);
+	if(rc == SOCKET_ERROR)	return 0;
+#endif
+
+
+	SOCKET s;
+	if(pUDP)
+	{
+		s= socket(AF_INET, SOCK_DGRAM, 0);	
+		setSockP(s);
+	}
+	else
+	{
+		s=socket(AF_INET, SOCK_STREAM, 0);
+	}
+	return s;
+}
+
+int os_sendto(SOCKET s, unsigned int ip, unsigned short port, const char *buffer, unsigned int bsize)
+{
+	sockaddr_in addr;
+	addr.sin_addr.s_addr=ip;
+	addr.sin_port=htons( port );
+	addr.sin_family=AF_INET;
+	
+	return sendto(s, buffer, bsize, MSG_NOSIGNAL, (sockaddr*)&addr, sizeof(sockaddr_in) );
+}
+
+//Maximal number of buffers one datagram is gathered from
+const size_t sendtov_max_bufs=8;
+
+int os_sendtov(SOCKET s, unsigned int ip, unsigned short port, const SSendBuf *bufs, size_t count)
+{
+	if(count>sendtov_max_bufs)
+		return SOCKET_ERROR;
+
+	sockaddr_in addr;
+	addr.sin_addr.s_addr=ip;
+	addr.sin_port=htons( port );
+	addr.sin_family=AF_INET;
+
+#ifdef _WIN32
+	WSABUF wsabufs[sendtov_max_bufs];
+	for(size_t i=0;i<count;++i)
+	{
+		wsabufs[i].buf=(CHAR*)bufs[i].buf;
+		wsabufs[i].len=(ULONG)bufs[i].bsize;
+	}
+	DWORD sent=0;
+	if(WSASendTo(s, wsabufs, (DWORD)count, &sent, 0, (sockaddr*)&addr, sizeof(sockaddr_in), NULL, NULL)!=0)
+		return SOCKET_ERROR;
+	return (int)sent;
+#else
+	iovec iov[sendtov_max_bufs];
+	for(size_t i=0;i<count;++i)
+	{
+		iov[i].iov_base=(void*)bufs[i].buf;
+		iov[i].iov_len=bufs[i].bsize;
+	}
+	msghdr msg;
+	memset(&msg, 0, sizeof(msghdr));
+	msg.msg_name=&addr;
+	msg.msg_namelen=sizeof(sockaddr_in);
+	msg.msg_iov=iov;
+	msg.msg_iovlen=count;
+	return sendmsg(s, &msg, MSG_NOSIGNAL);
+#endif
+}
+
+int os_recvfrom(SOCKET s, char *buffer, unsigned int bsize, unsigned int &fromip, unsigned short &fromport)
+{
+	socklen_t sockaddrlen=sizeof(sockaddr_in);
+	sockaddr_in addr;
+	int rc=recvfrom(s, buffer, bsize, 0, (sockaddr*)&addr, &sockaddrlen);
+	fromip=addr.sin_addr.s_addr;
+	fromport=ntohs(addr.sin_port);
+	return rc;	 
+}
+
+bool os_bind(SOCKET s, unsigned short port)
+{
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(sockaddr_in));
+	addr.sin_family=AF_INET;
+	addr.sin_port=htons(port);
+	addr.sin_addr.s_addr=INADDR_ANY;
+	int rc=bind(s,(sockaddr*)&addr,sizeof(addr));
+	if(rc==-1)
+	{
+		return false;
+	}
+	else
+		return true;
+}
 
 unsigned short os_getsocketport(SOCKET s)
 {
@@ -106,12 +147,12 @@ std::vector<SOCKET> os_select(const std::vector<SOCKET> &s, unsigned int timeout
 	SOCKET max=0;
 	for(size_t i=0;i<s.size();++i)
 	{
-		if(max==0 || s[i]>max)
-			max=s[i];
+		if(max==0 || s[i]>max)
+			max=s[i];
 		FD_SET(s[i], &fdset);
 	}
-	timeval lon;
-	lon.tv_sec=timeoutms/1000;
+	timeval lon;
+	lon.tv_sec=timeoutms/1000;
 	lon.tv_usec=timeoutms%1000*1000;
 	int rc = select(max+1, &fdset, 0, 0, &lon);
 
@@ -155,6 +196,64 @@ int os_send(SOCKET s, const char *buffer, size_t blen)
 	return send(s, buffer, blen, MSG_NOSIGNAL);
 }
 
+//Maximal number of buffers passed to one sendmsg call
+const size_t sendv_max_bufs=64;
+
+int os_sendv(SOCKET s, const SSendBuf *bufs, size_t count)
+{
+#ifdef _WIN32
+	std::vector<WSABUF> wsabufs(count);
+	for(size_t i=0;i<count;++i)
+	{
+		wsabufs[i].buf=(CHAR*)bufs[i].buf;
+		wsabufs[i].len=(ULONG)bufs[i].bsize;
+	}
+	DWORD sent=0;
+	if(count==0)
+		return 0;
+	if(WSASend(s, &wsabufs[0], (DWORD)count, &sent, 0, NULL, NULL)!=0)
+		return SOCKET_ERROR;
+	return (int)sent;
+#else
+	iovec iov[sendv_max_bufs];
+	int ret=0;
+	for(size_t i=0;i<count;i+=sendv_max_bufs)
+	{
+		size_t n=count-i;
+		if(n>sendv_max_bufs)
+			n=sendv_max_bufs;
+		for(size_t j=0;j<n;++j)
+		{
+			iov[j].iov_base=(void*)bufs[i+j].buf;
+			iov[j].iov_len=bufs[i+j].bsize;
+		}
+		msghdr msg;
+		memset(&msg, 0, sizeof(msghdr));
+		msg.msg_iov=iov;
+		msg.msg_iovlen=n;
+		int rc=sendmsg(s, &msg, MSG_NOSIGNAL);
+		if(rc<0)
+		{
+			//The bytes of the chunks before were sent and must not be sent again
+			return ret>0?ret:rc;
+		}
+		ret+=rc;
+
+		size_t chunk=0;
+		for(size_t j=0;j<n;++j)
+		{
+			chunk+=iov[j].iov_len;
+		}
+		if((size_t)rc<chunk)
+		{
+			//Sending the next chunk would leave a gap in the stream
+			break;
+		}
+	}
+	return ret;
+#endif
+}
+
 in_addr getIP(std::string ip)
 {
 	const char* host=ip.c_str();
@@ -189,10 +288,10 @@ unsigned int os_resolv(std::string name)
 
 bool os_connect(SOCKET s, unsigned int server_ip, unsigned short server_port)
 {
-	sockaddr_in addr;
-	memset(&addr, 0, sizeof(sockaddr_in));
-	addr.sin_family=AF_INET;
-	addr.sin_port=htons(server_port);
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(sockaddr_in));
+	addr.sin_family=AF_INET;
+	addr.sin_port=htons(server_port);
 	addr.sin_addr.s_addr=server_ip;
 	int rc=connect(s, (sockaddr*)&addr, sizeof(sockaddr_in));
 	return rc>=0;
@@ -217,10 +316,8 @@ void os_nagle(SOCKET s, bool b)
 
 bool os_set_recv_window(SOCKET s, unsigned int size)
 {
-#ifdef _WIN32
 	if(setsockopt(s, SOL_SOCKET, SO_RCVBUF, (char*)&size, sizeof(unsigned int))!=0)
 		return false;
-#endif
 	return true;
 }
 
@@ -231,7 +328,59 @@ bool os_set_send_window(SOCKET s, unsigned int size)
 	return true;
 }
 
+bool os_set_reuseport(SOCKET s)
+{
+#ifdef SO_REUSEPORT
+	int opt=1;
+	if(setsockopt(s, SOL_SOCKET, SO_REUSEPORT, (char*)&opt, sizeof(int))!=0)
+		return false;
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool os_join_multicast(SOCKET s, unsigned int group_ip)
+{
+	ip_mreq mreq;
+	memset(&mreq, 0, sizeof(ip_mreq));
+	mreq.imr_multiaddr.s_addr=group_ip;
+	mreq.imr_interface.s_addr=INADDR_ANY;
+	return setsockopt(s, IPPROTO_IP, IP_ADD_MEMBERSHIP, (char*)&mreq, sizeof(ip_mreq))==0;
+}
+
+bool os_is_multicast(unsigned int ip)
+{
+	return (ntohl(ip) & 0xF0000000)==0xE0000000;
+}
+
 void os_closesocket(SOCKET s)
 {
 	closesocket(s);
+}
+
+bool os_set_nonblocking(SOCKET s, bool b)
+{
+#ifdef _WIN32
+	u_long mode=b?1:0;
+	return ioctlsocket(s, FIONBIO, &mode)==0;
+#else
+	int flags=fcntl(s, F_GETFL, 0);
+	if(flags==-1)
+		return false;
+	if(b)
+		flags|=O_NONBLOCK;
+	else
+		flags&=~O_NONBLOCK;
+	return fcntl(s, F_SETFL, flags)==0;
+#endif
+}
+
+bool os_would_block(void)
+{
+#ifdef _WIN32
+	return WSAGetLastError()==WSAEWOULDBLOCK;
+#else
+	return errno==EAGAIN || errno==EWOULDBLOCK;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef SPSCQUEUE_H_
+#define SPSCQUEUE_H_
+
+#include "os_atomic.h"
+#include <stddef.h>
+
+/**
+* Unbounded queue with one producer and one consumer thread. Neither of them locks.
+* The consumer owns the dummy node in front of the first value, the producer the last node
+**/
+template<typename T>
+class CSPSCQueue
+{
+public:
+	CSPSCQueue(void)
+	{
+		head=new SNode;
+		head->next=NULL;
+		tail=head;
+	}
+
+	~CSPSCQueue(void)
+	{
+		while(head!=NULL)
+		{
+			SNode *next=head->next;
+			delete head;
+			head=next;
+		}
+	}
+
+	/**
+	* Append 'value'. Only called by the producer
+	**/
+	void push(const T &value)
+	{
+		SNode *n=new SNode;
+		n->value=value;
+		n->next=NULL;
+		os_atomic_store_ptr(&tail->next, n);
+		tail=n;
+	}
+
+	/**
+	* Remove the first value and save it in 'value'. Returns false if the queue
+	* is empty. Only called by the consumer
+	**/
+	bool pop(T &value)
+	{
+		SNode *next=os_atomic_load_ptr(&head->next);
+		if(next==NULL)
+			return false;
+
+		value=next->value;
+		//The node becomes the dummy node. Don't keep the value alive in it
+		next->value=T();
+		delete head;
+		head=next;
+		return true;
+	}
+
+	/**
+	* Returns if there is no value to pop. Only called by the consumer
+	**/
+	bool empty(void)
+	{
+		return os_atomic_load_ptr(&head->next)==NULL;
+	}
+
+private:
+	struct SNode
+	{
+		T value;
+		SNode * volatile next;
+	};
+
+	SNode *head;
+	SNode *tail;
+};
+
+#endif /*SPSCQUEUE_H_*/
@@ -0,0 +1,62 @@
+/**
+* Token bucket to pace sending to a rate in bytes/s. The bucket fills up to its burst size.
+* Messages with priority may empty it. Others only use the tokens above a reserve.
+**/
+
+#include "tokenbucket.h"
+#include "os_functions.h"
+
+/**
+* Allow 'pRate' bytes/s with bursts of up to 'pBurst' bytes. The bucket starts full
+**/
+CTokenBucket::CTokenBucket(unsigned int pRate, unsigned int pBurst) : rate(pRate), burst(pBurst)
+{
+	tokens=burst;
+	last_refill=os_gettimems();
+}
+
+/**
+* Take the tokens for a message of 'bytes' bytes if at least 'reserve' tokens are left afterwards.
+* Returns false if there are not enough tokens
+**/
+bool CTokenBucket::take(size_t bytes, unsigned int reserve)
+{
+	refill();
+	if(tokens<(double)bytes+reserve)
+		return false;
+
+	tokens-=bytes;
+	return true;
+}
+
+/**
+* Returns the time in ms until the tokens for a message of 'bytes' bytes are there
+**/
+unsigned int CTokenBucket::getWait(size_t bytes)
+{
+	refill();
+	if(tokens>=(double)bytes || rate==0)
+		return 0;
+
+	return (unsigned int)(((double)bytes-tokens)*1000.0/rate)+1;
+}
+
+/**
+* Returns the rate in bytes/s
+**/
+unsigned int CTokenBucket::getRate(void)
+{
+	return rate;
+}
+
+/**
+* Add the tokens of the time since the last refill
+**/
+void CTokenBucket::refill(void)
+{
+	unsigned int ctime=os_gettimems();
+	tokens+=(double)(ctime-last_refill)*rate/1000.0;
+	if(tokens>burst)
+		tokens=burst;
+	last_refill=ctime;
+}
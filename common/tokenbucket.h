@@ -0,0 +1,47 @@
+/**
+* Token bucket to pace sending to a rate in bytes/s. The bucket fills up to its burst size.
+* Messages with priority may empty it. Others only use the tokens above a reserve.
+**/
+
+#ifndef TOKENBUCKET_H
+#define TOKENBUCKET_H
+
+#include <stddef.h>
+
+class CTokenBucket
+{
+public:
+	/**
+	* Allow 'pRate' bytes/s with bursts of up to 'pBurst' bytes. The bucket starts full
+	**/
+	CTokenBucket(unsigned int pRate, unsigned int pBurst);
+
+	/**
+	* Take the tokens for a message of 'bytes' bytes if at least 'reserve' tokens are left afterwards.
+	* Returns false if there are not enough tokens
+	**/
+	bool take(size_t bytes, unsigned int reserve);
+
+	/**
+	* Returns the time in ms until the tokens for a message of 'bytes' bytes are there
+	**/
+	unsigned int getWait(size_t bytes);
+
+	/**
+	* Returns the rate in bytes/s
+	**/
+	unsigned int getRate(void);
+
+private:
+	/**
+	* Add the tokens of the time since the last refill
+	**/
+	void refill(void);
+
+	unsigned int rate;
+	unsigned int burst;
+	double tokens;
+	unsigned int last_refill;
+};
+
+#endif //TOKENBUCKET_H
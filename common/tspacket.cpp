@@ -0,0 +1,184 @@
+/**
+* Functions to find and frame MPEG transport stream packets
+**/
+
+#include "tspacket.h"
+#include <memory.h>
+
+/**
+* Returns the offset of the first packet in 'buf' of size 'bsize' at or after 'off'. A packet
+* starts with a sync byte which is followed by another one a packet later. Returns 'bsize' if
+* there is none
+**/
+size_t ts_find_sync(const char *buf, size_t bsize, size_t off)
+{
+	//memchr compares many bytes at once
+	while(off+ts_packet_size<bsize)
+	{
+		const char *p=(const char*)memchr(buf+off, ts_sync_byte, bsize-ts_packet_size-off);
+		if(p==NULL)
+			return bsize;
+
+		off=p-buf;
+		if(buf[off+ts_packet_size]==ts_sync_byte)
+			return off;
+		++off;
+	}
+	return bsize;
+}
+
+/**
+* Returns the number of complete packets in 'buf' of size 'bsize' starting at 'off' which
+* follow each other and all start with a sync byte
+**/
+size_t ts_count_packets(const char *buf, size_t bsize, size_t off)
+{
+	size_t n=0;
+	while(off+ts_packet_size<=bsize && buf[off]==ts_sync_byte)
+	{
+		++n;
+		off+=ts_packet_size;
+	}
+	return n;
+}
+
+/**
+* Returns if the packet 'pkt' has the random access indicator set. Decoding can start at such a packet
+**/
+bool ts_is_random_access(const char *pkt)
+{
+	//Adaptation field present, not empty and random access indicator set
+	return (pkt[3] & 0x20)!=0 && (unsigned char)pkt[4]>0 && (pkt[5] & 0x40)!=0;
+}
+
+/**
+* Returns the PID of the packet 'pkt'
+**/
+unsigned short ts_get_pid(const char *pkt)
+{
+	return (unsigned short)((((unsigned char)pkt[1] & 0x1f)<<8) | (unsigned char)pkt[2]);
+}
+
+/**
+* Returns if the packet 'pkt' starts a program association table
+**/
+bool ts_is_pat_start(const char *pkt)
+{
+	//Payload unit start indicator set
+	return ts_get_pid(pkt)==ts_pat_pid && (pkt[1] & 0x40)!=0;
+}
+
+/**
+* Reads the program clock reference base of the packet 'pkt' into 'pcr'. Returns false if the
+* packet has none
+**/
+bool ts_get_pcr(const char *pkt, boost::uint64_t &pcr)
+{
+	//Adaptation field present, long enough and PCR flag set
+	if((pkt[3] & 0x20)==0 || (unsigned char)pkt[4]<7 || (pkt[5] & 0x10)==0)
+		return false;
+
+	const unsigned char *p=(const unsigned char*)&pkt[6];
+	pcr=((boost::uint64_t)p[0]<<25) | ((boost::uint64_t)p[1]<<17) | ((boost::uint64_t)p[2]<<9)
+		| ((boost::uint64_t)p[3]<<1) | (p[4]>>7);
+	return true;
+}
+
+CTSFramer::CTSFramer(void)
+{
+	carry_size=0;
+	in_sync=false;
+	sync_losses=0;
+}
+
+/**
+* Frame the next buffer 'buf' of size 'bsize' and add the complete packets to 'out'.
+* The added buffers are valid until 'buf' is freed or the next call
+**/
+void CTSFramer::frame(const char *buf, size_t bsize, std::vector<SSendBuf> &out)
+{
+	size_t off=0;
+	if(in_sync && carry_size>0)
+	{
+		size_t left=ts_packet_size-carry_size;
+		if(left>bsize)
+		{
+			memcpy(&carry[carry_size], buf, bsize);
+			carry_size+=bsize;
+			return;
+		}
+		else if(left==bsize || buf[left]==ts_sync_byte)
+		{
+			memcpy(packet, carry, carry_size);
+			memcpy(&packet[carry_size], buf, left);
+			SSendBuf sb;
+			sb.buf=packet;
+			sb.bsize=ts_packet_size;
+			out.push_back(sb);
+			off=left;
+		}
+		else
+		{
+			++sync_losses;
+			in_sync=false;
+		}
+		carry_size=0;
+	}
+
+	if(!in_sync)
+	{
+		off=ts_find_sync(buf, bsize, off);
+		if(off>=bsize)
+			return;
+		in_sync=true;
+	}
+
+	while(off<bsize)
+	{
+		size_t n=ts_count_packets(buf, bsize, off);
+		if(n>0)
+		{
+			SSendBuf sb;
+			sb.buf=&buf[off];
+			sb.bsize=n*ts_packet_size;
+			out.push_back(sb);
+			off+=sb.bsize;
+		}
+
+		if(off>=bsize)
+			break;
+
+		if(buf[off]==ts_sync_byte)
+		{
+			//Packet continues in the next buffer
+			carry_size=bsize-off;
+			memcpy(carry, &buf[off], carry_size);
+			break;
+		}
+
+		++sync_losses;
+		off=ts_find_sync(buf, bsize, off+1);
+		if(off>=bsize)
+		{
+			in_sync=false;
+			break;
+		}
+	}
+}
+
+/**
+* Drop the incomplete packet and search for the next sync byte. Used if buffers are skipped
+**/
+void CTSFramer::reset(void)
+{
+	carry_size=0;
+	in_sync=false;
+}
+
+/**
+* Returns how often the sync was lost
+**/
+unsigned int CTSFramer::getSyncLosses(void)
+{
+	return sync_losses;
+}
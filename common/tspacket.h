@@ -0,0 +1,94 @@
+/**
+* Functions to find and frame MPEG transport stream packets
+**/
+
+#ifndef TSPACKET_H
+#define TSPACKET_H
+
+#include <vector>
+#include <stddef.h>
+#include <boost/cstdint.hpp>
+#include "socket_functions.h"
+
+//Size of a transport stream packet
+const size_t ts_packet_size=188;
+//First byte of every transport stream packet
+const char ts_sync_byte=0x47;
+//PID of the program association table
+const unsigned short ts_pat_pid=0;
+//Ticks per second of the program clock reference base
+const unsigned int ts_pcr_hz=90000;
+//Program clock reference base values wrap around at this value
+const boost::uint64_t ts_pcr_wrap=(boost::uint64_t)1<<33;
+
+/**
+* Returns the offset of the first packet in 'buf' of size 'bsize' at or after 'off'. A packet
+* starts with a sync byte which is followed by another one a packet later. Returns 'bsize' if
+* there is none
+**/
+size_t ts_find_sync(const char *buf, size_t bsize, size_t off);
+
+/**
+* Returns the number of complete packets in 'buf' of size 'bsize' starting at 'off' which
+* follow each other and all start with a sync byte
+**/
+size_t ts_count_packets(const char *buf, size_t bsize, size_t off);
+
+/**
+* Returns if the packet 'pkt' has the random access indicator set. Decoding can start at such a packet
+**/
+bool ts_is_random_access(const char *pkt);
+
+/**
+* Returns the PID of the packet 'pkt'
+**/
+unsigned short ts_get_pid(const char *pkt);
+
+/**
+* Returns if the packet 'pkt' starts a program association table
+**/
+bool ts_is_pat_start(const char *pkt);
+
+/**
+* Reads the program clock reference base of the packet 'pkt' into 'pcr'. Returns false if the
+* packet has none
+**/
+bool ts_get_pcr(const char *pkt, boost::uint64_t &pcr);
+
+/**
+* Cuts a stream of buffers into transport stream packets. Packets within a buffer are returned as
+* contiguous runs pointing into the buffer. A packet spanning two buffers is copied.
+**/
+class CTSFramer
+{
+public:
+	CTSFramer(void);
+
+	/**
+	* Frame the next buffer 'buf' of size 'bsize' and add the complete packets to 'out'.
+	* The added buffers are valid until 'buf' is freed or the next call
+	**/
+	void frame(const char *buf, size_t bsize, std::vector<SSendBuf> &out);
+
+	/**
+	* Drop the incomplete packet and search for the next sync byte. Used if buffers are skipped
+	**/
+	void reset(void);
+
+	/**
+	* Returns how often the sync was lost
+	**/
+	unsigned int getSyncLosses(void);
+
+private:
+	//Start of a packet spanning two buffers
+	char carry[ts_packet_size];
+	size_t carry_size;
+	//Complete packet spanning two buffers
+	char packet[ts_packet_size];
+
+	bool in_sync;
+	unsigned int sync_losses;
+};
+
+#endif //TSPACKET_H
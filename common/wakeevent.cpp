@@ -0,0 +1,99 @@
+/**
+* Event to wake a thread waiting for work. Uses an eventfd on Linux and a condition otherwise.
+* A signal sent while no thread waits is kept until the next wait.
+**/
+
+#include "wakeevent.h"
+#include "log.h"
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#else
+#include <boost/thread/xtime.hpp>
+#endif
+
+#ifdef __linux__
+
+CWakeEvent::CWakeEvent(void)
+{
+	fd=eventfd(0, EFD_NONBLOCK);
+	if(fd==-1)
+	{
+		log("Error creating eventfd");
+	}
+}
+
+CWakeEvent::~CWakeEvent(void)
+{
+	close(fd);
+}
+
+/**
+* Wake the waiting thread
+**/
+void CWakeEvent::signal(void)
+{
+	eventfd_write(fd, 1);
+}
+
+/**
+* Wait until the event is signalled or 'timeoutms' ms passed. Clears the signal
+**/
+void CWakeEvent::wait(unsigned int timeoutms)
+{
+	pollfd pfd;
+	pfd.fd=fd;
+	pfd.events=POLLIN;
+	pfd.revents=0;
+	if(poll(&pfd, 1, (int)timeoutms)>0)
+	{
+		eventfd_t val;
+		eventfd_read(fd, &val);
+	}
+}
+
+#else //__linux__
+
+CWakeEvent::CWakeEvent(void)
+{
+	signalled=false;
+}
+
+CWakeEvent::~CWakeEvent(void)
+{
+}
+
+/**
+* Wake the waiting thread
+**/
+void CWakeEvent::signal(void)
+{
+	boost::mutex::scoped_lock lock(mutex);
+	signalled=true;
+	cond.notify_one();
+}
+
+/**
+* Wait until the event is signalled or 'timeoutms' ms passed. Clears the signal
+**/
+void CWakeEvent::wait(unsigned int timeoutms)
+{
+	boost::mutex::scoped_lock lock(mutex);
+	if(!signalled)
+	{
+		boost::xtime xt;
+		boost::xtime_get(&xt, boost::TIME_UTC);
+		xt.sec+=timeoutms/1000;
+		xt.nsec+=(timeoutms%1000)*1000000;
+		if(xt.nsec>=1000000000)
+		{
+			++xt.sec;
+			xt.nsec-=1000000000;
+		}
+		cond.timed_wait(lock, xt);
+	}
+	signalled=false;
+}
+
+#endif //__linux__
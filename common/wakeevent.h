@@ -0,0 +1,40 @@
+/**
+* Event to wake a thread waiting for work. Uses an eventfd on Linux and a condition otherwise.
+* A signal sent while no thread waits is kept until the next wait.
+**/
+
+#ifndef WAKEEVENT_H
+#define WAKEEVENT_H
+
+#ifndef __linux__
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
+#endif
+
+class CWakeEvent
+{
+public:
+	CWakeEvent(void);
+	~CWakeEvent(void);
+
+	/**
+	* Wake the waiting thread
+	**/
+	void signal(void);
+
+	/**
+	* Wait until the event is signalled or 'timeoutms' ms passed. Clears the signal
+	**/
+	void wait(unsigned int timeoutms);
+
+private:
+#ifdef __linux__
+	int fd;
+#else
+	boost::mutex mutex;
+	boost::condition cond;
+	bool signalled;
+#endif
+};
+
+#endif //WAKEEVENT_H
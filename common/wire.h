@@ -0,0 +1,212 @@
+#ifndef WIRE_H_
+#define WIRE_H_
+
+/**
+* Version 2 of the wire format. The messages start with a marker byte no message type of
+* version 1 uses, followed by the message type, so peers of both versions can coexist.
+* The headers have a fixed layout in network byte order and are read in place.
+* Every field consists of bytes, so the structures have no padding and no alignment requirements.
+**/
+
+#include <memory.h>
+#include <stddef.h>
+
+//Versions of the wire format
+const unsigned char wire_version_1=1;
+const unsigned char wire_version_2=2;
+//First byte of each message in version 2
+const unsigned char wire_v2_marker=0xF2;
+//Features a client of version 2 announces to the tracker in addition to the version.
+//With the peer index it resolves the compact exploration messages (CC_DATA_COMPACT)
+const unsigned char wire_feature_peer_index=1;
+//Peer index which is never assigned
+const unsigned short no_peer_index=0xFFFF;
+
+/**
+* Read a 16 bit value in network byte order from 'p'
+**/
+inline unsigned short wire_get16(const unsigned char *p)
+{
+	return (unsigned short)((p[0]<<8)|p[1]);
+}
+
+/**
+* Read a 32 bit value in network byte order from 'p'
+**/
+inline unsigned int wire_get32(const unsigned char *p)
+{
+	return ((unsigned int)p[0]<<24)|((unsigned int)p[1]<<16)|((unsigned int)p[2]<<8)|p[3];
+}
+
+/**
+* Write the 16 bit value 'v' in network byte order to 'p'
+**/
+inline void wire_put16(unsigned char *p, unsigned short v)
+{
+	p[0]=(unsigned char)(v>>8);
+	p[1]=(unsigned char)v;
+}
+
+/**
+* Write the 32 bit value 'v' in network byte order to 'p'
+**/
+inline void wire_put32(unsigned char *p, unsigned int v)
+{
+	p[0]=(unsigned char)(v>>24);
+	p[1]=(unsigned char)(v>>16);
+	p[2]=(unsigned char)(v>>8);
+	p[3]=(unsigned char)v;
+}
+
+/**
+* Read an IPv4 address from 'p'. Addresses are kept like in sockaddr_in, which
+* is already in network byte order, so the bytes are copied unchanged
+**/
+inline unsigned int wire_get_ip(const unsigned char *p)
+{
+	unsigned int ip;
+	memcpy(&ip, p, sizeof(unsigned int));
+	return ip;
+}
+
+/**
+* Write the IPv4 address 'ip' (in network byte order, like in sockaddr_in) to 'p'
+**/
+inline void wire_put_ip(unsigned char *p, unsigned int ip)
+{
+	memcpy(p, &ip, sizeof(unsigned int));
+}
+
+/**
+* Header of a message sent through the trees (CC_SPREAD) or a retransmission (CC_RESEND).
+* The payload follows
+**/
+struct SWireSpread
+{
+	unsigned char marker;
+	unsigned char type;
+	unsigned char channel[2];
+	unsigned char msgid[4];
+	unsigned char buf_size[2];
+};
+
+/**
+* Header of an exploration message (CC_DATA). 'nhops' SWireHop and the payload follow
+**/
+struct SWireData
+{
+	unsigned char marker;
+	unsigned char type;
+	unsigned char channel[2];
+	unsigned char msgid[4];
+	unsigned char buf_size[2];
+	unsigned char nhops;
+	unsigned char curr_hop;
+};
+
+/**
+* A hop of an exploration message
+**/
+struct SWireHop
+{
+	unsigned char ip[4];
+	unsigned char port[2];
+};
+
+/**
+* A hop of a compact exploration message (CC_DATA_COMPACT). It has the header of CC_DATA.
+* The peer index the tracker assigned replaces ip and port
+**/
+struct SWireHopIndex
+{
+	unsigned char index[2];
+};
+
+/**
+* Acknowledgement of an exploration message (TRACKER_ACK)
+**/
+struct SWireAck
+{
+	unsigned char marker;
+	unsigned char type;
+	unsigned char source_port[2];
+	unsigned char msgid[4];
+	unsigned char source_ip[4];
+};
+
+/**
+* Header of a tree message (TRACKER_TREE). 'nnodes' SWireNode follow
+**/
+struct SWireTree
+{
+	unsigned char marker;
+	unsigned char type;
+	unsigned char channel[2];
+	unsigned char k[2];
+	unsigned char slices[2];
+	unsigned char nnodes[2];
+};
+
+/**
+* A child in a tree message
+**/
+struct SWireNode
+{
+	unsigned char ip[4];
+	unsigned char port[2];
+	unsigned char version;
+	unsigned char reserved;
+};
+
+/**
+* Header of a peer index message (TRACKER_PEERS). 'npeers' SWirePeer follow
+**/
+struct SWirePeers
+{
+	unsigned char marker;
+	unsigned char type;
+	unsigned char channel[2];
+	unsigned char npeers[2];
+};
+
+/**
+* A peer in a peer index message
+**/
+struct SWirePeer
+{
+	unsigned char index[2];
+	unsigned char ip[4];
+	unsigned char port[2];
+};
+
+/**
+* A node messages are relayed to and the version of the wire format it understands
+**/
+struct SRelayNode
+{
+	unsigned int ip;
+	unsigned short port;
+	unsigned char version;
+};
+
+/**
+* Set 'msgid' to the message id of the UDP message 'buf' of size 'bsize'. All of them carry
+* the channel and the (first) message id after their type. Returns false if it is too short
+**/
+inline bool wire_get_msgid(const char *buf, size_t bsize, unsigned int &msgid)
+{
+	if(bsize>0 && (unsigned char)buf[0]==wire_v2_marker)
+	{
+		if(bsize<sizeof(SWireSpread))
+			return false;
+		msgid=wire_get32(((const SWireSpread*)buf)->msgid);
+		return true;
+	}
+
+	if(bsize<sizeof(unsigned char)+sizeof(unsigned short)+sizeof(unsigned int))
+		return false;
+	memcpy(&msgid, buf+sizeof(unsigned char)+sizeof(unsigned short), sizeof(unsigned int));
+	return true;
+}
+
+#endif //WIRE_H_
@@ -0,0 +1,199 @@
+/**
+* Measures how fast the messages are constructed and parsed in both versions of the wire format. Not installed.
+* Start with codecbench ([payload size] [hops] [ms per measurement])
+**/
+
+#include "../common/msg_spread.h"
+#include "../common/msg_data.h"
+#include "../common/msg_ack.h"
+#include "../common/msg_tree.h"
+#include "../common/packet_ids.h"
+#include "../common/os_functions.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+
+/**
+* Read the type of the message in 'data' like the receivers do. Returns the version of the message
+**/
+static unsigned char readType(CRData &data)
+{
+	unsigned char type;
+	data.getUChar(&type);
+	if(type==wire_v2_marker)
+	{
+		data.getUChar(&type);
+		return wire_version_2;
+	}
+	return wire_version_1;
+}
+
+/**
+* Print the time per message of 'count' messages constructed and parsed in 'ms'
+**/
+static void printTime(const std::string &name, double count, unsigned int ms)
+{
+	if(ms==0)
+		ms=1;
+	std::cout << name << ": " << (unsigned int)(ms*1000000.0/count+0.5) << " ns, "
+		<< (unsigned int)(count*1000.0/ms+0.5) << " messages/s" << std::endl;
+}
+
+/**
+* Construct and parse spread messages with payload 'buf' of size 'bsize'
+**/
+static unsigned int benchSpread(unsigned char version, const char *buf, size_t bsize, unsigned int duration)
+{
+	double count=0;
+	unsigned int sum=0;
+	unsigned int id=0;
+	unsigned int start=os_gettimems();
+	while(os_gettimems()-start<duration)
+	{
+		for(unsigned int i=0;i<1000;++i,++id)
+		{
+			msg_spread msg(1, id, buf, bsize, version);
+			char sbuf[cwdata_stack_size];
+			CWData data(sbuf, sizeof(sbuf));
+			msg.getMessage(data);
+
+			CRData rdata(data.getDataPtr(), data.getDataSize());
+			msg_spread parsed(rdata, readType(rdata));
+			sum+=parsed.getMsgID()+(unsigned int)parsed.getBuf_size();
+		}
+		count+=1000;
+	}
+	printTime(std::string("msg_spread v")+(char)('0'+version), count, os_gettimems()-start);
+	return sum;
+}
+
+/**
+* Construct and parse exploration messages along 'hops' with payload 'buf' of size 'bsize'.
+* The first hop already forwarded them
+**/
+static unsigned int benchData(unsigned char version, const std::vector<std::pair<unsigned int, unsigned short> > &hops, const char *buf, size_t bsize, unsigned int duration)
+{
+	double count=0;
+	unsigned int sum=0;
+	unsigned int id=0;
+	unsigned int start=os_gettimems();
+	while(os_gettimems()-start<duration)
+	{
+		for(unsigned int i=0;i<1000;++i,++id)
+		{
+			msg_data msg(1, id, hops, buf, bsize, version);
+			msg.incrementHop();
+			char sbuf[cwdata_stack_size];
+			CWData data(sbuf, sizeof(sbuf));
+			msg.getMessage(data);
+
+			CRData rdata(data.getDataPtr(), data.getDataSize());
+			msg_data parsed(rdata, readType(rdata));
+			sum+=parsed.getMsgID()+parsed.getNextHop().second;
+		}
+		count+=1000;
+	}
+	printTime(std::string("msg_data v")+(char)('0'+version), count, os_gettimems()-start);
+	return sum;
+}
+
+/**
+* Construct and parse acknowledgements
+**/
+static unsigned int benchAck(unsigned char version, unsigned int duration)
+{
+	double count=0;
+	unsigned int sum=0;
+	unsigned int id=0;
+	unsigned int start=os_gettimems();
+	while(os_gettimems()-start<duration)
+	{
+		for(unsigned int i=0;i<1000;++i,++id)
+		{
+			msg_ack msg(id, 0x0100007f, 17000, version);
+			char sbuf[cwdata_stack_size];
+			CWData data(sbuf, sizeof(sbuf));
+			msg.getMessage(data);
+
+			CRData rdata(data.getDataPtr(), data.getDataSize());
+			msg_ack parsed(rdata, readType(rdata));
+			sum+=parsed.getMsgID()+parsed.getSourcePort();
+		}
+		count+=1000;
+	}
+	printTime(std::string("msg_ack v")+(char)('0'+version), count, os_gettimems()-start);
+	return sum;
+}
+
+/**
+* Construct and parse tree messages with the children 'nodes'
+**/
+static unsigned int benchTree(unsigned char version, const std::vector<SRelayNode> &nodes, unsigned int duration)
+{
+	double count=0;
+	unsigned int sum=0;
+	unsigned int start=os_gettimems();
+	while(os_gettimems()-start<duration)
+	{
+		for(unsigned int i=0;i<1000;++i)
+		{
+			msg_tree msg(nodes, i%32, 32, 1, version);
+			CWData data;
+			msg.getMessage(data);
+
+			CRData rdata(data.getDataPtr(), data.getDataSize());
+			msg_tree parsed(rdata, readType(rdata));
+			sum+=parsed.getK()+(unsigned int)parsed.getRelayNodes().size();
+		}
+		count+=1000;
+	}
+	printTime(std::string("msg_tree v")+(char)('0'+version), count, os_gettimems()-start);
+	return sum;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t bsize=1316;
+	unsigned int nhops=4;
+	unsigned int duration=1000;
+	if(argc>1)
+		bsize=(size_t)atoi(argv[1]);
+	if(argc>2)
+		nhops=(unsigned int)atoi(argv[2]);
+	if(argc>3)
+		duration=(unsigned int)atoi(argv[3]);
+	if(bsize+128>cwdata_stack_size || nhops<2 || nhops>16)
+	{
+		std::cout << "payload size has to be below " << cwdata_stack_size-128 << " and hops between 2 and 16" << std::endl;
+		return 1;
+	}
+
+	std::vector<char> buf(bsize);
+	for(size_t i=0;i<bsize;++i)
+	{
+		buf[i]=(char)rand();
+	}
+	std::vector<std::pair<unsigned int, unsigned short> > hops;
+	std::vector<SRelayNode> nodes;
+	for(unsigned int i=0;i<nhops;++i)
+	{
+		hops.push_back(std::pair<unsigned int, unsigned short>(0x0100007f+(i<<24), (unsigned short)(17000+i)));
+		SRelayNode node;
+		node.ip=hops[i].first;
+		node.port=hops[i].second;
+		node.version=wire_version_2;
+		nodes.push_back(node);
+	}
+	std::cout << "payload size " << bsize << ", " << nhops << " hops and children" << std::endl;
+
+	unsigned int sum=0;
+	for(unsigned char version=wire_version_1;version<=wire_version_2;++version)
+	{
+		sum+=benchSpread(version, &buf[0], bsize, duration);
+		sum+=benchData(version, hops, &buf[0], bsize, duration);
+		sum+=benchAck(version, duration);
+		sum+=benchTree(version, nodes, duration);
+	}
+	return sum==0?1:0;
+}
@@ -1,249 +1,332 @@
-/**
-* Controller. Does the exploration, handles Congestion Control
-* and uses the trees constucted by the Tracker to distribute data.
-**/
-
-#ifndef CONTROLLER_H
-#define CONTROLLER_H
-
-#include "../common/types.h"
-#include <map>
-
-struct SRtt;
-
-/**
-* Data structure to give information about peers to the tracker thread
-**/
-struct SBest
-{
-	bool operator<(const SBest &other) const
-	{
-		return free_msgs<other.free_msgs;
-	}
-	unsigned int free_msgs;
-	unsigned int used_msgs;
-	float free_msgs_var;
-	unsigned int peer_id;
-	unsigned int ip;
-	unsigned short port;
-	unsigned int id;
-	std::map<unsigned int, SRtt> latencies;
-	float server_rtt;
-	SOCKET s;
-};
-
-#include "input.h"
-#include "tracker.h"
-#include <boost/thread/mutex.hpp>
-#include <list>
-#include <queue>
-#include "../common/socket_functions.h"
-
-class Tracker;
-
-/**
-*  Data structure to save information about peers
-**/
-struct SRtt
-{
-	float mean;
-	float var;
-};
-
-/**
-* Data structure to save reinforcement learning rewards
-**/
-struct SActionReward
-{
-	SActionReward(){ value=0; action=0; }
-	SActionReward(int pAction, double pValue){ action=pAction; value=pValue; }
-	double value;
-	int action;
-	std::vector<SActionReward> rewards;
-};
-
-/**
-* Data structure to save the q-valus
-**/
-struct SQValues
-{
-	SQValues(){up=0; stay=0; down=0;}
-	SQValues(double pUp, double pDown, double pStay) : up(pUp), down(pDown), stay(pStay) {}
-	double up;
-	double down;
-	double stay;
-	std::vector<SActionReward> rewards;
-};
-
-/**
-* Data structure to save information about a buffer from the input thread
-**/
-struct SBufferInfo
-{
-	SBufferInfo(){ sendc=0; ackc=0; lastsenttime=0; }
-	size_t bid;
-	size_t sendc;
-	unsigned int lastsenttime;
-	size_t ackc;
-};
-
-/**
-* Data structure to save informations about a peer
-**/
-struct SPeer
-{
-	bool operator<(const SPeer &other)
-	{
-		return curr_state<other.curr_state;
-	}
-	unsigned int ip;
-	unsigned short port;
-	unsigned int id;
-	std::map<unsigned int, SRtt> latencies;
-	unsigned int c_wnd;
-	int curr_state;
-	std::vector<SQValues> qtable;
-	int last_action;
-	int last_cong_state;
-	int sthresh;
-	//std::map<size_t, SBufferInfo*> binfo;
-	SOCKET s;
-	unsigned int ack_packets;
-	float server_rtt;
-};
-
-/**
-* Data structure to save information about which states peers are in when the packet is send
-**/
-struct SQSubuserdata
-{
-	int state;
-	int action;
-};
-
-/**
-* Data structure to save information about individual peer states and the message size
-**/
-struct SQUserdata
-{
-	std::vector<SQSubuserdata> data;
-	int msgsize;
-};
-
-/**
-* Data structure to save information about a sent message
-**/
-struct SMessage
-{
-	SMessage(unsigned int pID, const std::vector<unsigned int> &pRoute, unsigned int pSenttime) : id(pID), route(pRoute), senttime(pSenttime) { acked=false;}
-	bool operator<(const SMessage &other)
-	{
-		return timeouttime>other.timeouttime;
-	}
-
-	bool acked;
-	unsigned int id;
-	std::vector<unsigned int> route;
-	unsigned int senttime;
-	unsigned int timeouttime;
-	SQUserdata qdata;
-};
-
-/**
-* The Controller Thread
-**/
-class Controller
-{
-public:
-	/**
-	* Setup Controller giving the other threads so it can interact with them.
-	* Set the bandwidth the controller should maximally use.
-	**/
-	Controller(Input *pInput, Tracker *pTracker, unsigned int bandwidth);
-
-	/**
-	* Add a new peer to the controller using IP, port, the peer socket and the initial bandwidth the peer published
-	**/
-	void addNewPeer(unsigned int ip, unsigned short port, SOCKET s, unsigned int bw);
-	/**
-	* Remove a peer spcified by its ip and port
-	**/
-	void removePeer(unsigned int ip, unsigned short port);
-
-	/**
-	* Get information about all peers
-	**/
-	std::vector<SBest> getBestNodes(void);
-
-	/**
-	* Main thread function
-	**/
-	void operator()(void);
-private:
-	
-	//update the data structure about the best nodes
-	void updateBestNodes(void);
-	//construct a random sequence of length len and numbers smaller than len; bigger than zero and unique.
-	//E.g. random_sequence(4) gives 1,2,0,3.
-	std::vector<size_t> random_sequence(size_t len);
-	//Returns if the buffer with it bid is spread to all clients by the current tree structure
-	bool isSpread(size_t bid);
-	//Reinforce a q-value in Peer pi with specific state and action with ret
-	void reinforceQValue(SPeer *pi, int state, int action, double ret);
-	//Update the congestion controll with an received ack
-	void addAckPacket(SPeer *pi);
-	//update the q-value: The state the congestion controller is in is updated.
-	void updateQValue(SPeer *pi);
-
-	//Returns the esimated latency from client with id 'from' to client with id 'to'
-	float getLatency(unsigned int from, unsigned int to);
-
-	//Handle the timeout of message msg
-	void handleTimeout(SMessage* msg);
-	//Handle an acknowledgement of message msg
-	void handleAck(SMessage* msg);
-	//update the RTT using message msg (for which an ACK was received) and the delay from last client to server
-	void updateRtts(float server_rtt, SMessage *msg);
-	//update the latency from 'from' to 'to' with newrtt
-	void updateSingleLatency(unsigned int from, unsigned int to, float newrtt);
-
-	//Data structures to save information about the peers(clients)
-	std::map<unsigned int, SPeer> peers;
-	//Connect ip and port with the peer(client) ids
-	std::map<std::pair<unsigned int, unsigned short>, unsigned int> peers_ids;
-	//Data structure to save information about Buffers
-	std::map<size_t, std::vector<SBufferInfo*> > buffer_info;
-
-	//Saved userdata of messages
-	std::map<size_t, SQUserdata*> userdata;
-	size_t npeers;
-	//Next assignable peer(client) id
-	unsigned int peer_id;
-
-	//Bandwidth used for exploration
-	unsigned int bandwidth_exploration;
-	//Bandwidth used for exploitation
-	unsigned int bandwidth_exploitation;
-
-	//Pointers to other threads
-	Input *input;
-	Tracker *tracker;
-
-	//Mutex to synchronize access to the best_* data structures
-	boost::mutex mutex;
-	//Information about peers for the tracker thread
-	std::vector<SBest> best_nodes;
-	std::vector<SBest> l_best_nodes;
-
-	//List of messages of which timeout can still occurr
-	std::list<SMessage*> msgs_timeouts;
-	//Messages in garbage waiting to be deleted
-	std::queue<SMessage*> msgs_garbage;
-	//Mapps client and message id to Message
-	std::map<unsigned int, std::map<unsigned int, SMessage*> > sent_msgs;
-
-	//UDP server socket
-	SOCKET csock;
-};
-
+/**
+* Controller. Does the exploration, handles Congestion Control
+* and uses the trees constucted by the Tracker to distribute data.
+**/
+
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+#include "../common/types.h"
+#include <map>
+
+struct SRtt;
+struct SAck;
+struct SRelayReport;
+class SenderPool;
+
+/**
+* Data structure to give information about peers to the tracker thread
+**/
+struct SBest
+{
+	bool operator<(const SBest &other) const
+	{
+		return free_msgs<other.free_msgs;
+	}
+	unsigned int free_msgs;
+	unsigned int used_msgs;
+	float free_msgs_var;
+	unsigned int peer_id;
+	unsigned int ip;
+	unsigned short port;
+	unsigned int id;
+	std::map<unsigned int, SRtt> latencies;
+	float server_rtt;
+	SOCKET s;
+	//Version of the wire format the client understands
+	unsigned char wire_version;
+	//CPU load in percent and relay queue depth the client reported
+	unsigned short cpu_load;
+	unsigned int queue_depth;
+	//Set if the client is too loaded to relay. It is then only used as a leaf in the trees
+	bool overloaded;
+};
+
+/**
+* Structure to save information about a retransmission request (nack)
+**/
+struct SResend
+{
+	unsigned int msgid;
+	unsigned int ip;
+	unsigned short port;
+	unsigned int nacktime;
+};
+
+#include "input.h"
+#include "tracker.h"
+#include <boost/thread/mutex.hpp>
+#include <list>
+#include <queue>
+#include <deque>
+#include "../common/socket_functions.h"
+#include "../common/fec.h"
+
+class Tracker;
+class ControllerShard;
+
+//Delay between timesteps. Server will send (1000/bandwidth_timestep) packets per second
+const unsigned int bandwidth_timestep=100;
+//Inital latency between peers in seconds
+const float default_latency=0.5f;
+
+/**
+*  Data structure to save information about peers
+**/
+struct SRtt
+{
+	float mean;
+	float var;
+};
+
+/**
+* Data structure to save reinforcement learning rewards
+**/
+struct SActionReward
+{
+	SActionReward(){ value=0; action=0; }
+	SActionReward(int pAction, double pValue){ action=pAction; value=pValue; }
+	double value;
+	int action;
+	std::vector<SActionReward> rewards;
+};
+
+/**
+* Data structure to save the q-valus
+**/
+struct SQValues
+{
+	SQValues(){up=0; stay=0; down=0;}
+	SQValues(double pUp, double pDown, double pStay) : up(pUp), down(pDown), stay(pStay) {}
+	double up;
+	double down;
+	double stay;
+	std::vector<SActionReward> rewards;
+};
+
+/**
+* Data structure to save information about a buffer from the input thread
+**/
+struct SBufferInfo
+{
+	SBufferInfo(){ sendc=0; ackc=0; lastsenttime=0; }
+	size_t bid;
+	size_t sendc;
+	unsigned int lastsenttime;
+	size_t ackc;
+};
+
+/**
+* Messages a peer forwards in the current timestep and how many it may forward. Shared by
+* the controller and the shard running the congestion control of the peer
+**/
+struct SPeerLoad
+{
+	SPeerLoad(){ tree_wnd=0; explore_wnd=0; rate=0; }
+	//Messages for the trees. Written by the controller
+	volatile unsigned int tree_wnd;
+	//Messages for exploration. Written by the shard
+	volatile unsigned int explore_wnd;
+	//Messages per timestep the congestion control allows. Written by the shard
+	volatile unsigned int rate;
+};
+
+/**
+* Data structure to save what the controller needs for sending to a peer
+**/
+struct SSendPeer
+{
+	unsigned int ip;
+	unsigned short port;
+	SPeerLoad *load;
+	//Retransmissions sent to this peer in the current timestep
+	unsigned int resend_wnd;
+	//Version of the wire format the peer understands
+	unsigned char wire_version;
+};
+
+/**
+* Data structure to save informations about a peer
+**/
+struct SPeer
+{
+	bool operator<(const SPeer &other)
+	{
+		return curr_state<other.curr_state;
+	}
+	unsigned int ip;
+	unsigned short port;
+	unsigned int id;
+	std::map<unsigned int, SRtt> latencies;
+	SPeerLoad *load;
+	int curr_state;
+	std::vector<SQValues> qtable;
+	int last_action;
+	int last_cong_state;
+	int sthresh;
+	//std::map<size_t, SBufferInfo*> binfo;
+	SOCKET s;
+	unsigned int ack_packets;
+	float server_rtt;
+	//Version of the wire format the peer understands
+	unsigned char wire_version;
+	//Peer index the tracker assigned. 'no_peer_index' if the peer can't be addressed by it
+	unsigned short peer_index;
+	//Time the peer was added
+	unsigned int added;
+};
+
+/**
+* Data structure to save information about which states peers are in when the packet is send
+**/
+struct SQSubuserdata
+{
+	int state;
+	int action;
+};
+
+/**
+* Data structure to save information about individual peer states and the message size
+**/
+struct SQUserdata
+{
+	std::vector<SQSubuserdata> data;
+	int msgsize;
+};
+
+/**
+* Data structure to save information about a sent message
+**/
+struct SMessage
+{
+	SMessage(unsigned int pID, const std::vector<unsigned int> &pRoute, unsigned int pSenttime) : id(pID), route(pRoute), senttime(pSenttime) { acked=false;}
+	bool operator<(const SMessage &other)
+	{
+		return timeouttime>other.timeouttime;
+	}
+
+	bool acked;
+	unsigned int id;
+	std::vector<unsigned int> route;
+	unsigned int senttime;
+	unsigned int timeouttime;
+	SQUserdata qdata;
+};
+
+/**
+* The Controller Thread
+**/
+class Controller
+{
+public:
+	/**
+	* Setup Controller of channel 'pChannel' giving the other threads so it can interact with them.
+	* Sends with the sockets of 'pSenders'. Set the bandwidth the controller should maximally use and
+	* the number of buffers protected by one parity buffer (0 disables forward error correction).
+	* Exploration and congestion control run in 'pShards' threads, each for a part of the peers
+	**/
+	Controller(unsigned short pChannel, Input *pInput, Tracker *pTracker, SenderPool *pSenders, unsigned int bandwidth, unsigned int pFec_group_size, unsigned int pShards);
+
+	/**
+	* Set the part of the server bandwidth this channel may use. Takes effect in the next timestep
+	**/
+	void setBandwidthShare(float share);
+
+	/**
+	* Get the channel of this controller
+	**/
+	unsigned short getChannel(void);
+
+	/**
+	* Add a new peer to the controller using IP, port, the peer socket, the initial bandwidth the peer published,
+	* the version of the wire format it understands and the peer index the tracker assigned it
+	**/
+	void addNewPeer(unsigned int ip, unsigned short port, SOCKET s, unsigned int bw, unsigned char wire_version, unsigned short peer_index);
+	/**
+	* Remove a peer spcified by its ip and port
+	**/
+	void removePeer(unsigned int ip, unsigned short port);
+
+	/**
+	* Get information about all peers
+	**/
+	std::vector<SBest> getBestNodes(void);
+
+	/**
+	* Main thread function. Starts the threads of the shards and sends the buffers through the trees
+	**/
+	void operator()(void);
+private:
+
+	//Set the bandwidth used for exploration and exploitation
+	void setBandwidth(unsigned int bandwidth);
+	//Returns if the buffer with it bid is spread to all clients by the current tree structure
+	bool isSpread(size_t bid);
+	//Pass the new acknowledgements 'acks' to the shards owning the peers which sent them
+	void dispatchAcks(const std::vector<SAck> &acks);
+	//Pass the relay reports 'reports' to the shards owning the peers which sent them
+	void dispatchRelayReports(const std::vector<SRelayReport> &reports);
+
+	//Queue the retransmission requests 'nr'. Drops requests for unknown peers and duplicate nacks
+	void addResends(const std::vector<SResend> &nr);
+	//Retransmit queued buffers as long as the retransmission and exploitation budgets allow it
+	void sendResends(unsigned int &b_exploit, unsigned int &b_resend);
+
+	//Add a buffer sent through the trees to the current parity group. Sends the parity if the group is complete
+	void addFecBuffer(SBuffer *buf, unsigned int &b_exploit);
+	//Send the parity of the current group to the direct children of the server in the tree it belongs to
+	void sendFec(unsigned int &b_exploit);
+
+	//Data structures to save information about the peers(clients)
+	std::map<unsigned int, SSendPeer> peers;
+	//Connect ip and port with the peer(client) ids
+	std::map<std::pair<unsigned int, unsigned short>, unsigned int> peers_ids;
+	//Data structure to save information about Buffers
+	std::map<size_t, std::vector<SBufferInfo*> > buffer_info;
+
+	//Shards doing the exploration and congestion control. A peer belongs to shard 'id % shards.size()'
+	std::vector<ControllerShard*> shards;
+
+	//Saved userdata of messages
+	std::map<size_t, SQUserdata*> userdata;
+	size_t npeers;
+
+	//Channel this controller streams
+	unsigned short channel;
+
+	//Bandwidth of the server
+	unsigned int bandwidth_total;
+	//Part of 'bandwidth_total' this channel uses
+	float bandwidth_share;
+	//New part set by the tracker thread
+	float new_bandwidth_share;
+
+	//Bandwidth used for exploration
+	unsigned int bandwidth_exploration;
+	//Bandwidth used for exploitation
+	unsigned int bandwidth_exploitation;
+	//Part of the exploitation bandwidth that can be used for retransmissions
+	unsigned int bandwidth_resend;
+
+	//Pointers to other threads
+	Input *input;
+	Tracker *tracker;
+
+	//Mutex to synchronize access to 'new_bandwidth_share'
+	boost::mutex mutex;
+
+	//Queued retransmission requests
+	std::deque<SResend> new_resends;
+	//Maps peer and message id to the time the last retransmission was queued
+	std::map<std::pair<unsigned int, unsigned int>, unsigned int> resend_times;
+
+	//Number of buffers protected by one parity buffer. Zero if disabled
+	unsigned int fec_group_size;
+	//Parity of the current group
+	CFecGroup fec_group;
+
+	//Sockets of the server. Shared by all channels
+	SenderPool *senders;
+};
+
 #endif //CONTROLLER_H
\ No newline at end of file
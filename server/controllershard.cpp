@@ -0,0 +1,899 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "controllershard.h"
+#include "sender.h"
+#include "../common/log.h"
+#include "../common/os_functions.h"
+#include "../common/msg_data.h"
+#include "../common/stringtools.h"
+#include "../common/os_atomic.h"
+#include <algorithm>
+
+//Number of desired hops of exploration packets
+const size_t c_hops=3;
+//Reinforcement learning parameters
+const float reinf_up=0.1f;
+const float reinf_down=-1.0f;
+const float alpha=0.1f;
+const float lambda=1.0f;
+const float epsilon=0.1f;
+//Maximal size of the q-table
+const size_t qtablesize=8738;
+//RTT estimation parameter
+const float rttalpha=0.15f;
+//Buffers older than this (in ms) aren't used for exploration
+const unsigned int explore_max_age=1000;
+//Peers are addressed by their peer index once the tracker announced it this long ago (in ms),
+//so the other peers of the route know it
+const unsigned int peer_index_delay=2000;
+
+/**
+* Setup the shard for channel 'pChannel'. Sends with the sockets of 'pSenders'
+**/
+ControllerShard::ControllerShard(unsigned short pChannel, SenderPool *pSenders)
+	: channel(pChannel), senders(pSenders)
+{
+	bandwidth_exploration=0;
+}
+
+/**
+* Add the peer 'peer' to the shard. Its load is shared with the controller. Called by the controller thread
+**/
+void ControllerShard::addPeer(const SPeer &peer)
+{
+	SPeerUpdate update;
+	update.peer=peer;
+	update.remove=false;
+	peer_updates.push(update);
+}
+
+/**
+* Remove the peer with id 'peer_id'. Called by the controller thread
+**/
+void ControllerShard::removePeer(unsigned int peer_id)
+{
+	SPeerUpdate update;
+	update.peer.id=peer_id;
+	update.peer.load=NULL;
+	update.remove=true;
+	peer_updates.push(update);
+}
+
+/**
+* Explore with the new buffer 'buf'. Called by the controller thread
+**/
+void ControllerShard::addBuffer(SBuffer *buf)
+{
+	new_buffers.push(buf);
+}
+
+/**
+* Handle the acknowledgement 'ack'. Called by the controller thread
+**/
+void ControllerShard::addAck(const SPeerAck &ack)
+{
+	new_acks.push(ack);
+}
+
+/**
+* Handle the relay report 'relay'. Called by the controller thread
+**/
+void ControllerShard::addRelayReport(const SPeerRelay &relay)
+{
+	new_relay_reports.push(relay);
+}
+
+/**
+* Set the bandwidth used for exploration per timestep
+**/
+void ControllerShard::setExplorationBandwidth(unsigned int bandwidth)
+{
+	os_atomic_store(&bandwidth_exploration, bandwidth);
+}
+
+/**
+* Main thread function
+**/
+void ControllerShard::operator()(void)
+{
+	unsigned int b_explore=0;
+	//next time the rates will be reset
+	unsigned int b_next_reset=os_gettimems()+bandwidth_timestep;
+
+	while(true)
+	{
+		updatePeers();
+
+		explore(b_explore);
+
+		handleAcks();
+
+		handleRelayReports();
+
+		//Sleep until next timeslice
+		if(os_gettimems()<b_next_reset)
+		{
+			os_sleep((std::min)((unsigned int)bandwidth_timestep,b_next_reset-os_gettimems()));
+		}
+		//Reset the client rates
+		for(std::map<unsigned int, SPeer>::iterator it=peers.begin();it!=peers.end();++it)
+		{
+			it->second.load->explore_wnd=0;
+		}
+		b_explore=0;
+		b_next_reset=os_gettimems()+bandwidth_timestep;
+	}
+}
+
+/**
+* Apply the peers added and removed by the controller
+**/
+void ControllerShard::updatePeers(void)
+{
+	//The controller adds a peer before it removes it. One queue keeps that order, even if
+	//both happen between two timeslices
+	SPeerUpdate update;
+	while(peer_updates.pop(update))
+	{
+		if(!update.remove)
+		{
+			SPeer &np=update.peer;
+			np.qtable.resize(qtablesize);
+			peers.insert(std::pair<unsigned int, SPeer>(np.id, np) );
+			continue;
+		}
+
+		unsigned int peer_id=update.peer.id;
+		//remove peer info
+		std::map<unsigned int, SPeer>::iterator it=peers.find(peer_id);
+		if(it!=peers.end())
+		{
+			delete it->second.load;
+			peers.erase(it);
+		}
+		//remove data
+		for(size_t k=0;k<best_nodes.size();++k)
+		{
+			if(best_nodes[k].id==peer_id)
+			{
+				best_nodes.erase(best_nodes.begin()+k);
+				break;
+			}
+		}
+	}
+}
+
+/**
+* Explore with the new buffers as long as the exploration bandwidth allows it
+**/
+void ControllerShard::explore(unsigned int &b_explore)
+{
+	unsigned int explore_time=os_gettimems();
+	unsigned int bandwidth=os_atomic_load(&bandwidth_exploration);
+
+	//Collect all peer ids
+	std::vector<unsigned int> peers_seq;
+	for(std::map<unsigned int, SPeer>::iterator it=peers.begin();it!=peers.end();++it)
+	{
+		peers_seq.push_back(it->first);
+	}
+
+	SBuffer *buf;
+	while(b_explore<bandwidth && new_buffers.pop(buf))
+	{
+		//The controller doesn't send buffers this old anymore
+		if(os_gettimems()-buf->created>explore_max_age)
+			continue;
+
+		//Get a random sequence
+		std::vector<size_t> rnd_seq=random_sequence(peers_seq.size());
+
+		std::vector<std::pair<unsigned int, unsigned short> > msgpeers;
+		std::vector<unsigned short> msgindices;
+		std::vector<unsigned int> route;
+		std::vector<SPeer*> route_peers;
+		float latency=default_latency;
+		SQUserdata qdata;
+		qdata.msgsize=buf->datasize;
+		for(size_t i=0;i<rnd_seq.size();++i)
+		{
+			//Get a random peer
+			SPeer &cpeer=peers[peers_seq[rnd_seq[i]] ];
+			if(getWindow(&cpeer)>=(unsigned int)cpeer.curr_state+1)
+			{
+				continue;
+			}
+			else
+			{
+				//Add the peer and set the userdata
+				msgpeers.push_back(std::pair<unsigned int, unsigned short>(cpeer.ip, cpeer.port) );
+				msgindices.push_back(cpeer.peer_index);
+				route.push_back(cpeer.id);
+				route_peers.push_back(&peers[peers_seq[rnd_seq[i]] ]);
+				{
+					SQSubuserdata sqd;
+					sqd.action=cpeer.last_action;
+					sqd.state=cpeer.curr_state;
+					qdata.data.push_back(sqd);
+				}
+				{
+					unsigned int source=0;
+					if(route.size()>1)
+						source=route[route.size()-2];
+					latency+=getLatency(source, cpeer.id);
+				}
+				//If we have collected enough clients or if we are at the end of the random sequence send the message
+				if(msgpeers.size()>c_hops || (i+1>=rnd_seq.size() && !msgpeers.empty() ) )
+				{
+					//Each hop relays the message in the version it received, so all have to understand it.
+					//The compact message needs the peer indices of all hops
+					unsigned char wire_version=wire_version_2;
+					bool compact=true;
+					for(size_t k=0;k<route_peers.size();++k)
+					{
+						wire_version=(std::min)(wire_version, route_peers[k]->wire_version);
+						if(route_peers[k]->peer_index==no_peer_index || explore_time-route_peers[k]->added<peer_index_delay)
+						{
+							compact=false;
+						}
+					}
+					char dbuf[cwdata_stack_size];
+					CWData data(dbuf, sizeof(dbuf));
+					if(compact)
+					{
+						msg_data msg(channel, buf->id, msgindices, buf->data, buf->datasize);
+						msg.incrementHop();
+						msg.getHeader(data);
+					}
+					else
+					{
+						msg_data msg(channel, buf->id, msgpeers, buf->data, buf->datasize, wire_version);
+						msg.incrementHop();
+						msg.getHeader(data);
+					}
+					senders->sendv(msgpeers[0].first, msgpeers[0].second, data.getDataPtr(), data.getDataSize(), buf->data, buf->datasize);
+					//Save the message for timeout checking
+					{
+						SMessage *sm=new SMessage(buf->id, route, os_gettimems());
+						sm->timeouttime=sm->senttime+(unsigned int)(latency*1000.f+0.5f);
+						sm->qdata=qdata;
+						sent_msgs[buf->id][cpeer.id]=sm;
+						msgs_timeouts.push_back(sm);
+					}
+					//Increase the sent messages for every client on the route
+					if(route_peers.size()>1)
+					{
+						for(size_t k=0;k<route_peers.size()-1;++k)
+						{
+							++route_peers[k]->load->explore_wnd;
+						}
+					}
+					else
+					{
+						++route_peers[0]->load->explore_wnd;
+					}
+					//Add exploration bandwidth
+					b_explore+=data.getDataSize()+buf->datasize;
+#if LL_DEBUG<=LOGLEVEL
+					std::string dbg="Sending packet route=(";
+					for(size_t k=0;k<route_peers.size();++k)
+					{
+						dbg+=nconvert(route_peers[k]->id);
+						if(k+1<route_peers.size())
+							dbg+=", ";
+					}
+					dbg+=") ID="+nconvert(curr_msg_id-1);
+					LOG(dbg, LL_DEBUG);
+#endif
+					qdata.data.clear();
+					msgpeers.clear();
+					msgindices.clear();
+					route_peers.clear();
+					route.clear();
+					latency=default_latency;
+					if( b_explore>=bandwidth )
+					{
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	LOG("Exploretime: "+nconvert(os_gettimems()-explore_time), LL_DEBUG);
+}
+
+/**
+* Handle the new acknowledgements and the timeouts
+**/
+void ControllerShard::handleAcks(void)
+{
+	unsigned int ack_time=os_gettimems();
+
+	std::vector<SPeerAck> acks;
+	SPeerAck ack;
+	while(new_acks.pop(ack))
+	{
+		acks.push_back(ack);
+	}
+	if(acks.empty())
+		return;
+
+	for(size_t i=0;i<acks.size();++i)
+	{
+		//Get the message by using the source and client id
+		std::map<unsigned int, std::map<unsigned int, SMessage*> >::iterator it1=sent_msgs.find(acks[i].msgid);
+		if(it1!=sent_msgs.end())
+		{
+			std::map<unsigned int, SMessage*>::iterator it2=it1->second.find(acks[i].peer_id);
+			if(it2!=it1->second.end())
+			{
+				//Update the rtts of the clients on the path
+				updateRtts(acks[i].rtt, it2->second);
+				if(!it2->second->acked)
+				{
+					//Handle the ack
+					handleAck(it2->second);
+				}
+				else
+				{
+					LOG("delayed ack "+nconvert(it2->second->id), LL_INFO);
+				}
+				it2->second->acked=true;
+			}
+		}
+	}
+
+	//Sort the timeouts so that the oldest is the first one
+	msgs_timeouts.sort();
+	unsigned int c_time=os_gettimems();
+	//While the oldest message is timed out...
+	while(!msgs_timeouts.empty() && msgs_timeouts.front()->timeouttime<c_time)
+	{
+		//If it is acked delete it
+		if(msgs_timeouts.front()->acked )
+		{
+			std::map<unsigned int, std::map<unsigned int, SMessage*> >::iterator it1=sent_msgs.find(msgs_timeouts.front()->id);
+			if(it1!=sent_msgs.end() && !msgs_timeouts.front()->route.empty())
+			{
+				std::map<unsigned int, SMessage*>::iterator it2=it1->second.find(msgs_timeouts.front()->route[msgs_timeouts.front()->route.size()-1]);
+				if(it2!=it1->second.end())
+				{
+					it1->second.erase(it2);
+				}
+				if(it1->second.empty())
+				{
+					sent_msgs.erase(it1);
+				}
+			}
+			delete msgs_timeouts.front();
+			msgs_timeouts.erase(msgs_timeouts.begin());
+		}
+		else
+		{
+			//Call timeout function and add the message to the garbage. It get's deleted in 10s
+			LOG("ACK timeout for ID="+nconvert(msgs_timeouts.front()->id), LL_INFO);
+			handleTimeout(msgs_timeouts.front());
+			std::map<unsigned int, std::map<unsigned int, SMessage*> >::iterator it1=sent_msgs.find(msgs_timeouts.front()->id);
+			if(it1!=sent_msgs.end() && !msgs_timeouts.front()->route.empty())
+			{
+				std::map<unsigned int, SMessage*>::iterator it2=it1->second.find(msgs_timeouts.front()->route[msgs_timeouts.front()->route.size()-1]);
+				if(it2!=it1->second.end())
+				{
+					it2->second->acked=true;
+				}
+			}
+			msgs_garbage.push(msgs_timeouts.front());
+			msgs_timeouts.erase(msgs_timeouts.begin());
+		}
+	}
+
+	//Delete messages in garbage that are older than 10s
+	while(!msgs_garbage.empty() && os_gettimems()-msgs_garbage.front()->timeouttime>10000)
+	{
+		std::map<unsigned int, std::map<unsigned int, SMessage*> >::iterator it1=sent_msgs.find(msgs_garbage.front()->id);
+		if(it1!=sent_msgs.end() && !msgs_garbage.front()->route.empty())
+		{
+			std::map<unsigned int, SMessage*>::iterator it2=it1->second.find(msgs_garbage.front()->route[msgs_garbage.front()->route.size()-1]);
+			if(it2!=it1->second.end())
+			{
+				it1->second.erase(it2);
+			}
+			if(it1->second.empty())
+			{
+				sent_msgs.erase(it1);
+			}
+		}
+		delete msgs_garbage.front();
+		msgs_garbage.pop();
+	}
+
+	//Update the best_node structure
+	{
+		updateBestNodes();
+	}
+
+	//Publish the new rates to the controller
+	for(std::map<unsigned int, SPeer>::iterator it=peers.begin();it!=peers.end();++it)
+	{
+		os_atomic_store(&it->second.load->rate, (unsigned int)it->second.curr_state);
+	}
+
+	LOG("Acktime: "+nconvert(os_gettimems()-ack_time), LL_DEBUG);
+}
+
+/**
+* Messages the peer forwards in the current timestep
+**/
+unsigned int ControllerShard::getWindow(SPeer *pi)
+{
+	return os_atomic_load(&pi->load->tree_wnd)+pi->load->explore_wnd;
+}
+
+/**
+* construct a random sequence of length len and numbers smaller than len; bigger than zero and unique.
+* E.g. random_sequence(4) gives 1,2,0,3.
+**/
+std::vector<size_t> ControllerShard::random_sequence(size_t len)
+{
+	std::vector<size_t> ret;
+	//add all members
+	ret.resize(len);
+	for(size_t i=0;i<len;++i)
+	{
+		ret[i]=i;
+	}
+
+	//shuffle it a bit
+	for(size_t i=0;i<len;++i)
+	{
+		size_t f1=rand()%len;
+		size_t f2=rand()%len;
+		size_t t=ret[f1];
+		ret[f1]=ret[f2];
+		ret[f2]=t;
+	}
+
+	return ret;
+}
+
+/**
+* update the RTT using message msg (for which an ACK was received) and the delay from last client to server
+*/
+void ControllerShard::updateRtts(float server_rtt, SMessage *msg)
+{
+	//Estimate latency by substracting the latency from last node to server and dividing by the hopcount
+	float est=(((float)(os_gettimems()-msg->senttime)/1000.f)-server_rtt/2.f)/(float)msg->route.size();
+	if(est>0)
+	{
+		//Update the latency in both directions
+		for(size_t i=0;i+1<msg->route.size();++i)
+		{
+			updateSingleLatency(msg->route[i], msg->route[i+1], est);
+			updateSingleLatency(msg->route[i+1], msg->route[i], est);
+		}
+		//Update the server_rtt
+		if(!msg->route.empty())
+		{
+			std::map<unsigned int, SPeer>::iterator it=peers.find(msg->route[msg->route.size()-1]);
+			if(it!=peers.end())
+			{
+				it->second.server_rtt=server_rtt;
+			}
+		}
+	}
+	else
+	{
+		LOG("RTT estimate negativ", LL_DEBUG);
+	}
+}
+
+/**
+* update the latency from 'from' to 'to' with newrtt
+**/
+void ControllerShard::updateSingleLatency(unsigned int from, unsigned int to, float newrtt)
+{
+	std::map<unsigned int, SPeer>::iterator it1=peers.find(from);
+	if(it1!=peers.end())
+	{
+		std::map<unsigned int, SRtt>::iterator it2=it1->second.latencies.find(to);
+		if(it2!=it1->second.latencies.end())
+		{
+			//Update the mean and variance
+			float err=newrtt-it2->second.mean;
+			it2->second.mean+=rttalpha*err;
+			if(err<0)err*=-1;
+			it2->second.var+=rttalpha*(err-it2->second.var);
+		}
+		else
+		{
+			//Set the mean and variance because it was never updated before
+			SRtt rtt;
+			rtt.mean=newrtt;
+			rtt.var=newrtt;
+			it1->second.latencies.insert(std::pair<unsigned int, SRtt>(to, rtt) );
+		}
+	}
+}
+
+/**
+* update the data structure about the best nodes
+**/
+void ControllerShard::updateBestNodes(void)
+{
+	for(std::map<unsigned int, SPeer>::iterator it=peers.begin();it!=peers.end();++it)
+	{
+		SBest *cbest=NULL;
+		//Get the entry in the best node structure
+		for(size_t i=0;i<best_nodes.size();++i)
+		{
+			if(best_nodes[i].peer_id==it->first)
+			{
+				cbest=&best_nodes[i];
+				break;
+			}
+		}
+		
+		unsigned int bfree=(unsigned int)it->second.curr_state;
+		if(cbest==NULL)
+		{
+			//Add new entry
+			SBest nb;
+			nb.peer_id=it->first;
+			nb.used_msgs=0;
+			nb.free_msgs=bfree;
+			nb.free_msgs_var=0;
+			nb.ip=it->second.ip;
+			nb.port=it->second.port;
+			nb.s=it->second.s;
+			nb.id=it->second.id;
+			nb.latencies=it->second.latencies;
+			nb.server_rtt=it->second.server_rtt;
+			nb.wire_version=it->second.wire_version;
+			nb.cpu_load=0;
+			nb.queue_depth=0;
+			nb.overloaded=false;
+			best_nodes.push_back(nb);
+		}
+		else
+		{
+			//Update entries
+			cbest->free_msgs=bfree;
+			cbest->latencies=it->second.latencies;
+			cbest->server_rtt=it->second.server_rtt;
+		}
+	}
+	//Sort so the best node is in front
+	std::sort(best_nodes.begin(), best_nodes.end());
+	//Update the public structure
+	boost::mutex::scoped_lock lock(mutex);
+	l_best_nodes=best_nodes;
+}
+
+/**
+* Get information about the peers of this shard
+**/
+std::vector<SBest> ControllerShard::getBestNodes(void)
+{
+	boost::mutex::scoped_lock lock(mutex);
+	return l_best_nodes;
+}
+
+/**
+* Returns the esimated latency from client with id 'from' to client with id 'to'
+**/
+float ControllerShard::getLatency(unsigned int from, unsigned int to)
+{
+	std::map<unsigned int, SPeer>::iterator it1=peers.find(from);
+	if(it1!=peers.end())
+	{
+		std::map<unsigned int, SRtt>::iterator it2=it1->second.latencies.find(to);
+		if(it2!=it1->second.latencies.end())
+		{
+			return it2->second.mean+4*it2->second.var;
+		}
+	}
+	return default_latency;
+}
+
+/**
+* Lower the rate of peers which dropped messages. The peer had less bandwidth than its rate,
+* so this is handled like a packet loss at its current rate
+**/
+void ControllerShard::handleRelayReports(void)
+{
+	SPeerRelay relay;
+	while(new_relay_reports.pop(relay))
+	{
+		std::map<unsigned int, SPeer>::iterator it=peers.find(relay.peer_id);
+		if(it==peers.end() || relay.dropped==0)
+			continue;
+
+		SPeer &peer=it->second;
+		if(peer.last_cong_state==-1)
+		{
+			//Leave faststart like after a packet loss
+			peer.last_cong_state=peer.curr_state;
+			peer.curr_state/=2;
+			log("Peer dropped messages. Leaving faststart. New rate="+nconvert(peer.curr_state));
+		}
+		else if(peer.curr_state>0)
+		{
+			peer.last_cong_state=peer.curr_state;
+			--peer.curr_state;
+			LOG("Peer dropped "+nconvert(relay.dropped)+" messages. New rate="+nconvert(peer.curr_state), LL_DEBUG);
+		}
+		os_atomic_store(&peer.load->rate, (unsigned int)peer.curr_state);
+	}
+}
+
+/**
+* Handle the timeout of message msg
+**/
+void ControllerShard::handleTimeout(SMessage* msg)
+{
+	for(size_t i=0;i<msg->route.size()-1 || (i==0 && msg->route.size()==1);++i)
+	{
+		const unsigned int &target=msg->route[i];
+		std::map<unsigned int, SPeer>::iterator it=peers.find(target);
+		if(it!=peers.end())
+		{
+			//Client is in fast start mode
+			if(it->second.last_cong_state==-1)
+			{
+				int next_state=msg->qdata.data[i].state/2;
+				log("Packet loss. Leaving faststart. New rate="+nconvert(next_state));
+				//Set states after leaving faststart. See thesis for details
+				for(int j=msg->qdata.data[i].state/2,s=(int)it->second.qtable.size();j<s && j<msg->qdata.data[i].state;++j)
+				{
+					it->second.qtable[j].up=0;
+					it->second.qtable[j].stay=0;
+					it->second.qtable[j].down=0;
+				}
+				for(int j=msg->qdata.data[i].state,s=(int)it->second.qtable.size();j<s;++j)
+				{
+					it->second.qtable[j].up=0;
+					it->second.qtable[j].stay=0;
+					it->second.qtable[j].down=-1*reinf_down*j;
+				}
+				it->second.curr_state=next_state;
+				it->second.last_cong_state=msg->qdata.data[i].state;
+				continue;
+			}
+			it->second.last_cong_state=msg->qdata.data[i].state;
+			int state=it->second.curr_state+1;
+			if(it->second.last_cong_state!=-1)
+			{
+				//If not in faststart mode add reward
+				int r_state=msg->qdata.data[i].state-msg->qdata.data[i].action;
+				it->second.qtable[r_state].rewards.push_back(SActionReward(msg->qdata.data[i].action, reinf_down*state));
+			}
+			//eventually update q-state
+			addAckPacket(&it->second);
+		}
+	}
+}
+
+/**
+ * Learn the Q-Value of state 'state' and action 'action' as 'ret'
+ */
+void ControllerShard::reinforceQValue(SPeer *pi, int state, int action, double ret)
+{
+	//see thesis for details
+	int last_state=state-action;
+
+	double qmax=pi->qtable[state].down;
+	if(pi->qtable[state].up>qmax)
+		qmax=pi->qtable[state].up;
+	if(pi->qtable[state].stay>qmax)
+		qmax=pi->qtable[state].stay;
+
+	if(action==-1)
+		pi->qtable[last_state].down+=alpha*(ret+lambda*qmax-pi->qtable[last_state].down);
+	else if(action==1)
+		pi->qtable[last_state].up+=alpha*(ret+lambda*qmax-pi->qtable[last_state].up);
+	else if(action==0)
+		pi->qtable[last_state].stay+=alpha*(ret+lambda*qmax-pi->qtable[last_state].stay);
+}
+
+/**
+* Update the congestion controll with an received ack
+*/
+void ControllerShard::addAckPacket(SPeer *pi)
+{
+	pi->ack_packets+=1;
+	if(pi->last_cong_state==-1) // fast start
+	{
+		if(pi->ack_packets>(std::max)((unsigned int)10, (unsigned int)(0.1f*(float)pi->curr_state+0.5f)))
+		{
+			log("Fast Start: Incrementing rate");
+			int next_state=2*pi->curr_state;
+			if(pi->curr_state==0)
+				next_state=1;
+			//sthresh is the rate the client published. Do faststart until that rate or packet
+			//loss
+			if(next_state>pi->sthresh && pi->sthresh>0)
+			{
+				next_state=pi->sthresh;
+				pi->last_cong_state=pi->curr_state;
+			}
+
+			//set all q-values beneath the current state to specific values
+			for(int s=pi->curr_state;s<next_state && s<(int)pi->qtable.size();++s)
+			{
+				pi->qtable[s].up=reinf_up*(s+1);
+				pi->qtable[s].down=0;
+				pi->qtable[s].stay=0;
+			}
+
+			pi->curr_state=next_state;
+
+			//We've reached maximum bandwidth
+			if(pi->curr_state>=(int)pi->qtable.size())
+			{
+				pi->last_cong_state=pi->curr_state;
+				pi->curr_state=pi->qtable.size()-1;
+			}
+			
+			pi->ack_packets=0;
+
+			log("New state: "+nconvert(pi->curr_state));
+		}
+	}
+	else
+	{
+		if(pi->ack_packets>=(std::max)((unsigned int)10, (unsigned int)(0.1f*(float)pi->curr_state+0.5f)))
+		{
+			pi->ack_packets=0;
+			//update the q-state
+			updateQValue(pi);
+			log("StateUpdate: s="+nconvert(pi->curr_state));
+		}
+	}
+}
+
+/**
+ * Select the next state epsilon-greedy on policy (state with maximum q-value
+ */
+void ControllerShard::updateQValue(SPeer *pi)
+{
+	//Apply rewards
+	size_t reward_size=pi->qtable[pi->curr_state].rewards.size();
+	if(reward_size>0)
+	{
+		SQValues reward;
+		size_t rewards_up=0;
+		size_t rewards_down=0;
+		size_t rewards_stay=0;
+		for(size_t i=0;i<reward_size;++i)
+		{
+			SActionReward &r=pi->qtable[pi->curr_state].rewards[i];
+			if(r.action==-1)
+			{
+				reward.down+=r.value;
+				++rewards_down;
+			}
+			else if(r.action==0)
+			{
+				reward.stay+=r.value;
+				++rewards_stay;
+			}
+			else if(r.action==1)
+			{
+				reward.up+=r.value;
+				++rewards_up;
+			}
+		}
+
+		if(rewards_up>0)
+		{
+			reinforceQValue(pi, pi->curr_state+1, 1, reward.up/(double)rewards_up);
+		}
+		if(rewards_stay>0)
+		{
+			reinforceQValue(pi, pi->curr_state, 0, reward.stay/(double)rewards_stay);
+		}
+		if(rewards_down>0)
+		{
+			reinforceQValue(pi, pi->curr_state-1, -1, reward.down/(double)rewards_down);
+		}
+
+		pi->qtable[pi->curr_state].rewards.clear();
+	}
+
+	//Select next action - see thesis for details (e-greedy and on policy)
+	float r=(float)rand()/(float)RAND_MAX;
+	if(r<epsilon)
+	{
+		pi->last_action=rand()%3-1;
+	}
+	else
+	{
+		double qmax=pi->qtable[pi->curr_state].down;
+		pi->last_action=-1;
+		if(pi->qtable[pi->curr_state].up==qmax)
+		{
+			pi->last_action=rand()%2;
+			if(pi->last_action==0)
+				pi->last_action=-1;
+		}
+		if(pi->qtable[pi->curr_state].up>qmax)
+		{
+			pi->last_action=1;
+			qmax=pi->qtable[pi->curr_state].up;
+		}
+		if(pi->qtable[pi->curr_state].stay>qmax)
+		{
+			pi->last_action=0;
+			qmax=pi->qtable[pi->curr_state].up;
+		}
+	}
+
+	if(pi->last_action==-1)
+	{
+		if(pi->curr_state>0)
+		{
+			--pi->curr_state;
+		}
+		else
+		{
+			//pi->curr_state; do nothing
+			pi->last_action=0;
+		}
+	}
+	else if(pi->last_action==1)
+	{
+		if((unsigned int)pi->curr_state<pi->qtable.size()-1)
+		{
+			++pi->curr_state;
+		}
+		else
+		{
+			//--pi->curr_state; do nothing
+			pi->last_action=0;
+		}
+	}
+}
+
+/**
+* Handle an acknowledgement of message msg
+**/
+void ControllerShard::handleAck(SMessage* msg)
+{
+	if(msg->route.size()>1)
+	{
+		//Add reward for each peer on the route
+		for(size_t i=0;i<msg->route.size()-1;++i)
+		{
+			const unsigned int &target=msg->route[i];
+			std::map<unsigned int, SPeer>::iterator it=peers.find(target);
+			if(it!=peers.end())
+			{
+				int state=it->second.curr_state+1;
+				if(it->second.last_cong_state!=-1)
+				{
+					int r_state=msg->qdata.data[i].state-msg->qdata.data[i].action;
+					it->second.qtable[r_state].rewards.push_back(SActionReward(msg->qdata.data[i].action, reinf_up*state));
+				}
+				addAckPacket(&it->second);
+			}
+		}
+	}
+	else
+	{
+		//Add reward for the one peer we sent the message to
+		const unsigned int &target=msg->route[0];
+		std::map<unsigned int, SPeer>::iterator it=peers.find(target);
+		if(it!=peers.end())
+		{
+			int state=it->second.curr_state+1;
+			if(it->second.last_cong_state!=-1)
+			{
+				int r_state=msg->qdata.data[0].state-msg->qdata.data[0].action;
+				it->second.qtable[r_state].rewards.push_back(SActionReward(msg->qdata.data[0].action, reinf_up*state));
+			}
+			addAckPacket(&it->second);
+		}
+	}
+}
@@ -0,0 +1,158 @@
+/**
+* Controller shard. Explores and runs the congestion control for the peers whose id
+* modulo the number of shards is its index. The controller thread gives it peers,
+* new buffers and acknowledgements through lock-free queues
+**/
+
+#ifndef CONTROLLERSHARD_H
+#define CONTROLLERSHARD_H
+
+#include "controller.h"
+#include "../common/spscqueue.h"
+
+/**
+* Acknowledgement of an exploration message sent to the peer with id 'peer_id'
+**/
+struct SPeerAck
+{
+	unsigned int peer_id;
+	unsigned int msgid;
+	float rtt;
+};
+
+/**
+* Messages the peer with id 'peer_id' deferred and dropped because it had no bandwidth left
+**/
+struct SPeerRelay
+{
+	unsigned int peer_id;
+	unsigned int deferred;
+	unsigned int dropped;
+};
+
+/**
+* A peer added to or removed from a shard. Both go through one queue, so the shard
+* applies them in the order the controller made them
+**/
+struct SPeerUpdate
+{
+	//The peer to add. Only its id is set if it is removed
+	SPeer peer;
+	bool remove;
+};
+
+/**
+* The Controller Shard Thread
+**/
+class ControllerShard
+{
+public:
+	/**
+	* Setup the shard for channel 'pChannel'. Sends with the sockets of 'pSenders'
+	**/
+	ControllerShard(unsigned short pChannel, SenderPool *pSenders);
+
+	/**
+	* Add the peer 'peer' to the shard. Its load is shared with the controller. Called by the controller thread
+	**/
+	void addPeer(const SPeer &peer);
+	/**
+	* Remove the peer with id 'peer_id'. Called by the controller thread
+	**/
+	void removePeer(unsigned int peer_id);
+	/**
+	* Explore with the new buffer 'buf'. Called by the controller thread
+	**/
+	void addBuffer(SBuffer *buf);
+	/**
+	* Handle the acknowledgement 'ack'. Called by the controller thread
+	**/
+	void addAck(const SPeerAck &ack);
+	/**
+	* Handle the relay report 'relay'. Called by the controller thread
+	**/
+	void addRelayReport(const SPeerRelay &relay);
+	/**
+	* Set the bandwidth used for exploration per timestep
+	**/
+	void setExplorationBandwidth(unsigned int bandwidth);
+
+	/**
+	* Get information about the peers of this shard
+	**/
+	std::vector<SBest> getBestNodes(void);
+
+	/**
+	* Main thread function
+	**/
+	void operator()(void);
+
+private:
+	//Apply the peers added and removed by the controller
+	void updatePeers(void);
+	//Explore with the new buffers as long as the exploration bandwidth allows it
+	void explore(unsigned int &b_explore);
+	//Handle the new acknowledgements and the timeouts
+	void handleAcks(void);
+	//Lower the rate of peers which dropped messages
+	void handleRelayReports(void);
+
+	//update the data structure about the best nodes
+	void updateBestNodes(void);
+	//construct a random sequence of length len and numbers smaller than len; bigger than zero and unique.
+	//E.g. random_sequence(4) gives 1,2,0,3.
+	std::vector<size_t> random_sequence(size_t len);
+	//Reinforce a q-value in Peer pi with specific state and action with ret
+	void reinforceQValue(SPeer *pi, int state, int action, double ret);
+	//Update the congestion controll with an received ack
+	void addAckPacket(SPeer *pi);
+	//update the q-value: The state the congestion controller is in is updated.
+	void updateQValue(SPeer *pi);
+	//Messages the peer forwards in the current timestep
+	unsigned int getWindow(SPeer *pi);
+
+	//Returns the esimated latency from client with id 'from' to client with id 'to'
+	float getLatency(unsigned int from, unsigned int to);
+
+	//Handle the timeout of message msg
+	void handleTimeout(SMessage* msg);
+	//Handle an acknowledgement of message msg
+	void handleAck(SMessage* msg);
+	//update the RTT using message msg (for which an ACK was received) and the delay from last client to server
+	void updateRtts(float server_rtt, SMessage *msg);
+	//update the latency from 'from' to 'to' with newrtt
+	void updateSingleLatency(unsigned int from, unsigned int to, float newrtt);
+
+	//Queues filled by the controller thread
+	CSPSCQueue<SPeerUpdate> peer_updates;
+	CSPSCQueue<SBuffer*> new_buffers;
+	CSPSCQueue<SPeerAck> new_acks;
+	CSPSCQueue<SPeerRelay> new_relay_reports;
+
+	//Data structures to save information about the peers(clients) of this shard
+	std::map<unsigned int, SPeer> peers;
+
+	//Channel this shard streams
+	unsigned short channel;
+
+	//Bandwidth used for exploration. Set by the controller thread
+	volatile unsigned int bandwidth_exploration;
+
+	//Mutex to synchronize access to the best_* data structures
+	boost::mutex mutex;
+	//Information about peers for the tracker thread
+	std::vector<SBest> best_nodes;
+	std::vector<SBest> l_best_nodes;
+
+	//List of messages of which timeout can still occurr
+	std::list<SMessage*> msgs_timeouts;
+	//Messages in garbage waiting to be deleted
+	std::queue<SMessage*> msgs_garbage;
+	//Mapps client and message id to Message
+	std::map<unsigned int, std::map<unsigned int, SMessage*> > sent_msgs;
+
+	//Sockets of the server. Shared by all channels
+	SenderPool *senders;
+};
+
+#endif //CONTROLLERSHARD_H
@@ -0,0 +1,165 @@
+/**
+* Measures the throughput of the xor parity forward error correction. Not installed.
+* Start with fecbench ([group size] [buffer size] [ms per measurement])
+**/
+
+#include "../common/fec.h"
+#include "../common/os_functions.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+
+/**
+* Xor one byte at a time. What the parity would cost without fec_xor
+**/
+static void bytewise_xor(char *dst, const char *src, size_t len)
+{
+	for(size_t i=0;i<len;++i)
+	{
+		dst[i]^=src[i];
+	}
+}
+
+/**
+* Print the throughput of 'bytes' processed in 'ms'
+**/
+static void printRate(const std::string &name, double bytes, unsigned int ms)
+{
+	if(ms==0)
+		ms=1;
+	std::cout << name << ": " << (unsigned int)(bytes/1000.0/ms+0.5) << " MB/s" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned int group_size=8;
+	size_t bsize=1400;
+	unsigned int duration=1000;
+	if(argc>1)
+		group_size=(unsigned int)atoi(argv[1]);
+	if(argc>2)
+		bsize=(size_t)atoi(argv[2]);
+	if(argc>3)
+		duration=(unsigned int)atoi(argv[3]);
+	if(group_size<2 || group_size>fec_max_group || bsize==0)
+	{
+		std::cout << "group size has to be between 2 and " << fec_max_group << std::endl;
+		return 1;
+	}
+
+	std::vector<std::vector<char> > bufs(group_size);
+	for(unsigned int i=0;i<group_size;++i)
+	{
+		bufs[i].resize(bsize);
+		for(size_t j=0;j<bsize;++j)
+		{
+			bufs[i][j]=(char)rand();
+		}
+	}
+	std::cout << "group size " << group_size << ", buffer size " << bsize << std::endl;
+
+	//Xor of single buffers
+	{
+		std::vector<char> dst(bsize, 0);
+		double bytes=0;
+		unsigned int start=os_gettimems();
+		while(os_gettimems()-start<duration)
+		{
+			for(unsigned int i=0;i<1000;++i)
+			{
+				bytewise_xor(&dst[0], &bufs[i%group_size][0], bsize);
+			}
+			bytes+=1000.0*bsize;
+		}
+		printRate("xor bytewise", bytes, os_gettimems()-start);
+
+		bytes=0;
+		start=os_gettimems();
+		while(os_gettimems()-start<duration)
+		{
+			for(unsigned int i=0;i<1000;++i)
+			{
+				fec_xor(&dst[0], &bufs[i%group_size][0], bsize);
+			}
+			bytes+=1000.0*bsize;
+		}
+		printRate("xor fec_xor", bytes, os_gettimems()-start);
+	}
+
+	//Encoding: the server adds every buffer of a group to the parity
+	CFecGroup group;
+	{
+		double bytes=0;
+		unsigned int id=1;
+		unsigned int start=os_gettimems();
+		while(os_gettimems()-start<duration)
+		{
+			for(unsigned int n=0;n<100;++n)
+			{
+				group.reset(id, group_size);
+				for(unsigned int i=0;i<group_size;++i)
+				{
+					group.add(id+i, &bufs[i][0], bsize);
+				}
+				id+=group_size;
+			}
+			bytes+=100.0*group_size*bsize;
+		}
+		printRate("encode", bytes, os_gettimems()-start);
+	}
+
+	//Decoding: the client misses one buffer of the group and recovers it with the parity
+	{
+		group.reset(1, group_size);
+		for(unsigned int i=0;i<group_size;++i)
+		{
+			group.add(1+i, &bufs[i][0], bsize);
+		}
+		std::vector<char> parity(group.getParity(), group.getParity()+group.getParitySize());
+		unsigned short size_xor=group.getSizeXor();
+
+		std::vector<char> rbuf;
+		for(unsigned int lost=0;lost<group_size;++lost)
+		{
+			group.reset(1, group_size);
+			for(unsigned int i=0;i<group_size;++i)
+			{
+				if(i!=lost)
+				{
+					group.add(1+i, &bufs[i][0], bsize);
+				}
+			}
+			unsigned int id;
+			if(!group.recover(&parity[0], parity.size(), size_xor, id, rbuf) || id!=1+lost || rbuf!=bufs[lost])
+			{
+				std::cout << "recovery failed" << std::endl;
+				return 1;
+			}
+		}
+
+		double bytes=0;
+		unsigned int start=os_gettimems();
+		while(os_gettimems()-start<duration)
+		{
+			for(unsigned int n=0;n<100;++n)
+			{
+				unsigned int lost=n%group_size;
+				group.reset(1, group_size);
+				for(unsigned int i=0;i<group_size;++i)
+				{
+					if(i!=lost)
+					{
+						group.add(1+i, &bufs[i][0], bsize);
+					}
+				}
+				unsigned int id;
+				group.recover(&parity[0], parity.size(), size_xor, id, rbuf);
+			}
+			bytes+=100.0*group_size*bsize;
+		}
+		printRate("decode", bytes, os_gettimems()-start);
+	}
+
+	return 0;
+}
@@ -0,0 +1,221 @@
+#include "filesource.h"
+#include "../common/tspacket.h"
+#include "../common/os_functions.h"
+#include "../common/stringtools.h"
+#include "../common/log.h"
+#include <memory.h>
+
+//Size of the buffer the file is read into
+const size_t file_buffer_size=64*1024;
+//References further apart than this in 90 kHz ticks are discontinuities
+const boost::uint64_t file_max_pcr_gap=ts_pcr_hz*2;
+//If the replay falls further behind than this (in ms) it continues from the current time
+const unsigned int file_max_lag=1000;
+
+/**
+* Replay the file 'pFilename'
+**/
+FileSource::FileSource(const std::string &pFilename) : filename(pFilename)
+{
+	fbuf=new char[file_buffer_size];
+	fbuf_pos=0;
+	fbuf_size=0;
+	discontinuities=0;
+	pass_packets=false;
+	has_pcr=false;
+	pcr_pid=0;
+	last_pcr=0;
+	clock=0;
+	start_time=0;
+
+	file=fopen(filename.c_str(), "rb");
+	if(file==NULL)
+	{
+		log("Could not open input file \""+filename+"\"");
+	}
+}
+
+FileSource::~FileSource(void)
+{
+	if(file!=NULL)
+	{
+		fclose(file);
+	}
+	delete [] fbuf;
+}
+
+/**
+* Returns false if the file could not be opened
+**/
+bool FileSource::isOk(void)
+{
+	return file!=NULL;
+}
+
+/**
+* Read the next packets into 'buf' of size 'bsize'. Waits until the
+* first packet is due
+**/
+size_t FileSource::read(char *buf, size_t bsize)
+{
+	while(true)
+	{
+		if(fbuf_size-fbuf_pos<ts_packet_size)
+		{
+			if(!fill())
+			{
+				os_sleep(1000);
+			}
+			continue;
+		}
+
+		if(bsize<ts_packet_size)
+		{
+			memcpy(buf, &fbuf[fbuf_pos], bsize);
+			fbuf_pos+=bsize;
+			pass_packets=true;
+			return bsize;
+		}
+
+		size_t n=ts_count_packets(fbuf, fbuf_size, fbuf_pos);
+		if(n==0)
+		{
+			size_t off=ts_find_sync(fbuf, fbuf_size, fbuf_pos+1);
+			if(off>=fbuf_size)
+			{
+				//Keep the start of a possible packet
+				off=fbuf_size-ts_packet_size+1;
+			}
+			fbuf_pos=off;
+			continue;
+		}
+
+		if(n>bsize/ts_packet_size)
+			n=bsize/ts_packet_size;
+
+		const char *pkt=&fbuf[fbuf_pos];
+		if(hasClock(pkt))
+		{
+			waitForPacket(pkt);
+		}
+
+		//Return the packets up to the next reference, so it is waited for
+		size_t count=1;
+		while(count<n && !hasClock(pkt+count*ts_packet_size))
+			++count;
+
+		size_t rsize=count*ts_packet_size;
+		memcpy(buf, pkt, rsize);
+		fbuf_pos+=rsize;
+		pass_packets=true;
+		return rsize;
+	}
+}
+
+/**
+* Returns how often the file was restarted
+**/
+unsigned int FileSource::getDiscontinuities(void)
+{
+	return discontinuities;
+}
+
+/**
+* Read more data from the file. Starts again at the beginning at the end of the file.
+* Returns false on error or if the last pass over the file returned no packets
+**/
+bool FileSource::fill(void)
+{
+	if(file==NULL)
+		return false;
+
+	size_t left=fbuf_size-fbuf_pos;
+	memmove(fbuf, &fbuf[fbuf_pos], left);
+	fbuf_pos=0;
+	fbuf_size=left;
+
+	size_t rc=fread(&fbuf[fbuf_size], 1, file_buffer_size-fbuf_size, file);
+	if(rc==0)
+	{
+		if(ferror(file))
+		{
+			log("Error reading input file \""+filename+"\"");
+			return false;
+		}
+
+		//Start again. The incomplete packet at the end is dropped
+		fseek(file, 0, SEEK_SET);
+		fbuf_size=0;
+		if(!pass_packets)
+		{
+			//Without a packet in the whole file the next pass would start right away
+			log("Input file \""+filename+"\" contains no transport stream packets");
+			return false;
+		}
+		pass_packets=false;
+		LOG("Input: Restarting input file \""+filename+"\"", LL_INFO);
+		++discontinuities;
+		has_pcr=false;
+		rc=fread(fbuf, 1, file_buffer_size, file);
+		if(rc==0)
+		{
+			log("Input file \""+filename+"\" is empty");
+			return false;
+		}
+	}
+	fbuf_size+=rc;
+	return true;
+}
+
+/**
+* Returns if 'pkt' carries the program clock reference used for pacing
+**/
+bool FileSource::hasClock(const char *pkt)
+{
+	boost::uint64_t pcr;
+	if(has_pcr && ts_get_pid(pkt)!=pcr_pid)
+		return false;
+	return ts_get_pcr(pkt, pcr);
+}
+
+/**
+* Wait until the packet 'pkt' with a program clock reference is due
+**/
+void FileSource::waitForPacket(const char *pkt)
+{
+	boost::uint64_t pcr;
+	ts_get_pcr(pkt, pcr);
+
+	unsigned int ctime=os_gettimems();
+	if(!has_pcr)
+	{
+		has_pcr=true;
+		pcr_pid=ts_get_pid(pkt);
+		clock=0;
+		start_time=ctime;
+	}
+	else
+	{
+		boost::uint64_t diff=(pcr-last_pcr)&(ts_pcr_wrap-1);
+		if(diff>file_max_pcr_gap)
+		{
+			LOG("Input: Discontinuity in program clock reference of input file", LL_DEBUG);
+			start_time=ctime-(unsigned int)(clock/(ts_pcr_hz/1000));
+		}
+		else
+		{
+			clock+=diff;
+		}
+	}
+	last_pcr=pcr;
+
+	unsigned int due=start_time+(unsigned int)(clock/(ts_pcr_hz/1000));
+	if((int)(due-ctime)>0)
+	{
+		os_sleep(due-ctime);
+	}
+	else if(ctime-due>file_max_lag)
+	{
+		start_time+=ctime-due;
+	}
+}
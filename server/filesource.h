@@ -0,0 +1,72 @@
+/**
+* Replays a transport stream file in real time. The pace is taken from the
+* program clock references in the file. The file is repeated endlessly
+**/
+#ifndef FILESOURCE_H
+#define FILESOURCE_H
+
+#include "inputsource.h"
+#include <stdio.h>
+#include <boost/cstdint.hpp>
+
+class FileSource : public IInputSource
+{
+public:
+	/**
+	* Replay the file 'pFilename'
+	**/
+	FileSource(const std::string &pFilename);
+	~FileSource(void);
+
+	/**
+	* Returns false if the file could not be opened
+	**/
+	bool isOk(void);
+
+	/**
+	* Read the next packets into 'buf' of size 'bsize'. Waits until the
+	* first packet is due
+	**/
+	size_t read(char *buf, size_t bsize);
+
+	/**
+	* Returns how often the file was restarted
+	**/
+	unsigned int getDiscontinuities(void);
+
+private:
+	/**
+	* Read more data from the file. Starts again at the beginning at the end of the file.
+	* Returns false on error or if the last pass over the file returned no packets
+	**/
+	bool fill(void);
+	/**
+	* Returns if 'pkt' carries the program clock reference used for pacing
+	**/
+	bool hasClock(const char *pkt);
+	/**
+	* Wait until the packet 'pkt' with a program clock reference is due
+	**/
+	void waitForPacket(const char *pkt);
+
+	std::string filename;
+	FILE *file;
+
+	//Data read from the file
+	char *fbuf;
+	size_t fbuf_pos;
+	size_t fbuf_size;
+
+	unsigned int discontinuities;
+	//If packets were returned since the file was last started
+	bool pass_packets;
+
+	//Pacing. 'clock' is the stream time in 90 kHz ticks since 'start_time'
+	bool has_pcr;
+	unsigned short pcr_pid;
+	boost::uint64_t last_pcr;
+	boost::uint64_t clock;
+	unsigned int start_time;
+};
+
+#endif //FILESOURCE_H
@@ -0,0 +1,469 @@
+#include "httpsource.h"
+#include "../common/stringtools.h"
+#include "../common/socket_functions.h"
+#include "../common/os_functions.h"
+#include "../common/log.h"
+#include <memory.h>
+#include <stdlib.h>
+#include <vector>
+
+//Size of the read ahead buffer for the header and chunk size lines
+const size_t http_rbuf_size=4096;
+//Maximal length of a header or chunk size line
+const size_t http_max_line=8192;
+//Time without data after which the connection is reestablished in ms
+const unsigned int http_read_timeout=10000;
+//First and maximal wait time between connection attempts in ms
+const unsigned int http_backoff_min=500;
+const unsigned int http_backoff_max=30000;
+//Size of the socket receive buffer. Absorbs bursts while the input thread is busy
+const unsigned int http_recv_window=1024*1024;
+//Maximal number of redirects followed in a row
+const unsigned int http_max_redirects=5;
+
+HttpSource::HttpSource(const std::string &pURL) : url(pURL)
+{
+	s=SOCKET_ERROR;
+	connected=false;
+	conn_close=false;
+	chunked=false;
+	chunk_left=0;
+	has_length=false;
+	length_left=0;
+	response_done=false;
+	rbuf=new char[http_rbuf_size];
+	rbuf_pos=0;
+	rbuf_size=0;
+	backoff=http_backoff_min;
+	redirects=0;
+	follow_redirect=false;
+	reconnects=0;
+	parseURL(url);
+}
+
+HttpSource::~HttpSource(void)
+{
+	if(connected)
+	{
+		os_closesocket(s);
+	}
+	delete [] rbuf;
+}
+
+/**
+* Split the url into server, port and query
+**/
+void HttpSource::parseURL(const std::string &pURL)
+{
+	std::string rest=pURL;
+	if(rest.find("://")!=std::string::npos)
+	{
+		rest=getafter("://", rest);
+	}
+	size_t qpos=rest.find("/");
+	if(qpos!=std::string::npos)
+	{
+		host=rest.substr(0, qpos);
+		query=rest.substr(qpos);
+	}
+	else
+	{
+		host=rest;
+		query="/";
+	}
+	server_name=host;
+	server_port=80;
+	if(host.find(":")!=std::string::npos)
+	{
+		server_name=getuntil(":", host);
+		server_port=atoi(getafter(":", host).c_str());
+	}
+}
+
+/**
+* Read up to 'bsize' bytes of the stream body into 'buf'. Blocks until
+* at least one byte is available and reconnects as often as needed.
+* Returns the number of bytes read
+**/
+size_t HttpSource::read(char *buf, size_t bsize)
+{
+	while(true)
+	{
+		if(!connected)
+		{
+			if(!connect())
+			{
+				disconnect();
+				continue;
+			}
+		}
+		else if(response_done)
+		{
+			//Keep alive: request the stream again on the same connection
+			if(conn_close || !sendRequest() || !readHeader())
+			{
+				disconnect();
+				continue;
+			}
+		}
+
+		size_t toread=bsize;
+		if(chunked)
+		{
+			if(chunk_left==0)
+			{
+				if(!readChunkSize())
+				{
+					disconnect();
+					continue;
+				}
+				if(response_done)
+				{
+					continue;
+				}
+			}
+			if(chunk_left<toread)
+				toread=chunk_left;
+		}
+		else if(has_length)
+		{
+			if(length_left==0)
+			{
+				response_done=true;
+				continue;
+			}
+			if(length_left<toread)
+				toread=(size_t)length_left;
+		}
+
+		size_t rc=recvData(buf, toread);
+		if(rc==0)
+		{
+			log("Lost connection to streaming input server");
+			disconnect();
+			continue;
+		}
+
+		if(chunked)
+		{
+			chunk_left-=rc;
+		}
+		else if(has_length)
+		{
+			length_left-=rc;
+		}
+		backoff=http_backoff_min;
+		redirects=0;
+		return rc;
+	}
+}
+
+/**
+* Get the number of times the connection had to be reestablished
+**/
+unsigned int HttpSource::getDiscontinuities(void)
+{
+	return reconnects;
+}
+
+/**
+* Connect to the server and send the request. Returns false on error
+**/
+bool HttpSource::connect(void)
+{
+	s=os_createSocket(false);
+	os_set_recv_window(s, http_recv_window);
+	connected=true;
+	rbuf_pos=0;
+	rbuf_size=0;
+
+	unsigned int server_ip=os_resolv(server_name);
+	if(server_ip==0)
+	{
+		log("Could not resolve streaming input server \""+server_name+"\"");
+		return false;
+	}
+
+	if(!os_connect(s, server_ip, server_port) )
+	{
+		log("Could not connect to streaming input server \""+host+"\"");
+		return false;
+	}
+
+	if(!sendRequest() || !readHeader())
+		return false;
+
+	if(reconnects>0)
+	{
+		log("Reconnected to streaming input server \""+host+"\"");
+	}
+	return true;
+}
+
+/**
+* Send the GET request on the current connection
+**/
+bool HttpSource::sendRequest(void)
+{
+	std::string req="GET "+query+" HTTP/1.1\r\n"
+					"Host: "+host+"\r\n"
+					"User-Agent: QStream server\r\n"
+					"Accept: */*\r\n"
+					"Connection: keep-alive\r\n\r\n";
+
+	return os_send(s, req.c_str(), req.size())==(int)req.size();
+}
+
+/**
+* Receive and parse the response header. Returns false on error
+**/
+bool HttpSource::readHeader(void)
+{
+	chunked=false;
+	chunk_left=0;
+	has_length=false;
+	length_left=0;
+	response_done=false;
+	conn_close=false;
+
+	std::string status;
+	if(!readLine(status))
+		return false;
+
+	size_t spos=status.find(" ");
+	if(status.find("HTTP/")!=0 || spos==std::string::npos)
+	{
+		log("Invalid response from streaming input server: \""+status+"\"");
+		return false;
+	}
+	int code=atoi(status.substr(spos+1).c_str());
+	if(status.find("HTTP/1.0")==0)
+	{
+		conn_close=true;
+	}
+
+	std::string location;
+	std::string line;
+	while(true)
+	{
+		if(!readLine(line))
+			return false;
+		if(line.empty())
+			break;
+
+		std::string key=strlower(trim(getuntil(":", line)));
+		std::string value=trim(getafter(":", line));
+		if(key=="transfer-encoding")
+		{
+			chunked=strlower(value).find("chunked")!=std::string::npos;
+		}
+		else if(key=="content-length")
+		{
+			has_length=true;
+			length_left=0;
+			for(size_t i=0;i<value.size() && value[i]>='0' && value[i]<='9';++i)
+			{
+				length_left=length_left*10+(value[i]-'0');
+			}
+		}
+		else if(key=="connection")
+		{
+			std::string lv=strlower(value);
+			if(lv=="close")
+				conn_close=true;
+			else if(lv=="keep-alive")
+				conn_close=false;
+		}
+		else if(key=="location")
+		{
+			location=value;
+		}
+	}
+
+	if(chunked)
+	{
+		has_length=false;
+	}
+	else if(!has_length)
+	{
+		//Body ends when the server closes the connection
+		conn_close=true;
+	}
+
+	if(code>=300 && code<400 && !location.empty())
+	{
+		if(redirects>=http_max_redirects)
+		{
+			log("Too many redirects from streaming input server");
+			return false;
+		}
+		++redirects;
+		log("Streaming input server redirects to \""+location+"\"");
+		if(location.find("://")==std::string::npos)
+		{
+			location="http://"+host+location;
+		}
+		parseURL(location);
+		follow_redirect=true;
+		return false;
+	}
+
+	if(code<200 || code>=300)
+	{
+		log("Streaming input server returned \""+status+"\"");
+		return false;
+	}
+
+	return true;
+}
+
+/**
+* Receive the size line of the next chunk. Returns false on error
+**/
+bool HttpSource::readChunkSize(void)
+{
+	std::string line;
+	if(!readLine(line))
+		return false;
+	//Line break after the data of the previous chunk
+	if(line.empty() && !readLine(line))
+		return false;
+
+	std::string size=trim(line);
+	if(size.find(";")!=std::string::npos)
+	{
+		size=trim(getuntil(";", size));
+	}
+	if(size.empty())
+	{
+		log("Invalid chunk from streaming input server");
+		return false;
+	}
+	chunk_left=hexToULong(size);
+
+	if(chunk_left==0)
+	{
+		//Last chunk. Skip the trailer
+		do
+		{
+			if(!readLine(line))
+				return false;
+		}
+		while(!line.empty());
+		response_done=true;
+	}
+	return true;
+}
+
+/**
+* Close the connection and wait before the next attempt
+**/
+void HttpSource::disconnect(void)
+{
+	if(connected)
+	{
+		os_closesocket(s);
+		connected=false;
+		++reconnects;
+	}
+	if(follow_redirect)
+	{
+		//Follow redirects without waiting
+		follow_redirect=false;
+		return;
+	}
+	redirects=0;
+	log("Reconnecting to streaming input server in "+nconvert(backoff)+" ms");
+	os_sleep(backoff);
+	backoff*=2;
+	if(backoff>http_backoff_max)
+		backoff=http_backoff_max;
+	parseURL(url);
+}
+
+/**
+* Read a line terminated by CRLF from the connection
+**/
+bool HttpSource::readLine(std::string &line)
+{
+	line.clear();
+	while(true)
+	{
+		if(rbuf_pos>=rbuf_size && !fill())
+			return false;
+
+		char *start=rbuf+rbuf_pos;
+		char *nl=(char*)memchr(start, '\n', rbuf_size-rbuf_pos);
+		if(nl!=NULL)
+		{
+			line.append(start, nl-start);
+			rbuf_pos+=nl-start+1;
+			if(!line.empty() && line[line.size()-1]=='\r')
+			{
+				line.erase(line.size()-1);
+			}
+			return true;
+		}
+		line.append(start, rbuf_size-rbuf_pos);
+		rbuf_pos=rbuf_size;
+		if(line.size()>http_max_line)
+		{
+			log("Line from streaming input server too long");
+			return false;
+		}
+	}
+}
+
+/**
+* Fill the read ahead buffer. Returns false on timeout, error or close
+**/
+bool HttpSource::fill(void)
+{
+	rbuf_pos=0;
+	rbuf_size=0;
+	if(!waitReadable())
+		return false;
+	int rc=os_recv(s, rbuf, http_rbuf_size);
+	if(rc<=0)
+		return false;
+	rbuf_size=rc;
+	return true;
+}
+
+/**
+* Read up to 'bsize' bytes, first from the read ahead buffer and then
+* directly from the socket. Returns 0 on timeout, error or close
+**/
+size_t HttpSource::recvData(char *buf, size_t bsize)
+{
+	if(rbuf_pos<rbuf_size)
+	{
+		size_t tocopy=rbuf_size-rbuf_pos;
+		if(tocopy>bsize)
+			tocopy=bsize;
+		memcpy(buf, rbuf+rbuf_pos, tocopy);
+		rbuf_pos+=tocopy;
+		return tocopy;
+	}
+	if(!waitReadable())
+		return 0;
+	int rc=os_recv(s, buf, bsize);
+	if(rc<=0)
+		return 0;
+	return rc;
+}
+
+/**
+* Wait until the socket is readable
+**/
+bool HttpSource::waitReadable(void)
+{
+	std::vector<SOCKET> socks;
+	socks.push_back(s);
+	if(os_select(socks, http_read_timeout).empty())
+	{
+		log("Timeout while reading from streaming input server");
+		return false;
+	}
+	return true;
+}
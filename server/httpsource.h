@@ -0,0 +1,116 @@
+/**
+* Reads the body of a HTTP stream. Decodes chunked transfer encoding,
+* keeps the connection alive between responses and reconnects with
+* backoff if the connection to the streaming server fails
+**/
+#ifndef HTTPSOURCE_H
+#define HTTPSOURCE_H
+
+#include "../common/types.h"
+#include "inputsource.h"
+#include <string>
+
+class HttpSource : public IInputSource
+{
+public:
+	/**
+	* Read the stream with the URL pURL
+	**/
+	HttpSource(const std::string &pURL);
+	~HttpSource(void);
+
+	/**
+	* Read up to 'bsize' bytes of the stream body into 'buf'. Blocks until
+	* at least one byte is available and reconnects as often as needed.
+	* Returns the number of bytes read
+	**/
+	size_t read(char *buf, size_t bsize);
+
+	/**
+	* Get the number of times the connection had to be reestablished
+	**/
+	unsigned int getDiscontinuities(void);
+
+private:
+
+	/**
+	* Split the url into server, port and query
+	**/
+	void parseURL(const std::string &pURL);
+
+	/**
+	* Connect to the server and send the request. Returns false on error
+	**/
+	bool connect(void);
+	/**
+	* Send the GET request on the current connection
+	**/
+	bool sendRequest(void);
+	/**
+	* Receive and parse the response header. Returns false on error
+	**/
+	bool readHeader(void);
+	/**
+	* Receive the size line of the next chunk. Returns false on error
+	**/
+	bool readChunkSize(void);
+
+	/**
+	* Close the connection and wait before the next attempt
+	**/
+	void disconnect(void);
+
+	/**
+	* Read a line terminated by CRLF from the connection
+	**/
+	bool readLine(std::string &line);
+	/**
+	* Fill the read ahead buffer. Returns false on timeout, error or close
+	**/
+	bool fill(void);
+	/**
+	* Read up to 'bsize' bytes, first from the read ahead buffer and then
+	* directly from the socket. Returns 0 on timeout, error or close
+	**/
+	size_t recvData(char *buf, size_t bsize);
+	/**
+	* Wait until the socket is readable
+	**/
+	bool waitReadable(void);
+
+	//The configured stream url and the server, port and query currently used
+	std::string url;
+	std::string server_name;
+	std::string host;
+	unsigned short server_port;
+	std::string query;
+
+	SOCKET s;
+	bool connected;
+	//The server closes the connection after the current response
+	bool conn_close;
+
+	//Current response is chunked
+	bool chunked;
+	//Bytes left in the current chunk
+	size_t chunk_left;
+	//Current response has a content length
+	bool has_length;
+	//Bytes left in the current response
+	unsigned long long length_left;
+	//The response body was completely read
+	bool response_done;
+
+	//Read ahead buffer for header and chunk size lines
+	char *rbuf;
+	size_t rbuf_pos;
+	size_t rbuf_size;
+
+	//Time to wait before the next connection attempt
+	unsigned int backoff;
+	unsigned int redirects;
+	bool follow_redirect;
+	unsigned int reconnects;
+};
+
+#endif //HTTPSOURCE_H
@@ -1,222 +1,320 @@
-#include "input.h"
-#include "../common/stringtools.h"
-#include "../common/socket_functions.h"
-#include "../common/os_functions.h"
-#include "../common/log.h"
+#include "input.h"
+#include "inputsource.h"
+#include "../common/os_functions.h"
+#include "../common/os_atomic.h"
+#include "../common/stringtools.h"
+#include "../common/log.h"
 #include <memory.h>
-
-//Time a buffer should be kept in ms
-const unsigned int buffer_time=5000;
-//Size of a buffer
-const unsigned int buffer_size=1440;
-
-/**
-* Initialize the input thread. Use the URL pURL for acessing the stream
-* via HTTP
-*/
-Input::Input(const std::string &pURL) : url(pURL)
-{
-	curr_buffer_id=0;
-	last_packetcounttime=os_gettimems();
-	packets=0;
-	packets_sec=0;
-	max_packets_sec=0;
-}
-
-/**
-* main thread function
-**/
-void Input::operator()(void)
-{
-	SOCKET server_socket=os_createSocket(false);
-
-	//Tokenize the url - get server query and port
-	std::string server=getbetween("http://","/", url);
-	std::string server_name=server;
-	std::string query=getafter("http://"+server_name, url);
-	unsigned short server_port=80;
-	if(server.find(":")!=std::string::npos)
-	{
-		server_name=getuntil(":", server);
-		server_port=atoi(getafter(":", server).c_str());
-	}
-
-	//Get server ip, connect and send HTTP Request
-	unsigned int server_ip=os_resolv(server_name);
-
-	if(!os_connect(server_socket, server_ip, server_port) )
-	{
-		log("Could not connect to streaming input server. Aborting.");
-		return;
-	}
-
-	std::string req="GET "+query+" HTTP/1.1\r\n"
-					"Host: "+server+"\r\n"
-					"User-Agent: QStream client\r\n"
-					"Accept: */*\r\n"
-					"Connection: close\r\n\r\n";
-
-	os_send(server_socket, req.c_str(), req.size());
-
-	//Receive the buffers
-	int state=0;
-	int rc;
-	do
-	{
-		SBuffer *nb;
-		{
-			boost::mutex::scoped_lock lock(mutex);
-			if(buffer_trash.empty() || (os_gettimems()-buffer_trash.front()->created)<500)
-			{
-				nb=new SBuffer;
-				nb->data=new char[buffer_size];
-			}
-			else
-			{
-				nb=buffer_trash.front();
-				buffer_trash.pop();
-			}		
-		}
-		int offset=0;
-		rc=os_recv(server_socket, nb->data, buffer_size);
-		if(rc>0)
-		{
-			//If we're in state 0 the header hasn't been received yet. Look for it and switch to state 1
-			if(state==0) //header
-			{
-				for(size_t i=0;i<(size_t)rc;++i)
-				{
-					if(i>=4 && nb->data[i]=='\n' && nb->data[i-1]=='\r' && nb->data[i-2]=='\n' && nb->data[i-3]=='\r' )
-					{
-						state=1;
-						offset=i+1;
-					}
-				}
-			}
-			//Header has been received. Collect buffers
-			if(state==1 && rc-offset>0 ) // body
-			{
-				if(offset!=0)
-				{
-					char *nd=new char[buffer_size];
-					memcpy(nd, nb->data, rc);
-					delete [] nb->data;
-					nb->data=nd;
-				}				
-				//Create new buffers
-
-				nb->datasize=rc-offset;
-				nb->created=os_gettimems();
-				nb->id=++curr_buffer_id;			
-
-				boost::mutex::scoped_lock lock(mutex);
-				if(os_gettimems()- last_packetcounttime>1000 && packets!=0)
-				{
-					packets_sec=0.9f*packets_sec+0.1f*(float)packets;
-					if(packets_sec>max_packets_sec)
-					{
-						max_packets_sec=packets_sec;
-					}
-					packets=0;
-					last_packetcounttime=os_gettimems();
-				}
-				++packets;
-				new_buffers.push(nb);
-				buffer_ids.insert(std::pair<size_t, SBuffer*>(nb->id, nb) );
-			}
-		}
-
-		//Remove old buffers
-		cleanBuffer();
-	}
-	while(rc>0);
-}
-
-/**
-* Clean old buffers
-**/
-void Input::cleanBuffer(void)
-{
-	boost::mutex::scoped_lock lock(mutex);
-	//Remove old buffers and trash them
-	do
-	{
-		if(!old_buffers.empty())
-		{
-			SBuffer *nm=old_buffers.front();
-			//if the buffer is older than buffer_time trash it else stop cleaning
-			if(os_gettimems()-nm->created>buffer_time)
-			{
-				old_buffers.pop();
-				std::map<size_t, SBuffer*>::iterator it=buffer_ids.find(nm->id);
-				if(it!=buffer_ids.end())
-				{
-					buffer_ids.erase(it);
-				}
-				nm->created=os_gettimems();
-				buffer_trash.push(nm);
-			}
-			else
-			{
-				break;
-			}
-		}
-		else
-		{
-			break;
-		}
-	}
-	while(true);
-}
-
-/**
-* Get the average amount of packets received per second
-**/
-float Input::getPacketsPerSecond(void)
-{
-	boost::mutex::scoped_lock lock(mutex);
-	return packets_sec;
-}
-
-/**
-* Get the maximal amount of packets received per second
-**/
-float Input::getMaxPacketsPerSecond(void)
-{
-	boost::mutex::scoped_lock lock(mutex);
-	return max_packets_sec;
-}
-
-/**
-* Get the new buffers
-**/
-std::vector<SBuffer*> Input::getNewBuffers(void)
-{
-	boost::mutex::scoped_lock lock(mutex);
-	std::vector<SBuffer*> nb;
-	while(!new_buffers.empty())
-	{
-		new_buffers.front()->already_used=false;
-		nb.push_back(new_buffers.front());
-		old_buffers.push(new_buffers.front());
-		new_buffers.pop();
-	}
-	return nb;
-}
-
-/**
-* Get a specific buffer
-**/
-SBuffer* Input::getBuffer(size_t id)
-{
-	boost::mutex::scoped_lock lock(mutex);
-	std::map<size_t, SBuffer*>::iterator it=buffer_ids.find(id);
-	if(it!=buffer_ids.end())
-	{
-		return it->second;
-	}
-	else
-	{
-		return NULL;
-	}
+
+//Buffers have to stay available at least this long in ms, as the controllers send them for up to one second
+const unsigned int input_min_retention=2000;
+//Time in ms a buffer is kept after it left the retention store, as other threads may still read it
+const unsigned int buffer_reuse_time=500;
+//Initial number of slots of the retention store. It grows if buffers arrive faster
+const size_t input_initial_slots=1024;
+//Transport stream packets per buffer. Seven packets fit into one datagram
+const unsigned int buffer_packets=7;
+//Size of a buffer
+const unsigned int buffer_size=buffer_packets*ts_packet_size;
+//Size of the buffer data is received into from the streaming server
+const size_t input_recv_size=65536;
+//References further apart than this in 90 kHz ticks are discontinuities
+const boost::uint64_t input_max_pcr_gap=ts_pcr_hz*2;
+
+/**
+* Initialize the input thread. Use the URL pURL for acessing the stream.
+* See createInputSource for the supported urls. Buffers are kept for
+* retransmissions for 'pRetention' ms
+*/
+Input::Input(const std::string &pURL, unsigned int pRetention) : url(pURL)
+{
+	retention=pRetention;
+	if(retention<input_min_retention)
+	{
+		retention=input_min_retention;
+	}
+	ring=new SBufferRing(input_initial_slots);
+	curr_buffer_id=0;
+	curr_buffer=NULL;
+	has_clock=false;
+	has_pcr=false;
+	pcr_pid=0;
+	last_pcr=0;
+	pcr_clock=0;
+	pcr_bytes=0;
+	byte_rate=0;
+	last_packetcounttime=os_gettimems();
+	packets=0;
+	packets_sec=0;
+	max_packets_sec=0;
+}
+
+/**
+* main thread function
+**/
+void Input::operator()(void)
+{
+	IInputSource *source=createInputSource(url);
+	if(source==NULL)
+	{
+		log("Unusable input \""+url+"\"");
+		return;
+	}
+	char *rbuf=new char[input_recv_size];
+	unsigned int discontinuities=0;
+	std::vector<SSendBuf> runs;
+
+	//Receive the data and cut it into buffers of whole packets. Ids continue across discontinuities
+	while(true)
+	{
+		size_t rc=source->read(rbuf, input_recv_size);
+
+		if(source->getDiscontinuities()!=discontinuities)
+		{
+			//The stream starts anew. Drop the incomplete packets
+			discontinuities=source->getDiscontinuities();
+			framer.reset();
+			if(curr_buffer!=NULL)
+			{
+				curr_buffer->datasize=0;
+			}
+			resetClock();
+		}
+
+		runs.clear();
+		framer.frame(rbuf, rc, runs);
+		for(size_t i=0;i<runs.size();++i)
+		{
+			for(size_t off=0;off<runs[i].bsize;off+=ts_packet_size)
+			{
+				addPacket(runs[i].buf+off);
+			}
+		}
+	}
+}
+
+/**
+* Get an empty buffer
+**/
+SBuffer* Input::getEmptyBuffer(void)
+{
+	//Trashed buffers are older than the retention time
+	SBuffer *nb;
+	if(buffer_trash.empty() || os_gettimems()-buffer_trash.front()->created<=retention+buffer_reuse_time)
+	{
+		nb=new SBuffer;
+		nb->data=new char[buffer_size];
+	}
+	else
+	{
+		nb=buffer_trash.front();
+		buffer_trash.pop();
+	}
+	nb->datasize=0;
+	return nb;
+}
+
+/**
+* Append the transport stream packet 'pkt' to the current buffer. Full
+* buffers are passed on
+**/
+void Input::addPacket(const char *pkt)
+{
+	updateClock(pkt);
+
+	if(curr_buffer==NULL)
+	{
+		curr_buffer=getEmptyBuffer();
+	}
+	if(curr_buffer->datasize==0)
+	{
+		curr_buffer->has_stream_time=has_clock;
+		curr_buffer->stream_time=(unsigned int)(getClock()/(ts_pcr_hz/1000));
+	}
+
+	memcpy(&curr_buffer->data[curr_buffer->datasize], pkt, ts_packet_size);
+	curr_buffer->datasize+=ts_packet_size;
+	pcr_bytes+=ts_packet_size;
+
+	if(curr_buffer->datasize>=buffer_size)
+	{
+		addBuffer(curr_buffer);
+		curr_buffer=NULL;
+	}
+}
+
+/**
+* Make the buffer 'nb' available to the other threads
+**/
+void Input::addBuffer(SBuffer *nb)
+{
+	nb->created=os_gettimems();
+	nb->id=++curr_buffer_id;
+	retainBuffer(nb);
+
+	boost::mutex::scoped_lock lock(mutex);
+	if(os_gettimems()- last_packetcounttime>1000 && packets!=0)
+	{
+		packets_sec=0.9f*packets_sec+0.1f*(float)packets;
+		if(packets_sec>max_packets_sec)
+		{
+			max_packets_sec=packets_sec;
+		}
+		packets=0;
+		last_packetcounttime=os_gettimems();
+	}
+	++packets;
+	new_buffers.push(nb);
+}
+
+/**
+* Put the buffer 'nb' into the retention store. The buffer it replaces
+* is trashed. The store grows if that buffer is still retained
+**/
+void Input::retainBuffer(SBuffer *nb)
+{
+	SBufferRing *r=ring;
+	SBuffer *old=r->slots[nb->id & r->mask];
+	if(old!=NULL && nb->created-old->created<=retention)
+	{
+		r=growRing();
+		old=r->slots[nb->id & r->mask];
+	}
+
+	os_atomic_store_ptr(&r->slots[nb->id & r->mask], nb);
+
+	if(old!=NULL)
+	{
+		buffer_trash.push(old);
+	}
+}
+
+/**
+* Double the size of the retention store
+**/
+SBufferRing* Input::growRing(void)
+{
+	SBufferRing *r=ring;
+	SBufferRing *nr=new SBufferRing((r->mask+1)*2);
+	for(size_t i=0;i<=r->mask;++i)
+	{
+		SBuffer *b=r->slots[i];
+		if(b!=NULL)
+		{
+			nr->slots[b->id & nr->mask]=b;
+		}
+	}
+	os_atomic_store_ptr(&ring, nr);
+	retired_rings.push_back(r);
+	LOG("Input: Retention store grown to "+nconvert(nr->mask+1)+" buffers", LL_DEBUG);
+	return nr;
+}
+
+/**
+* Update the stream clock with the packet 'pkt'
+**/
+void Input::updateClock(const char *pkt)
+{
+	boost::uint64_t pcr;
+	if(has_pcr && ts_get_pid(pkt)!=pcr_pid)
+		return;
+	if(!ts_get_pcr(pkt, pcr))
+		return;
+
+	if(!has_pcr)
+	{
+		//First reference or first one after a reset. Continue at the current time
+		pcr_clock=getClock();
+		pcr_pid=ts_get_pid(pkt);
+		has_pcr=true;
+		has_clock=true;
+	}
+	else
+	{
+		boost::uint64_t diff=(pcr-last_pcr)&(ts_pcr_wrap-1);
+		if(diff==0 || diff>input_max_pcr_gap)
+		{
+			LOG("Input: Discontinuity in program clock reference", LL_DEBUG);
+			pcr_clock=getClock();
+		}
+		else
+		{
+			pcr_clock+=diff;
+			float rate=(float)pcr_bytes/((float)diff/(ts_pcr_hz/1000));
+			if(byte_rate==0)
+				byte_rate=rate;
+			else
+				byte_rate=0.9f*byte_rate+0.1f*rate;
+		}
+	}
+	last_pcr=pcr;
+	pcr_bytes=0;
+}
+
+/**
+* Forget the stream clock, e.g. after a reconnect. The clock continues
+* at the current stream time once a new reference arrives
+**/
+void Input::resetClock(void)
+{
+	pcr_clock=getClock();
+	pcr_bytes=0;
+	has_pcr=false;
+}
+
+/**
+* Get the current stream time in 90 kHz ticks
+**/
+boost::uint64_t Input::getClock(void)
+{
+	if(byte_rate<=0)
+		return pcr_clock;
+	return pcr_clock+(boost::uint64_t)((float)pcr_bytes/byte_rate*(ts_pcr_hz/1000));
+}
+
+/**
+* Get the average amount of packets received per second
+**/
+float Input::getPacketsPerSecond(void)
+{
+	boost::mutex::scoped_lock lock(mutex);
+	return packets_sec;
+}
+
+/**
+* Get the maximal amount of packets received per second
+**/
+float Input::getMaxPacketsPerSecond(void)
+{
+	boost::mutex::scoped_lock lock(mutex);
+	return max_packets_sec;
+}
+
+/**
+* Get the new buffers
+**/
+std::vector<SBuffer*> Input::getNewBuffers(void)
+{
+	boost::mutex::scoped_lock lock(mutex);
+	std::vector<SBuffer*> nb;
+	while(!new_buffers.empty())
+	{
+		nb.push_back(new_buffers.front());
+		new_buffers.pop();
+	}
+	return nb;
+}
+
+/**
+* Get a specific buffer. Returns NULL if it isn't retained anymore
+**/
+SBuffer* Input::getBuffer(size_t id)
+{
+	SBufferRing *r=os_atomic_load_ptr(&ring);
+	SBuffer *b=os_atomic_load_ptr(&r->slots[id & r->mask]);
+	if(b==NULL || b->id!=id || os_gettimems()-b->created>retention)
+	{
+		return NULL;
+	}
+	return b;
 }
\ No newline at end of file
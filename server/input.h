@@ -1,91 +1,168 @@
-/**
-* Connects itself to the real streaming server and writes the data it
-* receives into buffers which can be accessed from the other
-* threads
-**/
-#ifndef INPUT_H
-#define INPUT_H
-
+/**
+* Connects itself to the real streaming server and writes the data it
+* receives into buffers which can be accessed from the other
+* threads
+**/
+#ifndef INPUT_H
+#define INPUT_H
+
 #include <queue>
-#include <map>
-#include <boost/thread/mutex.hpp>
-
-/**
-* Structure to save a buffer received from the real streaming server
-**/
-struct SBuffer
-{
-	SBuffer(){ already_used=false; }
-	char *data;
-	size_t datasize;
-	size_t id;
-	unsigned int created;
-	bool already_used;
-};
-
-/**
-* The input thread
-**/
-class Input
-{
-public:
-	/**
-	* Initialize the input thread. Use the URL pURL for acessing the stream
-	* via HTTP
-	*/
-	Input(const std::string &pURL);
-
-	/**
-	* main thread function
-	**/
-	void operator()(void);
-
-	/**
-	* Get newly received buffers
-	**/
-	std::vector<SBuffer*> getNewBuffers(void);
-	/**
-	* Get a specific (old) buffer with id 'id'
-	**/
-	SBuffer * getBuffer(size_t id);
-
-	/**
-	* Get the average amount of packets received per second
-	**/
-	float getPacketsPerSecond(void);
-	/**
-	* Get the maximal amount of packets received per second
-	**/
-	float getMaxPacketsPerSecond(void);
-
-private:
-
-	/**
-	* Clean old buffers
-	**/
-	void cleanBuffer(void);
-
-	//Structures for saving the buffers
-	std::queue<SBuffer*> new_buffers;
-	std::queue<SBuffer*> old_buffers;
-	std::queue<SBuffer*> buffer_trash;
-
-	//Structure to map buffer ids to buffers
-	std::map<size_t, SBuffer*> buffer_ids;
-
-	//The stream url
-	std::string url;
-
-	//Current buffer id
-	size_t curr_buffer_id;
-
-	//Values to caclculate the packets per second and max packets per seconds
-	float packets_sec;
-	unsigned int packets;
-	unsigned int last_packetcounttime;
-	float max_packets_sec;
-
-	boost::mutex mutex;
-};
-
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/cstdint.hpp>
+#include "../common/tspacket.h"
+
+//Default time in ms buffers are kept for retransmissions
+const unsigned int input_default_retention=5000;
+
+/**
+* Structure to save a buffer received from the real streaming server
+**/
+struct SBuffer
+{
+	SBuffer(){ has_stream_time=false; stream_time=0; }
+	char *data;
+	size_t datasize;
+	size_t id;
+	unsigned int created;
+	//Time of the first packet in the stream in ms derived from the program clock reference
+	unsigned int stream_time;
+	bool has_stream_time;
+};
+
+/**
+* Retention store. Slot 'id & mask' holds the buffer with the id 'id' or
+* a buffer which is older
+**/
+struct SBufferRing
+{
+	SBufferRing(size_t size)
+	{
+		slots=new SBuffer*[size];
+		for(size_t i=0;i<size;++i) slots[i]=NULL;
+		mask=size-1;
+	}
+	SBuffer * volatile *slots;
+	size_t mask;
+};
+
+/**
+* The input thread
+**/
+class Input
+{
+public:
+	/**
+	* Initialize the input thread. Use the URL pURL for acessing the stream
+	* via HTTP, UDP/RTP or from a file. See createInputSource. Buffers are
+	* kept for retransmissions for 'pRetention' ms
+	*/
+	Input(const std::string &pURL, unsigned int pRetention);
+
+	/**
+	* main thread function
+	**/
+	void operator()(void);
+
+	/**
+	* Get newly received buffers
+	**/
+	std::vector<SBuffer*> getNewBuffers(void);
+	/**
+	* Get a specific (old) buffer with id 'id'. Returns NULL if it isn't
+	* retained anymore. Doesn't lock
+	**/
+	SBuffer * getBuffer(size_t id);
+
+	/**
+	* Get the average amount of packets received per second
+	**/
+	float getPacketsPerSecond(void);
+	/**
+	* Get the maximal amount of packets received per second
+	**/
+	float getMaxPacketsPerSecond(void);
+
+private:
+
+	/**
+	* Get an empty buffer
+	**/
+	SBuffer* getEmptyBuffer(void);
+	/**
+	* Append the transport stream packet 'pkt' to the current buffer. Full
+	* buffers are passed on
+	**/
+	void addPacket(const char *pkt);
+	/**
+	* Make the buffer 'nb' available to the other threads
+	**/
+	void addBuffer(SBuffer *nb);
+	/**
+	* Put the buffer 'nb' into the retention store. The buffer it replaces
+	* is trashed. The store grows if that buffer is still retained
+	**/
+	void retainBuffer(SBuffer *nb);
+	/**
+	* Double the size of the retention store
+	**/
+	SBufferRing* growRing(void);
+	/**
+	* Update the stream clock with the packet 'pkt'
+	**/
+	void updateClock(const char *pkt);
+	/**
+	* Forget the stream clock, e.g. after a reconnect. The clock continues
+	* at the current stream time once a new reference arrives
+	**/
+	void resetClock(void);
+	/**
+	* Get the current stream time in 90 kHz ticks
+	**/
+	boost::uint64_t getClock(void);
+
+	//Structures for saving the buffers
+	std::queue<SBuffer*> new_buffers;
+	std::queue<SBuffer*> buffer_trash;
+
+	//Buffers by id. Replaced stores are kept, as other threads may still read them
+	SBufferRing * volatile ring;
+	std::vector<SBufferRing*> retired_rings;
+	//Time in ms buffers are retained
+	unsigned int retention;
+
+	//The stream url
+	std::string url;
+
+	//Current buffer id
+	size_t curr_buffer_id;
+
+	//Cuts the received data into transport stream packets
+	CTSFramer framer;
+	//Buffer which is filled with packets
+	SBuffer *curr_buffer;
+
+	//Stream clock. The program clock reference of the first PID carrying
+	//one is used. Between two references the time is interpolated from the
+	//amount of bytes received and the byte rate
+	bool has_clock;
+	bool has_pcr;
+	unsigned short pcr_pid;
+	boost::uint64_t last_pcr;
+	//Stream time at the last reference in 90 kHz ticks
+	boost::uint64_t pcr_clock;
+	//Bytes received since the last reference
+	size_t pcr_bytes;
+	//Byte rate in bytes per ms
+	float byte_rate;
+
+	//Values to caclculate the packets per second and max packets per seconds
+	float packets_sec;
+	unsigned int packets;
+	unsigned int last_packetcounttime;
+	float max_packets_sec;
+
+	boost::mutex mutex;
+};
+
 #endif //INPUT_H
@@ -0,0 +1,79 @@
+#include "inputsource.h"
+#include "httpsource.h"
+#include "udpsource.h"
+#include "filesource.h"
+#include "../common/socket_functions.h"
+#include "../common/stringtools.h"
+#include "../common/log.h"
+#include <stdlib.h>
+
+/**
+* Create the source for the address 'addr' of the form [@]host:port
+**/
+static IInputSource* createUdpSource(std::string addr, bool rtp)
+{
+	if(!addr.empty() && addr[0]=='@')
+		addr.erase(0, 1);
+
+	size_t colon=addr.find_last_of(':');
+	if(colon==std::string::npos)
+	{
+		log("Port missing in input address \""+addr+"\"");
+		return NULL;
+	}
+
+	std::string host=addr.substr(0, colon);
+	unsigned short port=(unsigned short)atoi(addr.substr(colon+1).c_str());
+	unsigned int ip=0;
+	if(!host.empty())
+	{
+		ip=os_resolv(host);
+	}
+
+	UdpSource *source=new UdpSource(ip, port, rtp);
+	if(!source->isOk())
+	{
+		delete source;
+		return NULL;
+	}
+	return source;
+}
+
+/**
+* Create the source for 'url'. Supported are http://host[:port]/path, udp://[@]host:port,
+* rtp://[@]host:port (multicast groups are joined), file://path and plain file paths.
+* Returns NULL if the url can't be used
+**/
+IInputSource* createInputSource(const std::string &url)
+{
+	size_t scheme_end=url.find("://");
+	if(scheme_end==std::string::npos)
+	{
+		scheme_end=0;
+	}
+
+	std::string scheme=strlower(url.substr(0, scheme_end));
+	std::string rest=(scheme_end>0)?url.substr(scheme_end+3):url;
+
+	if(scheme=="http")
+	{
+		return new HttpSource(url);
+	}
+	else if(scheme=="udp" || scheme=="rtp")
+	{
+		return createUdpSource(rest, scheme=="rtp");
+	}
+	else if(scheme=="file" || scheme.empty())
+	{
+		FileSource *source=new FileSource(rest);
+		if(!source->isOk())
+		{
+			delete source;
+			return NULL;
+		}
+		return source;
+	}
+
+	log("Unsupported input \""+url+"\"");
+	return NULL;
+}
@@ -0,0 +1,35 @@
+/**
+* Interface of the sources the input thread reads the stream from
+**/
+#ifndef INPUTSOURCE_H
+#define INPUTSOURCE_H
+
+#include <string>
+#include <stddef.h>
+
+class IInputSource
+{
+public:
+	virtual ~IInputSource(void) {}
+
+	/**
+	* Read up to 'bsize' bytes of the stream into 'buf'. Blocks until
+	* at least one byte is available. Returns the number of bytes read
+	**/
+	virtual size_t read(char *buf, size_t bsize)=0;
+
+	/**
+	* Returns how often the stream was interrupted, e.g. by a reconnect or lost
+	* datagrams. Data read before and after an interruption doesn't belong together
+	**/
+	virtual unsigned int getDiscontinuities(void)=0;
+};
+
+/**
+* Create the source for 'url'. Supported are http://host[:port]/path, udp://[@]host:port,
+* rtp://[@]host:port (multicast groups are joined), file://path and plain file paths.
+* Returns NULL if the url can't be used
+**/
+IInputSource* createInputSource(const std::string &url);
+
+#endif //INPUTSOURCE_H
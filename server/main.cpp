@@ -1,56 +1,119 @@
-/**
-* Main file. Parse the parameters and start all the threads.
-**/
-#ifdef _WIN32
-#include <conio.h>
-#include <Windows.h>
-#endif
-
-#include <iostream>
-#include "controller.h"
-
+/**
+* Main file. Parse the parameters and start all the threads.
+**/
+#ifdef _WIN32
+#include <conio.h>
+#include <Windows.h>
+#endif
+
+#include <iostream>
+#include "controller.h"
+#include "sender.h"
+
 #include <boost/thread/thread.hpp>
 #include <boost/thread/mutex.hpp>
-#include <boost/bind.hpp>
-
-#include "../common/settings.h"
-
-
-int main(int argc, char *argv[])
-{
-	if(argc<3)
-	{
-		std::cout << "Start with qstream [target_server url] [bandwidth in bytes/s]" << std::endl;
-		return 0;
-	}
-	// Start input, tracker and controller thread and connect them to each other
-	Input *input=new Input(argv[1]);
-	boost::thread input_thread(boost::ref(*input));
-	input_thread.yield();
-
-	//90% of available bandwidth for exploitation
-	Tracker *tracker=new Tracker(tracker_port, (unsigned int)((float)atoi(argv[2])*0.9f+0.5f));
-	Controller *controller=new Controller(input, tracker, (unsigned int)atoi(argv[2]) );
-	tracker->setController(controller);
-	tracker->setInput(input);
-
-	boost::thread tracker_thread(boost::ref(*tracker));
-	tracker_thread.yield();
-
-#ifdef _WIN32
-	boost::thread controller_thread(boost::ref(*controller));
-	controller_thread.yield();
-
-	while(true)
-	{
-		Sleep(10);
-		if( _kbhit()!=0 )
-		{
-			tracker->visualize_trees();
-		}
-	}
-#else
-	//Start the controller thread in the main thread
-	(*controller)();
-#endif
+#include <boost/bind.hpp>
+
+#include "../common/settings.h"
+#include "../common/socket_functions.h"
+#include <vector>
+#include <string>
+
+
+int main(int argc, char *argv[])
+{
+	//Options start with "--". The other parameters are positional
+	std::vector<std::string> args;
+	unsigned int retention=input_default_retention;
+	unsigned int controller_threads=1;
+	unsigned int send_threads=0;
+	for(int i=1;i<argc;++i)
+	{
+		std::string arg=argv[i];
+		if(arg.find("--retention=")==0)
+		{
+			retention=(unsigned int)atoi(arg.substr(12).c_str());
+		}
+		else if(arg.find("--controller-threads=")==0)
+		{
+			controller_threads=(unsigned int)atoi(arg.substr(21).c_str());
+		}
+		else if(arg.find("--send-threads=")==0)
+		{
+			send_threads=(unsigned int)atoi(arg.substr(15).c_str());
+		}
+		else
+		{
+			args.push_back(arg);
+		}
+	}
+
+	if(args.size()<2)
+	{
+		std::cout << "Start with qstream [target_server url] [bandwidth in bytes/s] ([fec group size] [url of channel 1] [url of channel 2] ...) ([--retention=ms buffers are kept for retransmissions] [--controller-threads=threads for exploration and congestion control per channel] [--send-threads=threads with their own UDP socket sending the messages])" << std::endl;
+		return 0;
+	}
+	//Number of buffers protected by one parity buffer. 0 disables forward error correction
+	unsigned int fec_group_size=0;
+	if(args.size()>2)
+	{
+		fec_group_size=(unsigned int)atoi(args[2].c_str());
+	}
+	//Channel 0 streams the first url. Further urls are streamed as channel 1, 2, ...
+	std::vector<std::string> urls;
+	urls.push_back(args[0]);
+	for(size_t i=3;i<args.size();++i)
+	{
+		urls.push_back(args[i]);
+	}
+	unsigned int bandwidth=(unsigned int)atoi(args[1].c_str());
+
+	//All channels send with the same sockets
+	SenderPool *senders=new SenderPool(send_threads);
+	if(!senders->isOk())
+	{
+		return 1;
+	}
+
+	//90% of available bandwidth for exploitation. The bandwidth is divided across the channels
+	Tracker *tracker=new Tracker(tracker_port, (unsigned int)((float)bandwidth*0.9f+0.5f));
+
+	// Start input and controller thread of each channel and connect them to the tracker
+	std::vector<Controller*> controllers;
+	for(size_t i=0;i<urls.size();++i)
+	{
+		Input *input=new Input(urls[i], retention);
+		boost::thread input_thread(boost::ref(*input));
+		input_thread.yield();
+
+		Controller *controller=new Controller((unsigned short)i, input, tracker, senders, bandwidth, fec_group_size, controller_threads);
+		tracker->addChannel((unsigned short)i, input, controller);
+		controllers.push_back(controller);
+	}
+
+	boost::thread tracker_thread(boost::ref(*tracker));
+	tracker_thread.yield();
+
+	for(size_t i=1;i<controllers.size();++i)
+	{
+		boost::thread controller_thread(boost::ref(*controllers[i]));
+		controller_thread.yield();
+	}
+
+#ifdef _WIN32
+	boost::thread controller_thread(boost::ref(*controllers[0]));
+	controller_thread.yield();
+
+	while(true)
+	{
+		Sleep(10);
+		if( _kbhit()!=0 )
+		{
+			tracker->visualize_trees();
+		}
+	}
+#else
+	//Start the controller thread of the first channel in the main thread
+	(*controllers[0])();
+#endif
 }
\ No newline at end of file
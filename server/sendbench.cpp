@@ -0,0 +1,160 @@
+/**
+* Measures how the UDP egress in packets/s scales with the number of sender threads. Compares
+* threads sharing one socket with threads owning a SO_REUSEPORT socket each, like the SenderPool. Not installed.
+* Start with sendbench ([max threads] [message size] [destination] [ms per measurement])
+**/
+
+#include "../common/socket_functions.h"
+#include "../common/os_functions.h"
+#include "../common/os_atomic.h"
+#include <boost/thread/thread.hpp>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+
+//UDP port the sockets are bound to. Not the server port, so it can run next to a server
+const unsigned short sendbench_port=5799;
+//Number of destination ports the messages are spread over
+const unsigned short sendbench_dest_ports=64;
+
+/**
+* Create a UDP socket bound to the benchmark port like the SenderPool does. Returns SOCKET_ERROR on error
+**/
+static SOCKET createSocket(bool reuse)
+{
+	SOCKET s=os_createSocket();
+	if(reuse && !os_set_reuseport(s))
+	{
+		std::cout << "SO_REUSEPORT not supported" << std::endl;
+		os_closesocket(s);
+		return SOCKET_ERROR;
+	}
+	if(!os_bind(s, sendbench_port))
+	{
+		std::cout << "Could not bind UDP socket to port " << sendbench_port << std::endl;
+		os_closesocket(s);
+		return SOCKET_ERROR;
+	}
+	unsigned int send_window_size=1024*1024;
+	while(!os_set_send_window(s, send_window_size) )
+		send_window_size/=2;
+	return s;
+}
+
+/**
+* Sender thread. Sends messages to different ports of 'ip' with socket 's' until 'stop' is set
+**/
+class CSendWorker
+{
+public:
+	CSendWorker(SOCKET pS, unsigned int pIp, size_t pBsize, volatile unsigned int *pStop)
+		: s(pS), ip(pIp), buf(pBsize, 1), stop(pStop), packets(0)
+	{
+	}
+
+	void operator()(void)
+	{
+		unsigned int n=0;
+		while(!os_atomic_load(stop))
+		{
+			for(unsigned int i=0;i<100;++i,++n)
+			{
+				if(os_sendto(s, ip, (unsigned short)(40000+n%sendbench_dest_ports), &buf[0], (unsigned int)buf.size())>0)
+				{
+					++packets;
+				}
+			}
+		}
+	}
+
+	SOCKET s;
+	unsigned int ip;
+	std::vector<char> buf;
+	volatile unsigned int *stop;
+	double packets;
+};
+
+/**
+* Send with 'nthreads' threads for 'duration' ms. They share one socket or with 'own_sockets'
+* each has its own. Prints the packets per second. Returns false if the sockets could not be created
+**/
+static bool measure(unsigned int nthreads, bool own_sockets, unsigned int ip, size_t bsize, unsigned int duration)
+{
+	std::vector<SOCKET> sockets;
+	for(unsigned int i=0;i<(own_sockets?nthreads:1);++i)
+	{
+		SOCKET s=createSocket(own_sockets);
+		if(s==SOCKET_ERROR)
+		{
+			for(size_t j=0;j<sockets.size();++j)
+			{
+				os_closesocket(sockets[j]);
+			}
+			return false;
+		}
+		sockets.push_back(s);
+	}
+
+	volatile unsigned int stop=0;
+	std::vector<CSendWorker*> workers;
+	boost::thread_group threads;
+	unsigned int start=os_gettimems();
+	for(unsigned int i=0;i<nthreads;++i)
+	{
+		workers.push_back(new CSendWorker(sockets[i%sockets.size()], ip, bsize, &stop));
+		threads.create_thread(boost::ref(*workers[i]));
+	}
+	os_sleep(duration);
+	os_atomic_store(&stop, 1);
+	threads.join_all();
+	unsigned int ms=os_gettimems()-start;
+
+	double packets=0;
+	for(size_t i=0;i<workers.size();++i)
+	{
+		packets+=workers[i]->packets;
+		delete workers[i];
+	}
+	for(size_t i=0;i<sockets.size();++i)
+	{
+		os_closesocket(sockets[i]);
+	}
+	if(ms==0)
+		ms=1;
+	std::cout << nthreads << " threads, " << (own_sockets?"own sockets":"shared socket") << ": "
+		<< (unsigned int)(packets*1000.0/ms+0.5) << " packets/s" << std::endl;
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned int max_threads=4;
+	size_t bsize=1400;
+	std::string dest="127.0.0.1";
+	unsigned int duration=2000;
+	if(argc>1)
+		max_threads=(unsigned int)atoi(argv[1]);
+	if(argc>2)
+		bsize=(size_t)atoi(argv[2]);
+	if(argc>3)
+		dest=argv[3];
+	if(argc>4)
+		duration=(unsigned int)atoi(argv[4]);
+	if(max_threads<1 || bsize<1 || bsize>65000)
+	{
+		std::cout << "Start with sendbench ([max threads] [message size] [destination] [ms per measurement])" << std::endl;
+		return 1;
+	}
+
+	unsigned int ip=os_resolv(dest);
+	std::cout << "message size " << bsize << ", destination " << dest << ", " << boost::thread::hardware_concurrency() << " cores" << std::endl;
+	for(unsigned int nthreads=1;nthreads<=max_threads;nthreads*=2)
+	{
+		if(!measure(nthreads, false, ip, bsize, duration))
+			return 1;
+		if(nthreads>1 && !measure(nthreads, true, ip, bsize, duration))
+			return 1;
+	}
+	return 0;
+}
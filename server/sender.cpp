@@ -0,0 +1,251 @@
+#include "sender.h"
+#include "../common/socket_functions.h"
+#include "../common/os_functions.h"
+#include "../common/stringtools.h"
+#include "../common/log.h"
+#include <boost/thread/thread.hpp>
+#include <boost/ref.hpp>
+#include <memory.h>
+
+//UDP port the server sends from
+const unsigned short controller_port=5700;
+//Time in ms a sender thread waits for messages before it looks at the queue again
+const unsigned int sender_wait_time=100;
+//Interval in ms in which the sender threads log how many messages they sent
+const unsigned int sender_stats_interval=10000;
+//Messages with a payload that were queued longer than this (in ms) are dropped, as the payload may be reused.
+//The input keeps its buffers at least 2.5 s and the controller sends them for one second
+const unsigned int sender_max_payload_age=1000;
+
+/**
+* Send with the UDP socket 'pS'. 'pIndex' is used in log messages
+**/
+Sender::Sender(SOCKET pS, unsigned int pIndex) : s(pS), index(pIndex)
+{
+	waiting=0;
+}
+
+/**
+* Queue a copy of 'buf' of size 'bsize' for peer with ip 'ip' and port 'port'. Called by any thread
+**/
+void Sender::send(unsigned int ip, unsigned short port, const char *buf, size_t bsize)
+{
+	SSendPacket pkt;
+	pkt.buf=new char[bsize];
+	memcpy(pkt.buf, buf, bsize);
+	pkt.bsize=bsize;
+	pkt.payload=NULL;
+	pkt.psize=0;
+	pkt.ip=ip;
+	pkt.port=port;
+	pkt.qtime=0;
+	queuePacket(pkt);
+}
+
+/**
+* Queue a copy of header 'hdr' of size 'hsize' followed by 'payload' of size 'psize' for peer with ip 'ip'
+* and port 'port'. The payload is not copied and has to stay valid for 'sender_max_payload_age' ms.
+* Called by any thread
+**/
+void Sender::sendv(unsigned int ip, unsigned short port, const char *hdr, size_t hsize, const char *payload, size_t psize)
+{
+	SSendPacket pkt;
+	pkt.buf=new char[hsize];
+	memcpy(pkt.buf, hdr, hsize);
+	pkt.bsize=hsize;
+	pkt.payload=payload;
+	pkt.psize=psize;
+	pkt.ip=ip;
+	pkt.port=port;
+	pkt.qtime=os_gettimems();
+	queuePacket(pkt);
+}
+
+/**
+* Queue 'pkt' and wake the thread
+**/
+void Sender::queuePacket(const SSendPacket &pkt)
+{
+	queue.push(pkt);
+
+	//The thread sets 'waiting' before it looks at the queue a last time, so it either sees the message or is woken
+	if(os_atomic_load(&waiting))
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		cond.notify_one();
+	}
+}
+
+/**
+* Main thread function
+**/
+void Sender::operator()(void)
+{
+	unsigned int packets=0;
+	unsigned int last_stats=os_gettimems();
+	SSendPacket pkt;
+	while(true)
+	{
+		while(queue.pop(pkt))
+		{
+			if(pkt.payload==NULL)
+			{
+				os_sendto(s, pkt.ip, pkt.port, pkt.buf, (unsigned int)pkt.bsize);
+				++packets;
+			}
+			else if(os_gettimems()-pkt.qtime<=sender_max_payload_age)
+			{
+				SSendBuf bufs[2];
+				bufs[0].buf=pkt.buf;
+				bufs[0].bsize=pkt.bsize;
+				bufs[1].buf=pkt.payload;
+				bufs[1].bsize=pkt.psize;
+				os_sendtov(s, pkt.ip, pkt.port, bufs, 2);
+				++packets;
+			}
+			delete [] pkt.buf;
+		}
+
+		unsigned int ctime=os_gettimems();
+		if(ctime-last_stats>=sender_stats_interval)
+		{
+			LOG("Sender "+nconvert(index)+": "+nconvert(packets*1000/(ctime-last_stats))+" packets/s", LL_INFO);
+			packets=0;
+			last_stats=ctime;
+		}
+
+		boost::mutex::scoped_lock lock(mutex);
+		os_atomic_store(&waiting, 1);
+		if(queue.empty())
+		{
+			boost::xtime xt;
+			boost::xtime_get(&xt, boost::TIME_UTC);
+			xt.nsec+=sender_wait_time*1000000;
+			if(xt.nsec>=1000000000)
+			{
+				++xt.sec;
+				xt.nsec-=1000000000;
+			}
+			cond.timed_wait(lock, xt);
+		}
+		os_atomic_store(&waiting, 0);
+	}
+}
+
+/**
+* Open the sockets. With 'pThreads' 0 one socket is used by the calling threads.
+* Otherwise 'pThreads' sender threads are started, each with its own socket
+**/
+SenderPool::SenderPool(unsigned int pThreads)
+{
+	ok=false;
+	bool reuseport=false;
+	csock=createSocket(pThreads>1, reuseport);
+	if(csock==SOCKET_ERROR)
+		return;
+
+	if(pThreads>1 && !reuseport)
+	{
+		log("SO_REUSEPORT not supported. Sender threads share one socket");
+	}
+
+	for(unsigned int i=0;i<pThreads;++i)
+	{
+		SOCKET s=csock;
+		if(i>0 && reuseport)
+		{
+			//If the socket can't be bound the thread shares the first one
+			bool reused;
+			s=createSocket(true, reused);
+			if(s==SOCKET_ERROR)
+			{
+				s=csock;
+			}
+		}
+		Sender *sender=new Sender(s, i);
+		senders.push_back(sender);
+		boost::thread sender_thread(boost::ref(*sender));
+		sender_thread.yield();
+	}
+
+	ok=true;
+}
+
+/**
+* Returns false if no socket could be bound to the server port
+**/
+bool SenderPool::isOk(void)
+{
+	return ok;
+}
+
+/**
+* Send 'buf' of size 'bsize' to the peer with ip 'ip' and port 'port'. The messages to
+* one peer are always sent by the same thread, so they are not reordered
+**/
+void SenderPool::send(unsigned int ip, unsigned short port, const char *buf, size_t bsize)
+{
+	if(senders.empty())
+	{
+		os_sendto(csock, ip, port, buf, (unsigned int)bsize);
+	}
+	else
+	{
+		getSender(ip, port)->send(ip, port, buf, bsize);
+	}
+}
+
+/**
+* Send header 'hdr' of size 'hsize' followed by 'payload' of size 'psize' as one message to the peer
+* with ip 'ip' and port 'port'. The payload is never copied. With sender threads it has to stay valid
+* for 'sender_max_payload_age' ms. Buffers of the input stay valid longer than that
+**/
+void SenderPool::sendv(unsigned int ip, unsigned short port, const char *hdr, size_t hsize, const char *payload, size_t psize)
+{
+	if(senders.empty())
+	{
+		SSendBuf bufs[2];
+		bufs[0].buf=hdr;
+		bufs[0].bsize=hsize;
+		bufs[1].buf=payload;
+		bufs[1].bsize=psize;
+		os_sendtov(csock, ip, port, bufs, 2);
+	}
+	else
+	{
+		getSender(ip, port)->sendv(ip, port, hdr, hsize, payload, psize);
+	}
+}
+
+/**
+* Returns the sender thread for the peer with ip 'ip' and port 'port'
+**/
+Sender* SenderPool::getSender(unsigned int ip, unsigned short port)
+{
+	unsigned int h=(ip^((unsigned int)port<<16)^port)*2654435761U;
+	return senders[h%senders.size()];
+}
+
+/**
+* Create a UDP socket bound to the server port. With 'reuse' it tries to let other sockets bind
+* to the port as well and sets 'reused' to whether that worked. Returns SOCKET_ERROR on error
+**/
+SOCKET SenderPool::createSocket(bool reuse, bool &reused)
+{
+	SOCKET s=os_createSocket();
+	reused=reuse && os_set_reuseport(s);
+	if(!os_bind(s, controller_port))
+	{
+		log("error binding UDP socket to port "+nconvert(controller_port));
+		os_closesocket(s);
+		return SOCKET_ERROR;
+	}
+
+	//increase the udp send buffer (operating system)
+	unsigned int send_window_size=1024*1024; //1MB
+	while(!os_set_send_window(s, send_window_size) )
+		send_window_size/=2;
+
+	log("Send buffer set to "+nconvert(send_window_size));
+	return s;
+}
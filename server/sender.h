@@ -0,0 +1,125 @@
+/**
+* Sends the UDP messages of the controllers. Either directly from the calling thread
+* or with several sender threads, each owning a socket bound to the server port
+**/
+
+#ifndef SENDER_H
+#define SENDER_H
+
+#include "../common/types.h"
+#include "../common/mpscqueue.h"
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
+#include <vector>
+
+/**
+* Structure to save a UDP message until the sender thread sends it
+**/
+struct SSendPacket
+{
+	char *buf;
+	size_t bsize;
+	//Sent after 'buf' without being copied. NULL if there is none
+	const char *payload;
+	size_t psize;
+	unsigned int ip;
+	unsigned short port;
+	//Time the message was queued
+	unsigned int qtime;
+};
+
+/**
+* Sender thread. Sends the messages queued by any thread with its own socket
+**/
+class Sender
+{
+public:
+	/**
+	* Send with the UDP socket 'pS'. 'pIndex' is used in log messages
+	**/
+	Sender(SOCKET pS, unsigned int pIndex);
+
+	/**
+	* Queue a copy of 'buf' of size 'bsize' for peer with ip 'ip' and port 'port'. Called by any thread
+	**/
+	void send(unsigned int ip, unsigned short port, const char *buf, size_t bsize);
+
+	/**
+	* Queue a copy of header 'hdr' of size 'hsize' followed by 'payload' of size 'psize' for peer with ip 'ip'
+	* and port 'port'. The payload is not copied and has to stay valid for 'sender_max_payload_age' ms.
+	* Called by any thread
+	**/
+	void sendv(unsigned int ip, unsigned short port, const char *hdr, size_t hsize, const char *payload, size_t psize);
+
+	/**
+	* Main thread function
+	**/
+	void operator()(void);
+
+private:
+	/**
+	* Queue 'pkt' and wake the thread
+	**/
+	void queuePacket(const SSendPacket &pkt);
+
+	CMPSCQueue<SSendPacket> queue;
+
+	//Set while the thread waits for new messages
+	volatile unsigned int waiting;
+	//Mutex and condition to wake the thread
+	boost::mutex mutex;
+	boost::condition cond;
+
+	SOCKET s;
+	unsigned int index;
+};
+
+/**
+* The sockets and threads the controllers send with
+**/
+class SenderPool
+{
+public:
+	/**
+	* Open the sockets. With 'pThreads' 0 one socket is used by the calling threads.
+	* Otherwise 'pThreads' sender threads are started, each with its own socket
+	**/
+	SenderPool(unsigned int pThreads);
+
+	/**
+	* Returns false if no socket could be bound to the server port
+	**/
+	bool isOk(void);
+
+	/**
+	* Send 'buf' of size 'bsize' to the peer with ip 'ip' and port 'port'. The messages to
+	* one peer are always sent by the same thread, so they are not reordered
+	**/
+	void send(unsigned int ip, unsigned short port, const char *buf, size_t bsize);
+
+	/**
+	* Send header 'hdr' of size 'hsize' followed by 'payload' of size 'psize' as one message to the peer
+	* with ip 'ip' and port 'port'. The payload is never copied. With sender threads it has to stay valid
+	* for 'sender_max_payload_age' ms. Buffers of the input stay valid longer than that
+	**/
+	void sendv(unsigned int ip, unsigned short port, const char *hdr, size_t hsize, const char *payload, size_t psize);
+
+private:
+	/**
+	* Returns the sender thread for the peer with ip 'ip' and port 'port'
+	**/
+	Sender* getSender(unsigned int ip, unsigned short port);
+
+	/**
+	* Create a UDP socket bound to the server port. With 'reuse' it tries to let other sockets bind
+	* to the port as well and sets 'reused' to whether that worked. Returns SOCKET_ERROR on error
+	**/
+	SOCKET createSocket(bool reuse, bool &reused);
+
+	std::vector<Sender*> senders;
+	//Socket used if there are no sender threads
+	SOCKET csock;
+	bool ok;
+};
+
+#endif //SENDER_H
@@ -0,0 +1,136 @@
+#include "udpsource.h"
+#include "../common/socket_functions.h"
+#include "../common/stringtools.h"
+#include "../common/log.h"
+#include <memory.h>
+
+//Size of the socket receive buffer. Datagrams are lost if the input thread falls behind
+const unsigned int udp_recv_window=4*1024*1024;
+//Size of the fixed RTP header
+const size_t rtp_header_size=12;
+
+/**
+* Receive on port 'pPort'. If 'group_ip' is a multicast address the group
+* is joined. 'pRtp' says if the datagrams have a RTP header
+**/
+UdpSource::UdpSource(unsigned int group_ip, unsigned short pPort, bool pRtp)
+	: port(pPort), rtp(pRtp)
+{
+	ok=false;
+	has_seq=false;
+	last_seq=0;
+	discontinuities=0;
+
+	s=os_createSocket();
+	if(!os_bind(s, port))
+	{
+		log("Error binding input socket to UDP port "+nconvert(port));
+		return;
+	}
+
+	unsigned int recv_window_size=udp_recv_window;
+	while(!os_set_recv_window(s, recv_window_size) && recv_window_size>0)
+		recv_window_size/=2;
+
+	if(os_is_multicast(group_ip))
+	{
+		if(!os_join_multicast(s, group_ip))
+		{
+			log("Error joining multicast group on port "+nconvert(port));
+			return;
+		}
+	}
+
+	ok=true;
+}
+
+UdpSource::~UdpSource(void)
+{
+	os_closesocket(s);
+}
+
+/**
+* Returns false if the socket could not be set up
+**/
+bool UdpSource::isOk(void)
+{
+	return ok;
+}
+
+/**
+* Read the payload of the next datagram into 'buf' of size 'bsize'
+**/
+size_t UdpSource::read(char *buf, size_t bsize)
+{
+	while(true)
+	{
+		unsigned int fromip;
+		unsigned short fromport;
+		int rc=os_recvfrom(s, buf, (unsigned int)bsize, fromip, fromport);
+		if(rc<=0)
+			continue;
+
+		if(!rtp)
+			return rc;
+
+		size_t psize=stripRtp(buf, rc);
+		if(psize>0)
+			return psize;
+	}
+}
+
+/**
+* Returns the number of gaps in the RTP sequence numbers
+**/
+unsigned int UdpSource::getDiscontinuities(void)
+{
+	return discontinuities;
+}
+
+/**
+* Remove the RTP header from the datagram 'buf' of size 'bsize'. Returns
+* the payload size or 0 if the datagram is invalid
+**/
+size_t UdpSource::stripRtp(char *buf, size_t bsize)
+{
+	//Version 2
+	if(bsize<rtp_header_size || ((unsigned char)buf[0] & 0xC0)!=0x80)
+	{
+		LOG("Input: Invalid RTP packet", LL_DEBUG);
+		return 0;
+	}
+
+	//CSRC list and header extension
+	size_t hsize=rtp_header_size+4*(buf[0] & 0x0F);
+	if(buf[0] & 0x10)
+	{
+		if(bsize<hsize+4)
+			return 0;
+		hsize+=4+4*((((unsigned char)buf[hsize+2])<<8) | (unsigned char)buf[hsize+3]);
+	}
+
+	//Padding
+	size_t end=bsize;
+	if(buf[0] & 0x20)
+	{
+		size_t padding=(unsigned char)buf[bsize-1];
+		if(padding>end)
+			return 0;
+		end-=padding;
+	}
+
+	if(hsize>=end)
+		return 0;
+
+	unsigned short seq=(unsigned short)((((unsigned char)buf[2])<<8) | (unsigned char)buf[3]);
+	if(has_seq && seq!=(unsigned short)(last_seq+1))
+	{
+		LOG("Input: RTP packets lost before sequence number "+nconvert((unsigned int)seq), LL_DEBUG);
+		++discontinuities;
+	}
+	has_seq=true;
+	last_seq=seq;
+
+	memmove(buf, &buf[hsize], end-hsize);
+	return end-hsize;
+}
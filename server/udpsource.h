@@ -0,0 +1,54 @@
+/**
+* Receives the stream as UDP datagrams, optionally with a RTP header, from
+* unicast or multicast addresses
+**/
+#ifndef UDPSOURCE_H
+#define UDPSOURCE_H
+
+#include "../common/types.h"
+#include "inputsource.h"
+
+class UdpSource : public IInputSource
+{
+public:
+	/**
+	* Receive on port 'pPort'. If 'group_ip' is a multicast address the group
+	* is joined. 'pRtp' says if the datagrams have a RTP header
+	**/
+	UdpSource(unsigned int group_ip, unsigned short pPort, bool pRtp);
+	~UdpSource(void);
+
+	/**
+	* Returns false if the socket could not be set up
+	**/
+	bool isOk(void);
+
+	/**
+	* Read the payload of the next datagram into 'buf' of size 'bsize'
+	**/
+	size_t read(char *buf, size_t bsize);
+
+	/**
+	* Returns the number of gaps in the RTP sequence numbers
+	**/
+	unsigned int getDiscontinuities(void);
+
+private:
+	/**
+	* Remove the RTP header from the datagram 'buf' of size 'bsize'. Returns
+	* the payload size or 0 if the datagram is invalid
+	**/
+	size_t stripRtp(char *buf, size_t bsize);
+
+	SOCKET s;
+	unsigned short port;
+	bool ok;
+	bool rtp;
+
+	//Last RTP sequence number
+	bool has_seq;
+	unsigned short last_seq;
+	unsigned int discontinuities;
+};
+
+#endif //UDPSOURCE_H